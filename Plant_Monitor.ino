@@ -7,13 +7,27 @@
  * @license MIT
  */
 
+#include "hal.hpp"
 #include "lib.hpp"
+#include "adc.hpp"
+#include "boot.hpp"
+#include "clock.hpp"
+#include "events.hpp"
+#include "history.hpp"
+#include "i2csoil.hpp"
+#include "latency.hpp"
+#include "logstore.hpp"
+#include "nvm.hpp"
+#include "power.hpp"
+#include "readrate.hpp"
+#include "scheduler.hpp"
+#include "sensorstats.hpp"
+#include "serialout.hpp"
+#include "settings.hpp"
+#include "snapshot.hpp"
 #include "view.hpp"
-#include <Wire.h>
-#include <Arduino.h>
 #include "SerialController.hpp"
-#include <avr/interrupt.h>
-#include <avr/wdt.h>
+#include "twi.hpp"
 
 
 /**
@@ -23,92 +37,241 @@
  * update screen on the display (if enabled).
  */
 void readSensors() {
+  LATENCY_SCOPE(Sensors);
   View::debugLine(F("Start reading"));
   View::printUpdateScreen();
   Lib::readSensorsAndUpdateMemory();
   View::debugLine(F("Reading done"));
 }
 
+/**
+ * @brief Record the latest values and send them over the configured serial outputs.
+ */
+void publishValues() {
+  LATENCY_SCOPE(Publish);
+  Boot::mark(Boot::FirstReading);
+#if defined(HISTORY)
+  History::record(Lib::ctx);
+#endif  // HISTORY
+#if defined(LOG_EEPROM)
+  LogStore::record(Lib::ctx);
+#endif  // LOG_EEPROM
+#if defined(SENSOR_STATS)
+  SensorStats::record(Lib::ctx);
+#endif  // SENSOR_STATS
+  ReadRate::update(Lib::ctx);
+#if defined(WARM_RESTART)
+  Snapshot::save();
+#endif  // WARM_RESTART
+  View::valuesSerialSend();
+}
+
+/** A read was requested and has not started yet. */
+static bool readPending = false;
+/** millis() of the oldest request merged into @ref readPending. */
+static uint32_t readRequestMillis = 0;
+
+/**
+ * @brief Take the queued events in one batch. Every event requests a read;
+ * requests that arrive while one is pending are merged into it.
+ */
+static void takeEvents() {
+  Events::Event batch[EVENT_QUEUE_SIZE];
+  uint8_t n = Events::drain(batch, EVENT_QUEUE_SIZE);
+  for (uint8_t i = 0; i < n; i++) {
+    if (readPending) {
+      Events::countCoalesced(1);
+      continue;
+    }
+    readPending = true;
+    readRequestMillis = batch[i].millis;
+  }
+}
+
+/**
+ * @brief Start the pending read. With @ref ADC_ASYNC a non-blocking
+ * sampling round is kicked off on the ADC engine, unless one is still
+ * running; the result is picked up by @ref Adc::poll() in a later loop
+ * iteration.
+ */
+void startSensorRead() {
+#if defined(ADC_ASYNC)
+  if (!Adc::start()) return;
+  readPending = false;
+  Lib::ctx.requestMillis = readRequestMillis;
+  View::debugLine(F("Start reading"));
+#else
+  readPending = false;
+  Lib::ctx.requestMillis = readRequestMillis;
+  readSensors();
+  publishValues();
+#endif  // ADC_ASYNC
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////   TASKS   /////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(SERIAL_OUT)
+/** Drain queued output, receive and execute serial commands. */
+static void serialTask() {
+  SerialOut::service();
+  SerialController::pollSerial();
+  SerialController::processPendingCommands();
+}
+#endif  // SERIAL_OUT
+
+/** Start a requested sensor read and publish finished readings. */
+static void sensorTask() {
+  takeEvents();
+  if (readPending) startSensorRead();
+#if defined(SENSOR_I2C) && defined(ADC_ASYNC)
+  I2cSoil::service();
+#endif  // SENSOR_I2C && ADC_ASYNC
+#if defined(ADC_ASYNC)
+  if (Adc::poll(Lib::ctx)) {
+    View::debugLine(F("Reading done"));
+    publishValues();
+    if (readPending) startSensorRead();  // requested while the round ran
+  }
+#endif  // ADC_ASYNC
+}
+
+/** Move staged log records and EEPROM bytes towards the EEPROM. */
+static void storageTask() {
+#if defined(LOG_EEPROM)
+  LogStore::service();
+#endif  // LOG_EEPROM
+  Settings::service();
+  Nvm::service();
+}
+
+/** Redraw the display if its content changed. */
+static void renderTask() {
+#if defined(TWI_ASYNC)
+  Twi::poll();
+#endif  // TWI_ASYNC
+  View::printMainScreen();
+}
+
+/**
+ * @brief Kick the watchdog. It runs last in a pass, so a task that hangs
+ * or starves the loop for 8 s resets the board.
+ */
+static void watchdogTask() {
+  wdt_reset();
+}
+
+/**
+ * @brief Register the main loop tasks with the scheduler.
+ *
+ * Budgets are worst cases at 16 MHz: the render task sends one display page
+ * per pass, at most about 6.5 ms at 400 kHz. The serial deadline is the time the 64-byte UART receive
+ * buffer takes to fill at @ref BAUDRATE.
+ */
+static void setupTasks() {
+  // name, function, period ms, deadline ms, budget us, priority
+#if defined(SERIAL_OUT)
+  Scheduler::add(F("serial"), serialTask, 0, 5, 1000, 200);
+#endif  // SERIAL_OUT
+  Scheduler::add(F("sensor"), sensorTask, 0, 100, 2000, 150);
+  Scheduler::add(F("storage"), storageTask, 2, 50, 500, 100);
+  Scheduler::add(F("render"), renderTask, 10, 100, 8000, 50);
+  Scheduler::add(F("watchdog"), watchdogTask, 500, 4000, 100, 0);
+}
+
 /**
  * @brief Arduino setup routine.
  *
  * Initializes serial output and display (depending on configuration) and
- * prepares the sensor context and input pins.
+ * prepares the sensor context and input pins. On a fast boot (@ref Boot)
+ * the splash screen and the first reading are left to the main loop and
+ * Timer1 starts right after the serial port.
  */
 void setup() {
 
   wdt_enable(WDTO_8S);
 
-  View::initSerial();
-
   uint8_t flags = MCUSR;
-  Serial.print("MCUSR: 0x");
-  Serial.println(flags, HEX);
+  MCUSR = 0;
+  Boot::begin(flags);
 
-  if (flags & (1 << WDRF)) Serial.println(F("Reset durch Watchdog (WDRF)"));
-  if (flags & (1 << BORF)) Serial.println(F("Brown-out Reset (BORF)"));
-  if (flags & (1 << EXTRF)) Serial.println(F("Externer Reset (EXTRF)"));
-  if (flags & (1 << PORF)) Serial.println(F("Power-on Reset (PORF)"));
+  View::initSerial();
+  Boot::mark(Boot::SerialReady);
 
-  MCUSR = 0;
+  View::messageSerial(F("MCUSR: 0x"));
+#if defined(SERIAL_OUT)
+  SerialOut::printHex(flags, SerialOut::Reply);
+#endif  // SERIAL_OUT
+  View::messageLineSerial(F(""));
 
-  View::initDisplay();
-  //Initialize memory
+  if (flags & (1 << WDRF)) View::messageLineSerial(F("Reset durch Watchdog (WDRF)"));
+  if (flags & (1 << BORF)) View::messageLineSerial(F("Brown-out Reset (BORF)"));
+  if (flags & (1 << EXTRF)) View::messageLineSerial(F("Externer Reset (EXTRF)"));
+  if (flags & (1 << PORF)) View::messageLineSerial(F("Power-on Reset (PORF)"));
+
+  //Initialize memory; names and contrast are needed by the display
   Lib::initCtx();
-  Lib::readSensorsAndUpdateMemory();
-  View::debugLine(F("starting..."));
+  Settings::begin();
+  if (Settings::source() == Settings::Stored) View::messageLineSerial(F("Config loaded"));
 
-  // Configure Timer1 for READ_INTERVAL_SECONDS interrupts (ATmega328P @16MHz)
-  // We'll use prescaler 1024 and compute OCR1A such that the compare match
-  // interval equals READ_INTERVAL_SECONDS. READ_INTERVAL_SECONDS must be
-  // small enough to fit in 16-bit OCR1A with prescaler 1024 (see config.hpp).
-  noInterrupts();  // ensure atomic timer config
-  TCCR1A = 0;
-  TCCR1B = 0;
-  TCCR1B |= (1 << WGM12);  // CTC mode (Clear Timer on Compare Match)
-  // Calculate OCR1A: OCR1A = (F_CPU / prescaler) * seconds - 1
-  const unsigned long ticksPerSec = (unsigned long)(F_CPU / 1024UL);
-  const unsigned long ocr = (ticksPerSec * (unsigned long)READ_INTERVAL_SECONDS) - 1UL;
-  OCR1A = (uint16_t)ocr;
-  // set prescaler to 1024
-  TCCR1B |= (1 << CS12) | (1 << CS10);
-  // enable Output Compare A Match Interrupt
-  TIMSK1 |= (1 << OCIE1A);
-  interrupts();
-}
+  const bool fast = Boot::isFast();
+  if (fast) View::messageLineSerial(F("Fast boot"));
+  else {
+    View::initDisplay(false);
+    Boot::mark(Boot::DisplayReady);
+  }
+#if defined(LOG_EEPROM)
+  LogStore::begin();
+#endif  // LOG_EEPROM
+  if (!fast) {
+    Lib::readSensorsAndUpdateMemory();
+    Boot::mark(Boot::FirstReading);
+  }
+#if defined(LATENCY_STATS)
+  Latency::begin();
+#endif  // LATENCY_STATS
+  View::debugLine(F("starting..."));
 
-// Multiplier: how many base ticks are needed to reach the desired overall interval
-constexpr uint8_t READ_MULTIPLIER = (READ_TARGET_SECONDS + READ_INTERVAL_SECONDS - 1) / READ_INTERVAL_SECONDS;
-static_assert(READ_MULTIPLIER >= 1, "READ_MULTIPLIER calculation error");
+  // Timer1 ticks every READ_INTERVAL_SECONDS for the clock and the reads
+  Clock::begin();
+  Boot::mark(Boot::TimersStarted);
 
-// ISR-local counter (volatile, small) used to accumulate base intervals
-static volatile uint8_t timerTickCounter = 0;
+  setupTasks();
+  if (fast) {
+    Events::post(Events::ReadBoot);
+    View::initDisplay(true);
+    Boot::mark(Boot::DisplayReady);
+  }
+#if defined(WARM_RESTART)
+  if (Snapshot::restore()) View::messageLineSerial(F("Warm restart"));
+#endif  // WARM_RESTART
+}
 
-// Timer1 Compare Match A ISR: fires every READ_INTERVAL_SECONDS
+// Timer1 Compare Match A ISR: fires every READ_INTERVAL_SECONDS; reads
+// are requested every ReadRate::intervalSeconds()
 ISR(TIMER1_COMPA_vect) {
-  if (++timerTickCounter >= READ_MULTIPLIER) {
-    timerTickCounter = 0;
-    Lib::requestSensorRead();
+  Clock::tick();
+#if defined(WARM_RESTART)
+  Snapshot::tick();
+#endif  // WARM_RESTART
+  if (ReadRate::tick()) {
+    Events::push(Events::ReadTick);
   }
 }
 
 /**
  * @brief Arduino main loop.
  *
- * Continuously renders the main screen and triggers a
- * sensor read when requiered and sends the values over the configured serial outputs.
+ * Runs one scheduler pass over the tasks registered in @ref setupTasks() and
+ * sleeps until the next interrupt when nothing is pending.
  */
 void loop() {
-
-  wdt_reset();
-#if defined(SERIAL_OUT)
-  SerialController::pollSerial();
-  SerialController::processPendingCommands();
-#endif
-  if (Lib::hasSensorReadRequest()) {
-    readSensors();
-    View::valuesSerialPrint();
-    View::valuesSerialPlot();
+  {
+    LATENCY_SCOPE(Loop);
+    Scheduler::run();
   }
-  View::printMainScreen();
+#if defined(POWER_SAVE)
+  Power::idle();
+#endif  // POWER_SAVE
 }
@@ -1,4 +1,3 @@
-#include "WString.h"
 /**
  * @file SerialController.cpp
  * @brief Implementation of the non-blocking serial command controller.
@@ -11,14 +10,37 @@
 #include "SerialController.hpp"
 #include "config.hpp"
 #include "view.hpp"
+#include "history.hpp"
+#include "logstore.hpp"
+#include "nvm.hpp"
+#include "boot.hpp"
+#include "calibration.hpp"
+#include "clock.hpp"
+#include "events.hpp"
+#include "filter.hpp"
+#include "power.hpp"
+#include "readrate.hpp"
+#include "scheduler.hpp"
+#include "sensorstats.hpp"
+#include "serialout.hpp"
+#include "settings.hpp"
+#include "snapshot.hpp"
+#include "telemetry.hpp"
+#include "twi.hpp"
+#include "i2csoil.hpp"
+#include "latency.hpp"
 
 #if defined(SERIAL_IN)
 
 namespace SerialController {
 
-static char receiveBuffer[13];
+static_assert(SERIAL_LINE_LENGTH >= 44 && SERIAL_LINE_LENGTH < 255, "SERIAL_LINE_LENGTH must be 44-254 (a CAL line needs 44)");
+static char receiveBuffer[SERIAL_LINE_LENGTH + 1];
 static uint8_t receiveLength = 0;
 static bool isLineReady = false;
+static bool isLineOverflow = false;
+/** millis() when pollSerial() last took a byte. */
+static uint32_t lastRxMillis = 0;
 
 // -------- helpers --------
 static const char* trimAsciiWhitespace(const char* s, size_t& len) {
@@ -34,29 +56,37 @@ static const char* trimAsciiWhitespace(const char* s, size_t& len) {
 
 // -------- handlers --------
 /**
- * @brief Handle the T=<ms> command to set the effective time.
+ * @brief Handle T to report and T=<ms> to set the clock (@ref Clock).
  *
- * Parses a signed long integer from the argument and adjusts the global
- * millis-offset so that the effective time (Lib::getTimeOfDayAsMillis())
- * equals the provided value.
+ * The argument is the time in milliseconds since the clock origin (day 0,
+ * 00:00:00); the sub-second part is kept.
  *
- * @param arg Pointer to the ASCII argument following 'T='.
+ * @param arg Pointer to the ASCII argument following 'T=', or nullptr.
  * @return true Always returns true to indicate the command was handled
  *              (even on parse error) so the caller doesn't emit a generic
  *              "unknown command" message.
  */
 static bool handleTimeCommand(const char* arg) {
+  if (arg == nullptr) {
+    Clock::Time t = Clock::now();
+    View::messageSerial(F("T day "));
+    View::messageSerial(t.day);
+    View::messageSerial(' ');
+    View::messageSerial(Clock::text());
+    View::messageSerial(F(" s "));
+    View::messageSerial(Clock::seconds());
+    View::messageSerial(F(" ms "));
+    View::messageLineSerial(Clock::millis());
+    return true;
+  }
   char* endp;
-  long v = strtol(arg, &endp, 10);
-  if (endp != arg) {
-    // directly set the offset so effectiveTime == v
-    long newOffset = v - (long)millis();
-    Lib::setTimeOfDayMillisOffset(newOffset);
+  unsigned long v = strtoul(arg, &endp, 10);
+  if (endp != arg && *endp == '\0' && *arg != '-') {
+    Clock::setMillis(v);
 
     // report effective current time over serial
-    unsigned long effective = Lib::getTimeOfDayAsMillis();
     View::message(F("CMD ok: T -> "));
-    View::message(effective);
+    View::message(Clock::millis());
     View::messageLine(F(""));
     return true;
   }
@@ -65,9 +95,10 @@ static bool handleTimeCommand(const char* arg) {
 }
 
 /**
- * @brief Handle DISP=ON|OFF command to toggle OLED rendering.
+ * @brief Handle DISP=ON|OFF command to toggle OLED rendering, and DISP=STAT
+ * to report the display traffic counters.
  *
- * @param arg Pointer to the argument string (expected "ON" or "OFF").
+ * @param arg Pointer to the argument string (expected "ON", "OFF" or "STAT").
  * @return true Always returns true after reporting status.
  */
 static bool handleDisplayCommand(const char* arg) {
@@ -81,42 +112,623 @@ static bool handleDisplayCommand(const char* arg) {
     View::messageLine(F("CMD ok: DISP=OFF"));
     return true;
   }
-  View::messageLine(F("CMD err: DISP expects ON or OFF"));
+  if (strcmp(arg, "STAT") == 0) {
+    const View::RenderStats& st = View::renderStats();
+    View::messageSerial(F("DISP frames "));
+    View::messageSerial(st.frames);
+    View::messageSerial(F(" partial "));
+    View::messageSerial(st.partials);
+    View::messageSerial(F(" skipped "));
+    View::messageSerial(st.skipped);
+    View::messageSerial(F(" bytes "));
+    View::messageSerial(st.bytes);
+    View::messageSerial(F(" debug lines "));
+    View::messageSerial(st.debugLines);
+    View::messageSerial(F(" frames "));
+    View::messageLineSerial(st.debugFrames);
+    return true;
+  }
+  View::messageLine(F("CMD err: DISP expects ON, OFF or STAT"));
   return true;
 }
 
 /**
  * @brief Handler for READ command which requests a sensor measurement.
  *
- * The function does not perform the measurement itself; it uses
- * Lib::requestSensorRead() to notify the main loop. This keeps the
- * handler fast and non-blocking.
+ * The function does not perform the measurement itself; it queues an
+ * @ref Events::ReadCommand for the main loop. This keeps the handler fast
+ * and non-blocking.
  */
-static bool handleReadCommand(const char* /*arg*/) {
-  // Use global Lib API to request a sensor read instead of local flag
-  Lib::requestSensorRead();
+static bool handleReadCommand(const char* arg) {
+  if (arg != nullptr && strcmp(arg, "NOW") != 0) {
+    View::messageLine(F("CMD err: READ expects NOW"));
+    return true;
+  }
+  if (!Events::post(Events::ReadCommand)) {
+    View::messageLine(F("CMD err: READ queue full"));
+    return true;
+  }
   View::messageLine(F("CMD ok: READ request"));
   return true;
 }
 
+/**
+ * @brief Print the read interval and its settings as
+ * "RATE <s> s min <s> max <s> fast <pct> calm <pct> reads <n>".
+ */
+static void printRate() {
+  const ReadRate::Settings& st = ReadRate::settings();
+  View::messageSerial(F("RATE "));
+  View::messageSerial(ReadRate::intervalSeconds());
+  View::messageSerial(F(" s min "));
+  View::messageSerial(st.minSeconds);
+  View::messageSerial(F(" max "));
+  View::messageSerial(st.maxSeconds);
+  View::messageSerial(F(" fast "));
+  View::messageSerial(st.fast);
+  View::messageSerial(F(" calm "));
+  View::messageSerial(st.calm);
+  View::messageSerial(F(" reads "));
+  View::messageLineSerial(ReadRate::readings());
+}
+
+/**
+ * @brief Handler for RATE[=<min>,<max>[,<fast>,<calm>]] which shows or sets
+ * the limits (seconds) and thresholds (percent) of the adaptive read
+ * interval (@ref ReadRate).
+ */
+static bool handleRateCommand(const char* arg) {
+  if (arg == nullptr) {
+    printRate();
+    return true;
+  }
+  ReadRate::Settings st = ReadRate::settings();
+  long v[4] = {0, 0, st.fast, st.calm};
+  uint8_t count = 0;
+  bool valid = true;
+  const char* p = arg;
+  char* e;
+  for (;;) {
+    v[count] = strtol(p, &e, 10);
+    if (e == p || v[count] < 0 || v[count] > 0xFFFF) {
+      valid = false;
+      break;
+    }
+    if (++count == 4 || *e != ',') break;
+    p = e + 1;
+  }
+  st.minSeconds = (uint16_t)v[0];
+  st.maxSeconds = (uint16_t)v[1];
+  st.fast = v[2] > 100 ? 100 : (uint8_t)v[2];
+  st.calm = v[3] > 100 ? 100 : (uint8_t)v[3];
+  if (!valid || (count != 2 && count != 4) || *e != '\0' || !ReadRate::set(st)) {
+    View::messageLine(F("CMD err: RATE expects <min>,<max>[,<fast>,<calm>]"));
+    return true;
+  }
+  View::messageLine(F("CMD ok: RATE"));
+  printRate();
+  return true;
+}
+
 /**
  * @brief Handler for PRINT command which emits current values over serial.
  */
-static bool handlePrintCommand(const char* /*arg*/) {
-  View::valuesSerialPrint();
-  View::valuesSerialPlot();
+static bool handlePrintCommand(const char* arg) {
+  if (arg != nullptr && strcmp(arg, "NOW") != 0) {
+    View::messageLine(F("CMD err: PRINT expects NOW"));
+    return true;
+  }
+  View::valuesSerialSend();
   View::messageLine(F("CMD ok: PRINT"));
   return true;
 }
 
+#if defined(HISTORY)
+/**
+ * @brief Handler for HIST[=<minutes>] which queries the on-device history.
+ *
+ * Without argument it reports the fill level; with an argument it prints the
+ * sample recorded the given number of minutes ago.
+ */
+static bool handleHistoryCommand(const char* arg) {
+  if (arg == nullptr) {
+    View::messageSerial(F("HIST "));
+    View::messageSerial(History::size());
+    View::messageSerial('/');
+    View::messageSerial(History::capacity());
+    View::messageSerial(F(" samples of "));
+    View::messageSerial(HISTORY_SAMPLE_SECONDS);
+    View::messageLineSerial(F(" s"));
+    return true;
+  }
+  char* endp;
+  long minutes = strtol(arg, &endp, 10);
+  if (endp == arg || minutes < 0) {
+    View::messageLine(F("CMD err: HIST expects minutes"));
+    return true;
+  }
+  // Nothing is older than the ring plus the current period; checking first
+  // also keeps the conversion to seconds from overflowing.
+  const uint32_t maxMinutes = ((uint32_t)History::capacity() + 1) * HISTORY_SAMPLE_SECONDS / 60;
+  uint8_t values[NUM_SENSORS];
+  if ((unsigned long)minutes > maxMinutes || !History::sampleSecondsAgo((uint32_t)minutes * 60UL, values)) {
+    View::messageLine(F("CMD err: HIST no sample"));
+    return true;
+  }
+  View::messageSerial(F("HIST -"));
+  View::messageSerial(minutes);
+  View::messageSerial(F("min:"));
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    View::messageSerial(' ');
+    View::messageSerial(values[i]);
+  }
+  View::messageLineSerial(F(""));
+  return true;
+}
+#endif  // HISTORY
+
+#if defined(LOG_EEPROM)
+/**
+ * @brief Handler for LOG[=<n>] which inspects the EEPROM reading log.
+ *
+ * Without argument it reports fill level, next sequence number and the
+ * EEPROM write statistics; with an argument it prints the n-th newest record.
+ */
+static bool handleLogCommand(const char* arg) {
+  if (arg == nullptr) {
+    const Nvm::Stats& st = Nvm::stats();
+    View::messageSerial(F("LOG "));
+    View::messageSerial(LogStore::count());
+    View::messageSerial('/');
+    View::messageSerial(LogStore::capacity());
+    View::messageSerial(F(" seq "));
+    View::messageSerial(LogStore::nextSequence());
+    View::messageSerial(F(" eeprom req "));
+    View::messageSerial(st.requested);
+    View::messageSerial(F(" wr "));
+    View::messageSerial(st.written);
+    View::messageSerial(F(" skip "));
+    View::messageLineSerial(st.skipped);
+    return true;
+  }
+  char* endp;
+  long age = strtol(arg, &endp, 10);
+  LogStore::Record r;
+  if (endp == arg || age < 0 || age > 0xFFFF || !LogStore::read((uint16_t)age, r)) {
+    View::messageLine(F("CMD err: LOG no record"));
+    return true;
+  }
+  View::messageSerial(F("LOG #"));
+  View::messageSerial(r.seq);
+  View::messageSerial(F(" t="));
+  View::messageSerial(r.time);
+  View::messageSerial(':');
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    View::messageSerial(' ');
+    View::messageSerial(r.values[i]);
+  }
+  View::messageLineSerial(F(""));
+  return true;
+}
+#endif  // LOG_EEPROM
+
+#if defined(TELEMETRY_BINARY)
+/**
+ * @brief Handler for MODE=ASCII|BIN|SUM which selects the serial output
+ * format (SUM requires @ref SENSOR_STATS).
+ */
+static bool handleModeCommand(const char* arg) {
+  if (strcmp(arg, "ASCII") == 0) {
+    Telemetry::setMode(Telemetry::Ascii);
+    View::messageLine(F("CMD ok: MODE=ASCII"));
+    return true;
+  }
+  if (strcmp(arg, "BIN") == 0) {
+    View::messageLine(F("CMD ok: MODE=BIN"));
+    Telemetry::setMode(Telemetry::Binary);
+    return true;
+  }
+#if defined(SENSOR_STATS)
+  if (strcmp(arg, "SUM") == 0) {
+    View::messageLine(F("CMD ok: MODE=SUM"));
+    Telemetry::setMode(Telemetry::Summary);
+    return true;
+  }
+  View::messageLine(F("CMD err: MODE expects ASCII, BIN or SUM"));
+#else
+  View::messageLine(F("CMD err: MODE expects ASCII or BIN"));
+#endif  // SENSOR_STATS
+  return true;
+}
+#endif  // TELEMETRY_BINARY
+
+#if defined(SENSOR_STATS)
+/**
+ * @brief Print @p value given in 1/256 with two decimals.
+ */
+static void printFixed8(uint32_t value) {
+  uint32_t hundredths = (value * 100UL + 128) >> 8;
+  View::messageSerial(hundredths / 100);
+  View::messageSerial('.');
+  uint8_t rest = (uint8_t)(hundredths % 100);
+  if (rest < 10) View::messageSerial('0');
+  View::messageSerial(rest);
+}
+
+/** Print " <label> <min>-<max>", or "-" for an empty window. */
+static void printExtremes(const __FlashStringHelper* label, uint8_t min, uint8_t max) {
+  View::messageSerial(label);
+  if (min == SensorStats::EMPTY_MIN) {
+    View::messageSerial('-');
+    return;
+  }
+  View::messageSerial(min);
+  View::messageSerial('-');
+  View::messageSerial(max);
+}
+
+/**
+ * @brief Handler for SUMMARY[=RESET] which prints the statistics of
+ * @ref SensorStats, one line per sensor.
+ */
+static bool handleSummaryCommand(const char* arg) {
+  if (arg != nullptr) {
+    if (strcmp(arg, "RESET") != 0) {
+      View::messageLine(F("CMD err: SUMMARY expects RESET"));
+      return true;
+    }
+    SensorStats::reset();
+    View::messageLine(F("CMD ok: SUMMARY=RESET"));
+    return true;
+  }
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    const SensorStats::Summary sum = SensorStats::summary(i);
+    View::messageSerial(F("SUMMARY "));
+    View::messageSerial(Lib::getSensorName(i));
+    View::messageSerial(F(" n "));
+    View::messageSerial(sum.count);
+    View::messageSerial(F(" mean "));
+    printFixed8(sum.mean);
+    View::messageSerial(F(" var "));
+    printFixed8(sum.variance);
+    View::messageSerial(F(" ema "));
+    printFixed8(sum.ema);
+    printExtremes(F(" 1h "), sum.hourMin, sum.hourMax);
+    printExtremes(F(" 24h "), sum.dayMin, sum.dayMax);
+    View::messageLineSerial(F(""));
+  }
+  return true;
+}
+#endif  // SENSOR_STATS
+
+#if defined(LATENCY_STATS)
+/**
+ * @brief Handler for TASKS[=RESET] which reports the scheduler statistics.
+ *
+ * Prints one line per task in priority order: runs, budget overruns,
+ * deadline misses, worst start latency and worst run time (microseconds).
+ */
+static bool handleTasksCommand(const char* arg) {
+  if (arg != nullptr) {
+    if (strcmp(arg, "RESET") != 0) {
+      View::messageLine(F("CMD err: TASKS expects RESET"));
+      return true;
+    }
+    Scheduler::resetStats();
+    View::messageLine(F("CMD ok: TASKS=RESET"));
+    return true;
+  }
+  for (uint8_t i = 0; i < Scheduler::count(); i++) {
+    const Scheduler::TaskStats& st = Scheduler::stats(i);
+    View::messageSerial(F("TASK "));
+    View::messageSerial(Scheduler::name(i));
+    View::messageSerial(F(" runs "));
+    View::messageSerial(st.runs);
+    View::messageSerial(F(" over "));
+    View::messageSerial(st.overruns);
+    View::messageSerial(F(" miss "));
+    View::messageSerial(st.deadlineMisses);
+    View::messageSerial(F(" lat "));
+    View::messageSerial(st.worstLatencyUs);
+    View::messageSerial(F(" run "));
+    View::messageLineSerial(st.worstRunUs);
+  }
+  return true;
+}
+#endif  // LATENCY_STATS
+
+/**
+ * @brief Print the active calibration curve of @p sensor as
+ * "CAL <s>: <raw>:<pct> ...".
+ */
+static void printCalibration(uint8_t sensor) {
+  Calibration::Point points[CAL_MAX_POINTS];
+  uint8_t count = Calibration::points(sensor, points);
+  View::messageSerial(F("CAL "));
+  View::messageSerial(sensor);
+  View::messageSerial(':');
+  for (uint8_t i = 0; i < count; i++) {
+    View::messageSerial(' ');
+    View::messageSerial(points[i].raw);
+    View::messageSerial(':');
+    View::messageSerial(points[i].pct);
+  }
+  View::messageLineSerial(F(""));
+}
+
+/**
+ * @brief Handler for CAL[=<s>[,<raw>:<pct>...|,DEFAULT]].
+ *
+ * Without argument all curves are printed, with a sensor index only that
+ * one. A list of 2 to CAL_MAX_POINTS points with increasing raw values
+ * replaces the curve of the sensor; DEFAULT restores the built-in one.
+ */
+static bool handleCalibrationCommand(const char* arg) {
+  if (arg == nullptr) {
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) printCalibration(i);
+    return true;
+  }
+  char* endp;
+  long sensor = strtol(arg, &endp, 10);
+  if (endp == arg || sensor < 0 || sensor >= NUM_SENSORS) {
+    View::messageLine(F("CMD err: CAL expects sensor index"));
+    return true;
+  }
+  if (*endp == '\0') {
+    printCalibration((uint8_t)sensor);
+    return true;
+  }
+  if (strcmp(endp, ",DEFAULT") == 0) {
+    Calibration::loadDefault((uint8_t)sensor);
+    View::messageLine(F("CMD ok: CAL"));
+    printCalibration((uint8_t)sensor);
+    return true;
+  }
+
+  Calibration::Point points[CAL_MAX_POINTS];
+  uint8_t count = 0;
+  const char* p = endp;
+  while (*p == ',' && count < CAL_MAX_POINTS) {
+    char* e;
+    long raw = strtol(p + 1, &e, 10);
+    if (e == p + 1 || *e != ':') break;
+    const char* q = e + 1;
+    long pct = strtol(q, &e, 10);
+    if (e == q || raw < 0 || raw > 1023 || pct < 0 || pct > 100) break;
+    points[count].raw = (uint16_t)raw;
+    points[count].pct = (uint8_t)pct;
+    count++;
+    p = e;
+  }
+  if (*p != '\0' || !Calibration::load((uint8_t)sensor, points, count)) {
+    View::messageLine(F("CMD err: CAL expects <raw>:<pct> points"));
+    return true;
+  }
+  View::messageLine(F("CMD ok: CAL"));
+  printCalibration((uint8_t)sensor);
+  return true;
+}
+
+#if defined(POWER_SAVE)
+/**
+ * @brief Handler for POWER[=RESET] which reports the time spent awake and
+ * asleep.
+ */
+static bool handlePowerCommand(const char* arg) {
+  if (arg != nullptr) {
+    if (strcmp(arg, "RESET") != 0) {
+      View::messageLine(F("CMD err: POWER expects RESET"));
+      return true;
+    }
+    Power::resetStats();
+    View::messageLine(F("CMD ok: POWER=RESET"));
+    return true;
+  }
+  Power::Stats st = Power::stats();
+  uint32_t asleep = st.idleMs + st.adcMs;
+  uint32_t awake = st.totalMs > asleep ? st.totalMs - asleep : 0;
+  View::messageSerial(F("POWER awake "));
+  View::messageSerial(awake);
+  View::messageSerial(F(" ms idle "));
+  View::messageSerial(st.idleMs);
+  View::messageSerial(F(" ms adc "));
+  View::messageSerial(st.adcMs);
+  View::messageSerial(F(" ms duty "));
+  View::messageSerial(st.totalMs ? (uint8_t)((uint64_t)awake * 100 / st.totalMs) : 100);
+  View::messageLineSerial('%');
+  return true;
+}
+#endif  // POWER_SAVE
+
+/**
+ * @brief Handler for EVENTS[=RESET] which reports the counters of the
+ * interrupt-to-loop event ring (@ref Events).
+ */
+static bool handleEventsCommand(const char* arg) {
+  if (arg != nullptr) {
+    if (strcmp(arg, "RESET") != 0) {
+      View::messageLine(F("CMD err: EVENTS expects RESET"));
+      return true;
+    }
+    Events::resetStats();
+    View::messageLine(F("CMD ok: EVENTS=RESET"));
+    return true;
+  }
+  const Events::Stats st = Events::stats();
+  View::messageSerial(F("EVENTS pushed "));
+  View::messageSerial(st.pushed);
+  View::messageSerial(F(" taken "));
+  View::messageSerial(st.taken);
+  View::messageSerial(F(" overflow "));
+  View::messageSerial(st.overflows);
+  View::messageSerial(F(" coalesced "));
+  View::messageSerial(st.coalesced);
+  View::messageSerial(F(" peak "));
+  View::messageSerial(st.peak);
+  View::messageSerial('/');
+  View::messageLineSerial(EVENT_QUEUE_SIZE);
+  return true;
+}
+
+/** Print " <name> <us>" for one boot phase. */
+static void printBootPhase(const __FlashStringHelper* name, Boot::Phase phase) {
+  View::messageSerial(name);
+  if (Boot::reached(phase)) View::messageSerial(Boot::elapsedUs(phase));
+  else View::messageSerial('-');
+}
+
+/**
+ * @brief Handler for BOOT which reports the boot path ("warm" if the
+ * @ref Snapshot was taken over), the reset cause and when each boot phase
+ * was reached, in microseconds after the start of
+ * setup() ("-" for a phase not reached yet).
+ */
+static bool handleBootCommand(const char* /*arg*/) {
+  View::messageSerial(Boot::isFast() ? F("BOOT fast") : F("BOOT normal"));
+#if defined(WARM_RESTART)
+  if (Snapshot::restored()) View::messageSerial(F(" warm"));
+#endif  // WARM_RESTART
+  View::messageSerial(F(" MCUSR 0x"));
+  SerialOut::printHex(Boot::resetFlags(), SerialOut::Reply);
+  printBootPhase(F(" serial "), Boot::SerialReady);
+  printBootPhase(F(" display "), Boot::DisplayReady);
+  printBootPhase(F(" timers "), Boot::TimersStarted);
+  printBootPhase(F(" reading "), Boot::FirstReading);
+  View::messageLineSerial(F(" us"));
+  return true;
+}
+
+/**
+ * @brief Handler for SERIAL which reports the statistics of the serial
+ * output ring (@ref SerialOut).
+ */
+static bool handleSerialCommand(const char* /*arg*/) {
+  const SerialOut::Stats& st = SerialOut::stats();
+  View::messageSerial(F("SERIAL bytes "));
+  View::messageSerial(st.bytes);
+  View::messageSerial(F(" deferred "));
+  View::messageSerial(st.deferred);
+  View::messageSerial(F(" dropped "));
+  View::messageSerial(st.dropped);
+  View::messageSerial(F(" stall "));
+  View::messageSerial(st.stallUs);
+  View::messageSerial(F(" us peak "));
+  View::messageLineSerial(st.peak);
+  return true;
+}
+
+#if defined(LATENCY_STATS)
+/**
+ * @brief Handler for STATS[=RESET] which prints the latency histograms of
+ * @ref Latency, one line per stage.
+ */
+static bool handleStatsCommand(const char* arg) {
+  if (arg != nullptr) {
+    if (strcmp(arg, "RESET") != 0) {
+      View::messageLine(F("CMD err: STATS expects RESET"));
+      return true;
+    }
+    Latency::reset();
+    View::messageLine(F("CMD ok: STATS=RESET"));
+    return true;
+  }
+  View::messageSerial(F("STATS overhead "));
+  View::messageSerial(Latency::overheadUs());
+  View::messageLineSerial(F(" us"));
+  for (uint8_t i = 0; i < Latency::NUM_STAGES; i++) {
+    const Latency::Histogram& h = Latency::histogram((Latency::Stage)i);
+    View::messageSerial(F("STATS "));
+    View::messageSerial(Latency::name((Latency::Stage)i));
+    View::messageSerial(F(" n "));
+    View::messageSerial(h.count);
+    View::messageSerial(F(" min "));
+    View::messageSerial(h.count ? h.minUs : 0);
+    View::messageSerial(F(" max "));
+    View::messageSerial(h.maxUs);
+    View::messageSerial(F(" us log2"));
+    for (uint8_t b = 0; b < Latency::BINS; b++) {
+      View::messageSerial(' ');
+      View::messageSerial(h.bins[b]);
+    }
+    View::messageLineSerial(F(""));
+  }
+  return true;
+}
+#endif  // LATENCY_STATS
+
+#if defined(TWI_ASYNC)
+/**
+ * @brief Handler for I2C which reports the bus statistics of @ref Twi.
+ */
+static bool handleI2cCommand(const char* /*arg*/) {
+  const Twi::Stats& st = Twi::stats();
+  View::messageSerial(F("I2C xfer "));
+  View::messageSerial(st.transfers);
+  View::messageSerial(F(" bytes "));
+  View::messageSerial(st.bytes);
+  View::messageSerial(F(" nack "));
+  View::messageSerial(st.nacks);
+  View::messageSerial(F(" err "));
+  View::messageSerial(st.errors);
+  View::messageSerial(F(" recover "));
+  View::messageSerial(st.recoveries);
+  View::messageSerial(F(" wait "));
+  View::messageSerial(st.waitUs);
+#if defined(SENSOR_I2C)
+  View::messageSerial(F(" us soil err "));
+  View::messageLineSerial(I2cSoil::errors());
+#else
+  View::messageLineSerial(F(" us"));
+#endif  // SENSOR_I2C
+  return true;
+}
+#endif  // TWI_ASYNC
+
 static void printHelpCommands() {
   View::debugLine(F("Sending Command List!"));
-  View::messageLineSerial(F("Commands:"));
-  View::messageLineSerial(F("  T=<ms>        set time offset in ms"));
+  View::messageLineSerial(F("Commands (several per line separated by ';'):"));
+  View::messageLineSerial(F("  T[=<ms>]      show/set clock (ms since day 0)"));
   View::messageLineSerial(F("  DISP=ON|OFF   enable/disable display"));
+  View::messageLineSerial(F("  DISP=STAT     display frame/byte counters"));
   View::messageLineSerial(F("  CONTRAST=<v>  set OLED contrast (0-255)"));
   View::messageLineSerial(F("  READ[=NOW]    trigger immediate sensor read"));
   View::messageLineSerial(F("  PRINT[=NOW]   print current values"));
+  View::messageLineSerial(F("  RATE[=<min>,<max>[,<fast>,<calm>]]  show/set read interval"));
+  View::messageLineSerial(F("  CAL[=<s>[,<raw>:<pct>..]]  show/set calibration"));
+  View::messageLineSerial(F("  CFG[=<key>[=<v>]|SAVE|DEFAULTS]  show/set/save runtime config"));
+#if defined(POWER_SAVE)
+  View::messageLineSerial(F("  POWER[=RESET]  awake/asleep time"));
+#endif
+  View::messageLineSerial(F("  SERIAL        serial output statistics"));
+  View::messageLineSerial(F("  EVENTS[=RESET]  interrupt event queue counters"));
+  View::messageLineSerial(F("  BOOT          boot path and phase times"));
+#if defined(LATENCY_STATS)
+  View::messageLineSerial(F("  STATS[=RESET]  loop/stage latency histograms"));
+  View::messageLineSerial(F("  TASKS[=RESET]  scheduler statistics"));
+#endif
+#if defined(TWI_ASYNC)
+  View::messageLineSerial(F("  I2C           I2C bus statistics"));
+#endif
+#if defined(HISTORY)
+  View::messageLineSerial(F("  HIST[=<min>]  history fill / sample <min> ago"));
+#endif
+#if defined(LOG_EEPROM)
+  View::messageLineSerial(F("  LOG[=<n>]     EEPROM log status / n-th newest record"));
+#endif
+#if defined(SENSOR_STATS)
+  View::messageLineSerial(F("  SUMMARY[=RESET]  per-sensor mean/variance/min/max"));
+#endif
+#if defined(TELEMETRY_BINARY) && defined(SENSOR_STATS)
+  View::messageLineSerial(F("  MODE=ASCII|BIN|SUM  select text, binary readings or summaries"));
+#elif defined(TELEMETRY_BINARY)
+  View::messageLineSerial(F("  MODE=ASCII|BIN  select text or binary readings"));
+#endif
+}
+
+/** Handler for HELP. */
+static bool handleHelpCommand(const char* /*arg*/) {
+  printHelpCommands();
+  return true;
 }
 
 /**
@@ -136,33 +748,337 @@ static bool handleContrastCommand(const char* arg) {
   return true;
 }
 
-static bool dispatchCommandLine(const char* line) {
-  size_t len = strlen(line);
-  const char* p = trimAsciiWhitespace(line, len);
+/** Print "CFG NAME<s> <name>". */
+static void printConfigName(uint8_t sensor) {
+  View::messageSerial(F("CFG NAME"));
+  View::messageSerial(sensor);
+  View::messageSerial(' ');
+  View::messageLineSerial(Lib::getSensorName(sensor));
+}
+
+#if defined(SAMPLE_FILTER)
+/** Print "CFG FILTER<s> <mode>". */
+static void printConfigFilter(uint8_t sensor) {
+  View::messageSerial(F("CFG FILTER"));
+  View::messageSerial(sensor);
+  View::messageSerial(' ');
+  View::messageLineSerial(Filter::modeName((Filter::Mode)Settings::values().filter[sensor]));
+}
+#endif  // SAMPLE_FILTER
+
+/** Print "CFG AVG <n>", followed by " fixed" if the build sets the count. */
+static void printConfigAverage() {
+  View::messageSerial(F("CFG AVG "));
+  if (Settings::averageOfFixed()) {
+    View::messageSerial(Settings::samplesPerReading());
+    View::messageLineSerial(F(" fixed"));
+    return;
+  }
+  View::messageLineSerial(Settings::values().averageOf);
+}
+
+/** Print "CFG CONTRAST <v>". */
+static void printConfigContrast() {
+  View::messageSerial(F("CFG CONTRAST "));
+  View::messageLineSerial(View::displayContrast());
+}
+
+/** Print "CFG RATE <min>,<max>,<fast>,<calm>" in the form RATE= takes. */
+static void printConfigRate() {
+  const ReadRate::Settings& st = ReadRate::settings();
+  View::messageSerial(F("CFG RATE "));
+  View::messageSerial(st.minSeconds);
+  View::messageSerial(',');
+  View::messageSerial(st.maxSeconds);
+  View::messageSerial(',');
+  View::messageSerial(st.fast);
+  View::messageSerial(',');
+  View::messageLineSerial(st.calm);
+}
 
-  if (len == 0) return true;
+/**
+ * @brief Print "CFG v<version> <bytes> bytes from EEPROM|defaults,
+ * saved|unsaved|saving".
+ */
+static void printConfigStatus() {
+  View::messageSerial(F("CFG v"));
+  View::messageSerial(Settings::VERSION);
+  View::messageSerial(' ');
+  View::messageSerial(Settings::recordBytes());
+  View::messageSerial(Settings::source() == Settings::Stored ? F(" bytes from EEPROM, ") : F(" bytes from defaults, "));
+  if (Settings::isSaving()) View::messageLineSerial(F("saving"));
+  else View::messageLineSerial(Settings::isSaved() ? F("saved") : F("unsaved"));
+}
 
-  if (strcmp(p, "HELP") == 0) {
-    printHelpCommands();
+/**
+ * @brief Sensor index of a "<prefix><s>" key of length @p len, or
+ * @ref NUM_SENSORS if @p key is none.
+ */
+static uint8_t configSensorIndex(const char* key, uint8_t len, const char* prefix) {
+  const uint8_t prefixLength = (uint8_t)strlen(prefix);
+  if (len <= prefixLength || strncmp(key, prefix, prefixLength) != 0) return NUM_SENSORS;
+  uint8_t sensor = 0;
+  for (uint8_t i = prefixLength; i < len; i++) {
+    if (key[i] < '0' || key[i] > '9') return NUM_SENSORS;
+    sensor = (uint8_t)(sensor * 10 + (key[i] - '0'));
+    if (sensor >= NUM_SENSORS) return NUM_SENSORS;
+  }
+  return sensor;
+}
+
+/**
+ * @brief Handler for CFG[=GET|SAVE|DEFAULTS|<key>[=<value>]] which shows,
+ * changes and saves the runtime configuration (@ref Settings).
+ *
+ * The keys are NAME<s> (1 to 11 printable characters), AVG (samples per
+ * reading, 1-64; shown as fixed and not settable when the build sets the
+ * count), CONTRAST and RATE (as the commands of the same name), and
+ * with @ref SAMPLE_FILTER FILTER<s> (MEAN, MEDIAN, TRIM or HAMPEL).
+ * Changes take effect at once and are kept in SRAM until SAVE writes them
+ * to EEPROM in the background, together with the calibration; DEFAULTS
+ * returns to the compile-time values without saving.
+ */
+static bool handleConfigCommand(const char* arg) {
+  if (arg == nullptr || strcmp(arg, "GET") == 0) {
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) printConfigName(i);
+#if defined(SAMPLE_FILTER)
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) printConfigFilter(i);
+#endif  // SAMPLE_FILTER
+    printConfigAverage();
+    printConfigContrast();
+    printConfigRate();
+    printConfigStatus();
+    return true;
+  }
+  if (strcmp(arg, "SAVE") == 0 || strcmp(arg, "DEFAULTS") == 0) {
+    bool ok = arg[0] == 'S' ? Settings::save() : Settings::loadDefaults();
+    if (!ok) View::messageLine(F("CMD err: CFG save in progress"));
+    else View::messageLine(arg[0] == 'S' ? F("CMD ok: CFG=SAVE") : F("CMD ok: CFG=DEFAULTS"));
     return true;
   }
 
-  if (len >= 2 && p[0] == 'T' && p[1] == '=') {
-    return handleTimeCommand(p + 2);
+  const char* eq = strchr(arg, '=');
+  const uint8_t len = (uint8_t)(eq ? eq - arg : strlen(arg));
+  const char* value = eq ? eq + 1 : nullptr;
+  uint8_t sensor = configSensorIndex(arg, len, "NAME");
+  if (sensor < NUM_SENSORS) {
+    if (value && !Settings::setName(sensor, value)) {
+      View::messageLine(F("CMD err: CFG NAME expects 1-11 printable characters"));
+      return true;
+    }
+    printConfigName(sensor);
+    return true;
+  }
+#if defined(SAMPLE_FILTER)
+  sensor = configSensorIndex(arg, len, "FILTER");
+  if (sensor < NUM_SENSORS) {
+    if (value && !Settings::setFilter(sensor, Filter::parseMode(value))) {
+      View::messageLine(F("CMD err: CFG FILTER expects MEAN, MEDIAN, TRIM or HAMPEL"));
+      return true;
+    }
+    printConfigFilter(sensor);
+    return true;
   }
-  if (len >= 5 && strncmp(p, "DISP=", 5) == 0) {
-    return handleDisplayCommand(p + 5);
+#endif  // SAMPLE_FILTER
+  if (len == 3 && strncmp(arg, "AVG", 3) == 0) {
+    if (value && Settings::averageOfFixed()) {
+      View::messageLine(F("CMD err: CFG AVG fixed by ADC_OVERSAMPLE or SAMPLE_FILTER"));
+      return true;
+    }
+    char* endp = nullptr;
+    long v = value ? strtol(value, &endp, 10) : 0;
+    if (value && (endp == value || *endp != '\0' || v < 1 || v > Settings::MAX_AVERAGE_OF
+                  || !Settings::setAverageOf((uint8_t)v))) {
+      View::messageLine(F("CMD err: CFG AVG expects 1-64"));
+      return true;
+    }
+    printConfigAverage();
+    return true;
+  }
+  if (len == 8 && strncmp(arg, "CONTRAST", 8) == 0) {
+    if (value) return handleContrastCommand(value);
+    printConfigContrast();
+    return true;
+  }
+  if (len == 4 && strncmp(arg, "RATE", 4) == 0) {
+    if (value) return handleRateCommand(value);
+    printConfigRate();
+    return true;
+  }
+  View::messageLine(F("CMD err: CFG expects GET, SAVE, DEFAULTS or NAME<s>, AVG, CONTRAST, RATE"));
+  return true;
+}
+
+// -------- command table --------
+/**
+ * @brief Hash of a command keyword (djb2 with XOR, 16 bit). The table
+ * stores it precomputed, @ref keywordHash() computes the same at runtime.
+ */
+constexpr uint16_t commandHash(const char* s, uint16_t h = 5381) {
+  return *s ? commandHash(s + 1, (uint16_t)(((uint16_t)(h << 5) + h) ^ (uint8_t)*s)) : h;
+}
+
+static uint16_t keywordHash(const char* s, uint8_t len) {
+  uint16_t h = 5381;
+  while (len--) h = (uint16_t)((uint16_t)(h << 5) + h) ^ (uint8_t)*s++;
+  return h;
+}
+
+/** Argument schema of a command: which of KEYWORD and KEYWORD=<arg> it takes. */
+enum ArgSchema : uint8_t {
+  ArgNone,      ///< KEYWORD only
+  ArgRequired,  ///< KEYWORD=<arg> only
+  ArgOptional   ///< both; the handler gets nullptr without argument
+};
+
+/** Longest command keyword, without the terminator. */
+constexpr uint8_t KEYWORD_LENGTH = 8;
+
+/**
+ * @brief One entry of the command table. The table lives in flash and is
+ * searched by hash; the keyword is compared once to rule out collisions.
+ */
+struct Command {
+  char keyword[KEYWORD_LENGTH + 1];
+  uint16_t hash;
+  ArgSchema schema;
+  bool (*handler)(const char* arg);
+};
+
+#define COMMAND(keyword, schema, handler) { keyword, commandHash(keyword), schema, handler }
+static constexpr Command COMMANDS[] PROGMEM = {
+  COMMAND("HELP", ArgNone, handleHelpCommand),
+  COMMAND("T", ArgOptional, handleTimeCommand),
+  COMMAND("DISP", ArgRequired, handleDisplayCommand),
+  COMMAND("CONTRAST", ArgRequired, handleContrastCommand),
+  COMMAND("READ", ArgOptional, handleReadCommand),
+  COMMAND("PRINT", ArgOptional, handlePrintCommand),
+  COMMAND("RATE", ArgOptional, handleRateCommand),
+  COMMAND("CAL", ArgOptional, handleCalibrationCommand),
+  COMMAND("CFG", ArgOptional, handleConfigCommand),
+#if defined(POWER_SAVE)
+  COMMAND("POWER", ArgOptional, handlePowerCommand),
+#endif  // POWER_SAVE
+  COMMAND("SERIAL", ArgNone, handleSerialCommand),
+  COMMAND("EVENTS", ArgOptional, handleEventsCommand),
+  COMMAND("BOOT", ArgNone, handleBootCommand),
+#if defined(LATENCY_STATS)
+  COMMAND("STATS", ArgOptional, handleStatsCommand),
+  COMMAND("TASKS", ArgOptional, handleTasksCommand),
+#endif  // LATENCY_STATS
+#if defined(TWI_ASYNC)
+  COMMAND("I2C", ArgNone, handleI2cCommand),
+#endif  // TWI_ASYNC
+#if defined(HISTORY)
+  COMMAND("HIST", ArgOptional, handleHistoryCommand),
+#endif  // HISTORY
+#if defined(LOG_EEPROM)
+  COMMAND("LOG", ArgOptional, handleLogCommand),
+#endif  // LOG_EEPROM
+#if defined(TELEMETRY_BINARY)
+  COMMAND("MODE", ArgRequired, handleModeCommand),
+#endif  // TELEMETRY_BINARY
+#if defined(SENSOR_STATS)
+  COMMAND("SUMMARY", ArgOptional, handleSummaryCommand),
+#endif  // SENSOR_STATS
+};
+#undef COMMAND
+
+constexpr uint8_t NUM_COMMANDS = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+/** True if no entry after @p i shares the hash of entry @p i. */
+constexpr bool hashUniqueFrom(uint8_t i, uint8_t j) {
+  return j >= NUM_COMMANDS || (COMMANDS[i].hash != COMMANDS[j].hash && hashUniqueFrom(i, j + 1));
+}
+
+constexpr bool hashesUnique(uint8_t i = 0) {
+  return i >= NUM_COMMANDS || (hashUniqueFrom(i, i + 1) && hashesUnique(i + 1));
+}
+
+static_assert(hashesUnique(), "Command keywords collide in commandHash(); rename one");
+
+/**
+ * @brief Find the table entry of the @p keywordLength characters at @p cmd.
+ * @return nullptr if the keyword is unknown.
+ */
+static const Command* findCommand(const char* cmd, uint8_t keywordLength) {
+  if (keywordLength > KEYWORD_LENGTH) return nullptr;
+  uint16_t hash = keywordHash(cmd, keywordLength);
+
+  for (uint8_t i = 0; i < NUM_COMMANDS; i++) {
+    const Command* entry = &COMMANDS[i];
+    if (pgm_read_word(&entry->hash) != hash) continue;
+    const char* keyword = entry->keyword;
+    if (strncmp_P(cmd, keyword, keywordLength) != 0 || pgm_read_byte(&keyword[keywordLength]) != '\0') return nullptr;
+    return entry;
   }
-  if (len >= 9 && strncmp(p, "CONTRAST=", 9) == 0) {
-    return handleContrastCommand(p + 9);
+  return nullptr;
+}
+
+/**
+ * @brief Look up and run one command ("KEYWORD" or "KEYWORD=<arg>").
+ * @param cmd NUL-terminated command, trimmed.
+ * @return false if the keyword is unknown.
+ */
+static bool dispatchCommand(const char* cmd) {
+  const char* eq = strchr(cmd, '=');
+  const Command* entry = findCommand(cmd, eq ? (uint8_t)(eq - cmd) : (uint8_t)strlen(cmd));
+  if (!entry) return false;
+
+  ArgSchema schema = (ArgSchema)pgm_read_byte(&entry->schema);
+  if ((eq && schema == ArgNone) || (!eq && schema == ArgRequired)) {
+    View::message(F("CMD err: "));
+    View::message(reinterpret_cast<const __FlashStringHelper*>(entry->keyword));
+    View::messageLine(eq ? F(" takes no argument") : F(" expects an argument"));
+    return true;
   }
-  if (strcmp(p, "READ") == 0 || strcmp(p, "READ=NOW") == 0) {
-    return handleReadCommand(nullptr);
+  bool (*handler)(const char*) = reinterpret_cast<bool (*)(const char*)>(pgm_read_ptr(&entry->handler));
+  return handler(eq ? eq + 1 : nullptr);
+}
+
+#if !defined(ARDUINO)
+uint8_t commandCount() {
+  return NUM_COMMANDS;
+}
+
+const char* commandKeyword(uint8_t i) {
+  return COMMANDS[i].keyword;
+}
+
+int8_t findByHash(const char* keyword, uint8_t len) {
+  const Command* entry = findCommand(keyword, len);
+  return entry ? (int8_t)(entry - COMMANDS) : -1;
+}
+
+int8_t findByScan(const char* keyword, uint8_t len) {
+  for (uint8_t i = 0; i < NUM_COMMANDS; i++) {
+    const char* k = COMMANDS[i].keyword;
+    if (strncmp_P(keyword, k, len) == 0 && pgm_read_byte(&k[len]) == '\0') return (int8_t)i;
   }
-  if (strcmp(p, "PRINT") == 0 || strcmp(p, "PRINT=NOW") == 0) {
-    return handlePrintCommand(nullptr);
+  return -1;
+}
+#endif  // !ARDUINO
+
+/**
+ * @brief Run every ';'-separated command of @p line in order.
+ *
+ * Each command gets its own reply; an unknown one is reported and the rest
+ * of the line still runs.
+ */
+static void dispatchCommandLine(char* line) {
+  char* cmd = line;
+  while (cmd) {
+    char* next = strchr(cmd, ';');
+    if (next) *next++ = '\0';
+    size_t len = strlen(cmd);
+    const char* p = trimAsciiWhitespace(cmd, len);
+    cmd = next;
+    if (len == 0) continue;
+    const_cast<char*>(p)[len] = '\0';
+    if (!dispatchCommand(p)) {
+      View::messageLine(F("CMD err: unknown"));
+    }
   }
-  return false;
 }
 
 /**
@@ -170,11 +1086,14 @@ static bool dispatchCommandLine(const char* line) {
  *
  * This function is non-blocking and intended to be called frequently from
  * the main loop. Carriage-returns are ignored; LF marks line completion.
- * Buffer overflow resets the input buffer to avoid ambiguous states.
+ * A line longer than @ref SERIAL_LINE_LENGTH is dropped up to its LF and
+ * reported, so no partial command is run.
  */
 void pollSerial() {
 #if defined(SERIAL_OUT)
+  LATENCY_SCOPE(SerialPoll);
   while (Serial.available()) {
+    lastRxMillis = millis();
     char c = (char)Serial.read();
     if (c == '\r') continue;  // ignore CR
     if (c == '\n') {          // line complete
@@ -185,28 +1104,37 @@ void pollSerial() {
     if ((size_t)receiveLength + 1 < sizeof(receiveBuffer)) {
       receiveBuffer[receiveLength++] = c;
     } else {
-      // overflow: reset to avoid partial/ambiguous commands
-      receiveLength = 0;
+      // overflow: drop the rest of the line to avoid partial/ambiguous commands
+      isLineOverflow = true;
     }
   }
 #endif  // SERIAL_OUT
 }
 
+bool isReceiving() {
+  return receiveLength > 0 || isLineReady || (uint32_t)millis() - lastRxMillis < ADC_SLEEP_RX_QUIET_MS;
+}
+
 /**
- * @brief If a full line is available, parse and execute the command.
+ * @brief If a full line is available, parse and execute its commands.
  *
  * Produces user-visible output for both success and error cases.
  */
 void processPendingCommands() {
   if (!isLineReady) return;
 
-  bool handled = dispatchCommandLine(receiveBuffer);
-  if (!handled) {
-    View::messageLine(F("CMD err: unknown"));
+  if (isLineOverflow) {
+    View::messageLine(F("CMD err: line too long"));
+  } else {
+    dispatchCommandLine(receiveBuffer);
+#if defined(WARM_RESTART)
+    Snapshot::save();  // keep settings changed by the commands
+#endif  // WARM_RESTART
   }
   // Reset input state
   receiveLength = 0;
   isLineReady = false;
+  isLineOverflow = false;
 }
 
 }  // namespace SerialController
@@ -11,7 +11,7 @@
  */
 #pragma once
 
-#include <Arduino.h>
+#include "hal.hpp"
 
 /**
  * @defgroup serial_ctrl Serial Controller
@@ -35,7 +35,8 @@ void initialize();
  * This function is non-blocking and intended to be called frequently (each
  * iteration of the Arduino @c loop()). When a full line (terminated by @c \n)
  * has been received, it is buffered for later processing by @ref process().
- * Carriage returns (@c \r) are ignored. Buffer overflow resets the line.
+ * Carriage returns (@c \r) are ignored. A line longer than
+ * @ref SERIAL_LINE_LENGTH is dropped and reported.
  *
  * @ingroup serial_ctrl
  */
@@ -45,11 +46,45 @@ void pollSerial();
  * @brief Parse and execute a complete received command line, if available.
  *
  * This function is non-blocking. If a line was completed previously by
- * @ref pollSerial(), it is dispatched here. Unknown commands produce an error
- * message.
+ * @ref pollSerial(), its ';'-separated commands are dispatched here in
+ * order. Unknown commands produce an error message.
  *
  * @ingroup serial_ctrl
  */
 void processPendingCommands();
 
+/**
+ * @brief Query whether a command line is being received: part of a line is
+ * buffered, or a byte arrived less than @ref ADC_SLEEP_RX_QUIET_MS ago.
+ *
+ * @ingroup serial_ctrl
+ */
+bool isReceiving();
+
+#if !defined(ARDUINO)
+/**
+ * @brief Number of entries in the command table (host builds only).
+ */
+uint8_t commandCount();
+
+/**
+ * @brief Keyword of table entry @p i (host builds only).
+ */
+const char* commandKeyword(uint8_t i);
+
+/**
+ * @brief Find @p keyword (@p len characters) by hash, as the dispatcher does
+ * (host builds only).
+ * @return Table index, or -1 if unknown.
+ */
+int8_t findByHash(const char* keyword, uint8_t len);
+
+/**
+ * @brief Find @p keyword by comparing it with every entry in turn, as the
+ * former strcmp chain did (host builds only, for comparison).
+ * @return Table index, or -1 if unknown.
+ */
+int8_t findByScan(const char* keyword, uint8_t len);
+#endif  // !ARDUINO
+
 }  // namespace SerialController
\ No newline at end of file
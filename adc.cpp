@@ -0,0 +1,204 @@
+/**
+ * @file adc.cpp
+ * @brief Implementation of the interrupt-driven ADC sampling engine.
+ */
+#include "adc.hpp"
+#include "config.hpp"
+#include "hal.hpp"
+#include "filter.hpp"
+#include "i2csoil.hpp"
+#include "settings.hpp"
+
+namespace Adc {
+
+/** Engine state; only the ISR moves Running -> Done, only the loop leaves Done. */
+enum State : uint8_t {
+  Idle,
+  Running,
+  Done
+};
+
+static volatile uint8_t state = Idle;
+/** Sensor currently being converted. */
+static volatile uint8_t sensorIdx = 0;
+/** Samples accumulated for the current sensor. */
+static volatile uint8_t sampleCount = 0;
+/** Conversions left to discard after a channel switch. */
+static volatile uint8_t discardCount = 0;
+
+#if defined(SAMPLE_FILTER) && defined(ADC_OVERSAMPLE)
+#error "SAMPLE_FILTER needs the single samples, ADC_OVERSAMPLE only sums them; enable one of both"
+#endif
+
+#if defined(ADC_OVERSAMPLE)
+static_assert(ADC_OVERSAMPLE_LOG4 >= 1 && ADC_OVERSAMPLE_LOG4 <= 3, "ADC_OVERSAMPLE_LOG4 must be 1-3");
+static_assert(ADC_OVERSAMPLE_BITS >= 1 && ADC_OVERSAMPLE_BITS <= ADC_OVERSAMPLE_LOG4,
+              "ADC_OVERSAMPLE_BITS must be 1..ADC_OVERSAMPLE_LOG4");
+/** Samples per sensor and round. */
+constexpr uint8_t SAMPLES = 1 << (2 * ADC_OVERSAMPLE_LOG4);
+/** Right shift that decimates a sample sum to 10 + ADC_OVERSAMPLE_BITS bits. */
+constexpr uint8_t DECIMATE_SHIFT = 2 * ADC_OVERSAMPLE_LOG4 - ADC_OVERSAMPLE_BITS;
+static_assert((uint32_t)SAMPLES * 1023UL <= 0xFFFFUL, "Too many samples for 16-bit ADC accumulators");
+#elif defined(SAMPLE_FILTER)
+/** Samples per sensor and round, kept one by one for the filter. */
+constexpr uint8_t SAMPLES = FILTER_SAMPLES;
+#else
+/** Samples per sensor in the running round, taken from @ref Settings at its start. */
+static volatile uint8_t roundSamples = AVERAGE_OF;
+static_assert((uint32_t)Settings::MAX_AVERAGE_OF * 1023UL <= 0xFFFFUL,
+              "Too many samples for 16-bit ADC accumulators");
+#endif  // ADC_OVERSAMPLE
+
+/** Samples per sensor and round. */
+static inline uint8_t samplesPerRound() {
+#if defined(ADC_OVERSAMPLE) || defined(SAMPLE_FILTER)
+  return SAMPLES;
+#else
+  return roundSamples;
+#endif  // ADC_OVERSAMPLE || SAMPLE_FILTER
+}
+
+#if defined(SAMPLE_FILTER)
+/** Samples of the current round per sensor. */
+static volatile uint16_t samples[NUM_SENSORS][SAMPLES];
+#else
+/** Per-sensor sample sums (samples * 1023 must fit into 16 bit). */
+static volatile uint16_t accumulators[NUM_SENSORS];
+#endif  // SAMPLE_FILTER
+
+/** Channel selected, conversion not yet started (see takePendingStart()). */
+static volatile bool pendingStart = false;
+
+#if defined(ADC_NOISE_SLEEP) && !defined(POWER_SAVE)
+#error "ADC_NOISE_SLEEP requires POWER_SAVE to start the conversions"
+#endif
+
+/**
+ * @brief Set up the conversion of @p pin; it is started right away unless
+ * @ref ADC_NOISE_SLEEP leaves that to the sleep entry.
+ */
+static void queueConversion(uint8_t pin) {
+#if defined(ADC_NOISE_SLEEP)
+  Hal::adcSelect(pin);
+  pendingStart = true;
+#else
+  Hal::adcStart(pin);
+#endif  // ADC_NOISE_SLEEP
+}
+
+/**
+ * @brief First sensor from @p idx on that is read by the ADC (I2C soil
+ * sensors are read by @ref I2cSoil); @ref NUM_SENSORS if none is left.
+ */
+static uint8_t nextAnalog(uint8_t idx) {
+#if defined(SENSOR_I2C)
+  while (idx < NUM_SENSORS && Lib::getSensorI2cAddress(idx)) idx++;
+#endif  // SENSOR_I2C
+  return idx;
+}
+
+bool start() {
+  if (state != Idle) return false;
+#if defined(SENSOR_I2C)
+  I2cSoil::start();
+#endif  // SENSOR_I2C
+#if !defined(SAMPLE_FILTER)
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    accumulators[i] = 0;
+  }
+#endif  // SAMPLE_FILTER
+  uint8_t first = nextAnalog(0);
+  sampleCount = 0;
+#if !defined(ADC_OVERSAMPLE) && !defined(SAMPLE_FILTER)
+  roundSamples = Settings::values().averageOf;
+#endif  // !ADC_OVERSAMPLE && !SAMPLE_FILTER
+  if (first >= NUM_SENSORS) {
+    state = Done;
+    return true;
+  }
+  sensorIdx = first;
+  discardCount = Lib::settleConversions(first);
+  state = Running;
+  queueConversion(Lib::selectSensor(first));
+  return true;
+}
+
+bool isBusy() {
+  return state == Running;
+}
+
+bool hasResult() {
+#if defined(SENSOR_I2C)
+  if (!I2cSoil::isDone()) return false;
+#endif  // SENSOR_I2C
+  return state == Done;
+}
+
+bool takePendingStart() {
+  bool pending = pendingStart;
+  pendingStart = false;
+  return pending;
+}
+
+bool poll(Lib::SensorContext& out) {
+  if (!hasResult()) return false;
+  // The ISR is idle while in Done, so the accumulators and samples can be read without locking.
+  for (uint8_t i = nextAnalog(0); i < NUM_SENSORS; i = nextAnalog(i + 1)) {
+    // integer rounded average, identical to Lib's synchronous path
+#if defined(SAMPLE_FILTER)
+    uint16_t window[SAMPLES];
+    for (uint8_t k = 0; k < SAMPLES; k++) window[k] = samples[i][k];
+    uint16_t raw = Filter::apply((Filter::Mode)Settings::values().filter[i], window);
+#else
+    const uint8_t count = samplesPerRound();
+    uint16_t raw = (accumulators[i] + (count / 2)) / count;
+#endif  // SAMPLE_FILTER
+    out.values[i] = Lib::rawToHumidity(i, raw);
+#if defined(ADC_OVERSAMPLE)
+    out.raw[i] = (accumulators[i] + (1 << (DECIMATE_SHIFT - 1))) >> DECIMATE_SHIFT;
+#endif  // ADC_OVERSAMPLE
+  }
+#if defined(SENSOR_I2C)
+  I2cSoil::collect(out);
+#endif  // SENSOR_I2C
+  state = Idle;
+  return true;
+}
+
+void onConversionComplete(uint16_t raw) {
+  if (state != Running) return;
+
+  if (discardCount) {
+    discardCount--;
+  } else {
+#if defined(SAMPLE_FILTER)
+    samples[sensorIdx][sampleCount] = raw;
+#else
+    accumulators[sensorIdx] += raw;
+#endif  // SAMPLE_FILTER
+    if (++sampleCount >= samplesPerRound()) {
+      sampleCount = 0;
+      sensorIdx = nextAnalog(sensorIdx + 1);
+      if (sensorIdx >= NUM_SENSORS) {
+        Hal::adcStop();
+        state = Done;
+        return;
+      }
+      // Switch input right away: the settle conversions below give the
+      // multiplexer and sample-and-hold time to follow the new source.
+      discardCount = Lib::settleConversions(sensorIdx);
+      queueConversion(Lib::selectSensor(sensorIdx));
+      return;
+    }
+  }
+  queueConversion(Lib::getSensorPin(sensorIdx));
+}
+
+}  // namespace Adc
+
+#if defined(ARDUINO)
+// ADC conversion complete: feed the engine, which queues the next conversion.
+ISR(ADC_vect) {
+  Adc::onConversionComplete(Hal::adcResult());
+}
+#endif  // ARDUINO
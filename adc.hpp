@@ -0,0 +1,70 @@
+/**
+ * @file adc.hpp
+ * @brief Interrupt-driven, non-blocking ADC sampling engine.
+ *
+ * The engine round-robins over all configured sensors, taking
+ * @ref AVERAGE_OF samples per channel (as configured in @ref Settings when
+ * the round starts; 4^n with @ref ADC_OVERSAMPLE, @ref FILTER_SAMPLES with
+ * @ref SAMPLE_FILTER) from the
+ * ADC complete interrupt and accumulating them per sensor (keeping them for
+ * the filter with @ref SAMPLE_FILTER). When a round is finished the main loop picks
+ * up the result with @ref Adc::poll() and receives a complete
+ * @ref Lib::SensorContext snapshot. Nothing in this module waits for the ADC.
+ * With @ref SENSOR_I2C the round also starts @ref I2cSoil, and the snapshot
+ * is published once both are finished.
+ */
+#pragma once
+
+#include "lib.hpp"
+
+/**
+ * @namespace Adc
+ * @brief Non-blocking sensor sampling driven by @c ADC_vect.
+ */
+namespace Adc {
+
+/**
+ * @brief Start a sampling round over all sensors.
+ * @return false if a round is still in progress (nothing is restarted).
+ */
+bool start();
+
+/**
+ * @brief Query whether a sampling round is currently running.
+ */
+bool isBusy();
+
+/**
+ * @brief Publish a finished round into @p out.
+ *
+ * Converts the accumulated samples to humidity percentages and copies them
+ * into @p out. Call from the main loop; returns immediately if no round has
+ * finished since the last call.
+ * @param out Context receiving the snapshot.
+ * @return true if a new snapshot was written.
+ */
+bool poll(Lib::SensorContext& out);
+
+/**
+ * @brief Query whether a finished round is waiting for @ref poll().
+ */
+bool hasResult();
+
+/**
+ * @brief Take the pending start of the next conversion.
+ *
+ * With @ref ADC_NOISE_SLEEP the engine only selects the next channel and
+ * leaves starting the conversion to @ref Power, which enters ADC
+ * noise-reduction sleep to do so (or triggers it directly when it cannot
+ * sleep). Call with interrupts disabled.
+ * @return true if a conversion is waiting to be started.
+ */
+bool takePendingStart();
+
+/**
+ * @brief Conversion-complete hook called from @c ADC_vect (or the host simulator).
+ * @param raw 10-bit conversion result.
+ */
+void onConversionComplete(uint16_t raw);
+
+}  // namespace Adc
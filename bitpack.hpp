@@ -0,0 +1,44 @@
+/**
+ * @file bitpack.hpp
+ * @brief 7-bit value packing shared by history, log and telemetry.
+ *
+ * Humidity values are 0–99 and fit into 7 bits. Values are packed LSB
+ * first; slot @c n occupies bits @c 7n .. @c 7n+6 of the buffer.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @namespace Bitpack
+ * @brief Random-access 7-bit packing.
+ */
+namespace Bitpack {
+
+/** Bytes needed to hold @p count 7-bit values. */
+constexpr uint16_t bytesFor7(uint16_t count) {
+  return (count * 7 + 7) / 8;
+}
+
+/** Store @p value (0–127) in slot @p slot; other slots are preserved. */
+inline void put7(uint8_t* bits, uint16_t slot, uint8_t value) {
+  uint16_t pos = slot * 7;
+  uint8_t* p = &bits[pos >> 3];
+  uint8_t shift = pos & 7;
+  p[0] = (p[0] & ~(uint8_t)(0x7F << shift)) | (uint8_t)(value << shift);
+  if (shift > 1) {
+    p[1] = (p[1] & ~(uint8_t)(0x7F >> (8 - shift))) | (uint8_t)(value >> (8 - shift));
+  }
+}
+
+/** Load the value stored in slot @p slot. */
+inline uint8_t get7(const uint8_t* bits, uint16_t slot) {
+  uint16_t pos = slot * 7;
+  const uint8_t* p = &bits[pos >> 3];
+  uint8_t shift = pos & 7;
+  uint8_t value = p[0] >> shift;
+  if (shift > 1) value |= p[1] << (8 - shift);
+  return value & 0x7F;
+}
+
+}  // namespace Bitpack
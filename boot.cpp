@@ -0,0 +1,50 @@
+/**
+ * @file boot.cpp
+ * @brief Implementation of the boot path selection and timing.
+ */
+#include "boot.hpp"
+#include "config.hpp"
+
+namespace Boot {
+
+static uint32_t startMicros = 0;
+static uint32_t phaseUs[PHASES];
+static uint8_t reachedMask = 0;
+static uint8_t flags = 0;
+static bool fast = false;
+
+void begin(uint8_t resetFlags) {
+  startMicros = micros();
+  flags = resetFlags;
+#if defined(FAST_BOOT)
+  fast = (resetFlags & ((1 << WDRF) | (1 << BORF))) != 0;
+#endif  // FAST_BOOT
+}
+
+void mark(Phase phase) {
+  if (reached(phase)) return;
+  phaseUs[phase] = sinceStartUs();
+  reachedMask |= 1 << phase;
+}
+
+bool reached(Phase phase) {
+  return (reachedMask & (1 << phase)) != 0;
+}
+
+uint32_t elapsedUs(Phase phase) {
+  return phaseUs[phase];
+}
+
+uint32_t sinceStartUs() {
+  return (uint32_t)micros() - startMicros;
+}
+
+bool isFast() {
+  return fast;
+}
+
+uint8_t resetFlags() {
+  return flags;
+}
+
+}  // namespace Boot
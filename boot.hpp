@@ -0,0 +1,74 @@
+/**
+ * @file boot.hpp
+ * @brief Reset cause, boot path and boot phase timestamps.
+ *
+ * A normal boot shows the splash screen for @ref DISP_SPLASH_MS and reads
+ * the sensors once before Timer1 starts, which takes well over a second.
+ * After a watchdog or brown-out reset (and @ref FAST_BOOT) @c setup() only
+ * brings up serial, the memory and the timers; the splash is sent by the
+ * render task and the first reading is queued as an event, so telemetry
+ * resumes as soon as the first sampling round is done.
+ *
+ * Either way the time of each phase is taken with micros() relative to the
+ * start of @c setup() and reported by the BOOT command, so the time to the
+ * first reading can be tracked.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Boot
+ * @brief Boot path selection and timing.
+ */
+namespace Boot {
+
+/**
+ * @brief Milestones of the boot, in the order of a normal boot.
+ */
+enum Phase : uint8_t {
+  SerialReady,    ///< UART open
+  DisplayReady,   ///< display initialized (splash shown, or queued on a fast boot)
+  TimersStarted,  ///< Timer1 running, read requests possible
+  FirstReading,   ///< first sensor values in memory
+  PHASES
+};
+
+/**
+ * @brief Start timing and choose the boot path. Call first in @c setup()
+ * with MCUSR before it is cleared.
+ */
+void begin(uint8_t resetFlags);
+
+/**
+ * @brief Record that @p phase was reached. Only the first call per phase
+ * counts.
+ */
+void mark(Phase phase);
+
+/**
+ * @brief True if @p phase was reached.
+ */
+bool reached(Phase phase);
+
+/**
+ * @brief Microseconds from the start of @c setup() to @p phase.
+ */
+uint32_t elapsedUs(Phase phase);
+
+/**
+ * @brief Microseconds since the start of @c setup().
+ */
+uint32_t sinceStartUs();
+
+/**
+ * @brief True if this boot takes the fast path.
+ */
+bool isFast();
+
+/**
+ * @brief MCUSR as passed to @ref begin().
+ */
+uint8_t resetFlags();
+
+}  // namespace Boot
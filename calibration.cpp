@@ -0,0 +1,82 @@
+/**
+ * @file calibration.cpp
+ * @brief Implementation of the per-sensor calibration curves.
+ */
+#include "calibration.hpp"
+#include "config.hpp"
+
+namespace Calibration {
+
+static_assert(CAL_MAX_POINTS >= 2, "CAL_MAX_POINTS must be at least 2");
+static_assert(1023UL * 1023UL < (1UL << RECIPROCAL_SHIFT), "Reciprocal not exact for 10-bit spans");
+static_assert(100UL << RECIPROCAL_SHIFT <= 0xFFFFFFFFUL - 1023UL * 100UL, "Reciprocal product overflows 32 bit");
+
+/** Compiled default curves (flash). */
+#define SENSOR_CURVE_ENTRY(name, source, calibratedMin, calibratedMax) linear(calibratedMin, calibratedMax),
+static const Curve DEFAULTS[NUM_SENSORS] PROGMEM = { SENSOR_LIST(SENSOR_CURVE_ENTRY) };
+#undef SENSOR_CURVE_ENTRY
+
+/** Active curves. */
+static Curve curves[NUM_SENSORS];
+
+void begin() {
+  memcpy_P(curves, DEFAULTS, sizeof(curves));
+}
+
+void loadDefault(uint8_t sensor) {
+  if (sensor >= NUM_SENSORS) return;
+  memcpy_P(&curves[sensor], &DEFAULTS[sensor], sizeof(Curve));
+}
+
+bool load(uint8_t sensor, const Point* points, uint8_t count) {
+  if (sensor >= NUM_SENSORS || count < 2 || count > CAL_MAX_POINTS) return false;
+  for (uint8_t i = 0; i < count; i++) {
+    if (points[i].raw > 1023 || points[i].pct > 100) return false;
+    if (i > 0 && points[i].raw <= points[i - 1].raw) return false;
+  }
+
+  Curve c;
+  c.segments = count - 1;
+  for (uint8_t i = 0; i < c.segments; i++) {
+    const Point& a = points[i];
+    const Point& b = points[i + 1];
+    Segment& s = c.seg[i];
+    s.raw = a.raw;
+    s.pct = a.pct;
+    s.falling = b.pct < a.pct;
+    s.reciprocal = reciprocal(s.falling ? a.pct - b.pct : b.pct - a.pct, b.raw - a.raw);
+  }
+  c.last = points[count - 1];
+  curves[sensor] = c;
+  return true;
+}
+
+uint8_t points(uint8_t sensor, Point* out) {
+  if (sensor >= NUM_SENSORS) return 0;
+  const Curve& c = curves[sensor];
+  for (uint8_t i = 0; i < c.segments; i++) {
+    out[i].raw = c.seg[i].raw;
+    out[i].pct = c.seg[i].pct;
+  }
+  out[c.segments] = c.last;
+  return c.segments + 1;
+}
+
+uint8_t toHumidity(uint8_t sensor, uint16_t raw) {
+  const Curve& c = curves[sensor];
+  uint8_t pct;
+  if (raw <= c.seg[0].raw) {
+    pct = c.seg[0].pct;
+  } else if (raw >= c.last.raw) {
+    pct = c.last.pct;
+  } else {
+    uint8_t i = c.segments - 1;
+    while (raw < c.seg[i].raw) i--;
+    const Segment& s = c.seg[i];
+    uint8_t delta = ((uint32_t)(raw - s.raw) * s.reciprocal) >> RECIPROCAL_SHIFT;
+    pct = s.falling ? s.pct - delta : s.pct + delta;
+  }
+  return pct > 99 ? 99 : pct;
+}
+
+}  // namespace Calibration
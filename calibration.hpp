@@ -0,0 +1,99 @@
+/**
+ * @file calibration.hpp
+ * @brief Per-sensor raw-to-humidity calibration without division on the hot path.
+ *
+ * A calibration is a curve of 2 to @ref CAL_MAX_POINTS points (raw value,
+ * humidity %), with the raw values strictly increasing. When a curve is
+ * loaded it is compiled into segments that each hold a Q22 fixed-point
+ * reciprocal of their span, so @ref Calibration::toHumidity() only needs a
+ * multiply and a shift. For every 10-bit input the result equals the
+ * integer division @c (raw - start) * delta / span, because span² < 2^22.
+ *
+ * The defaults are the linear curves from the calibrated minimum (100 %) to
+ * maximum (0 %) of each @ref SENSOR_LIST entry, compiled at build time into
+ * flash.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Calibration
+ * @brief Per-sensor calibration curves.
+ */
+namespace Calibration {
+
+/** Fraction bits of the segment reciprocals. */
+constexpr uint8_t RECIPROCAL_SHIFT = 22;
+
+/**
+ * @brief One calibration point.
+ */
+struct Point {
+  uint16_t raw;  ///< raw ADC value (0–1023)
+  uint8_t pct;   ///< humidity at that value (0–100)
+};
+
+/**
+ * @brief A compiled curve segment starting at (@c raw, @c pct).
+ */
+struct Segment {
+  uint16_t raw;
+  uint8_t pct;
+  bool falling;         ///< humidity decreases with the raw value
+  uint32_t reciprocal;  ///< ceil(|delta pct| * 2^RECIPROCAL_SHIFT / span)
+};
+
+/**
+ * @brief A compiled calibration curve.
+ */
+struct Curve {
+  uint8_t segments;
+  Segment seg[CAL_MAX_POINTS - 1];
+  Point last;  ///< end point of the last segment
+};
+
+/** Rounded-up Q22 reciprocal used for segment spans. */
+constexpr uint32_t reciprocal(uint8_t delta, uint16_t span) {
+  return (((uint32_t)delta << RECIPROCAL_SHIFT) + span - 1) / span;
+}
+
+/** Compile-time generator for a linear curve from @p wet (100 %) to @p dry (0 %). */
+constexpr Curve linear(uint16_t wet, uint16_t dry) {
+  return Curve{ 1, { Segment{ wet, 100, true, reciprocal(100, dry - wet) } }, Point{ dry, 0 } };
+}
+
+/**
+ * @brief Load the compiled default curves; call once from setup().
+ */
+void begin();
+
+/**
+ * @brief Compile and install a curve for @p sensor.
+ * @param sensor Sensor index.
+ * @param points Curve points with strictly increasing raw values.
+ * @param count Number of points (2 .. @ref CAL_MAX_POINTS).
+ * @return false if the curve is invalid; the old curve stays active.
+ */
+bool load(uint8_t sensor, const Point* points, uint8_t count);
+
+/**
+ * @brief Restore the compiled default curve of @p sensor.
+ */
+void loadDefault(uint8_t sensor);
+
+/**
+ * @brief Read back the points of the active curve of @p sensor.
+ * @param out Receives up to @ref CAL_MAX_POINTS points.
+ * @return Number of points.
+ */
+uint8_t points(uint8_t sensor, Point* out);
+
+/**
+ * @brief Convert a raw value of @p sensor to humidity (0–99).
+ *
+ * Values outside the curve take the humidity of the nearest end point.
+ */
+uint8_t toHumidity(uint8_t sensor, uint16_t raw);
+
+}  // namespace Calibration
@@ -0,0 +1,163 @@
+/**
+ * @file clock.cpp
+ * @brief Implementation of the Timer1 wall clock.
+ */
+#include "clock.hpp"
+#include "config.hpp"
+
+namespace Clock {
+
+/** Timer1 counts per second with prescaler 1024. */
+constexpr uint16_t TICKS_PER_SECOND = F_CPU / 1024UL;
+/** Last count of a Timer1 period. */
+constexpr uint16_t TIMER1_TOP = (uint16_t)(TICKS_PER_SECOND * (unsigned long)READ_INTERVAL_SECONDS - 1UL);
+/** Microseconds per Timer1 count. */
+constexpr uint16_t US_PER_TICK = 1024000000UL / F_CPU;
+
+static_assert(F_CPU % 1024UL == 0 && 1024000000UL % F_CPU == 0, "Clock needs a whole number of Timer1 counts per second and microseconds per count");
+
+/** Seconds since the origin at the last tick. */
+static volatile uint32_t epochSeconds = 0;
+/** Fields of @ref epochSeconds. */
+static Time fields = {};
+/** Incremented on every tick and set; tells @ref text() to reformat. */
+static volatile uint8_t ticks = 0;
+static char header[9];
+static uint8_t headerTicks = 0;
+static bool headerValid = false;
+/** Stopped time not yet added to Timer1. */
+static uint16_t lagUs = 0;
+
+void begin() {
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = (1 << WGM12);  // CTC mode (Clear Timer on Compare Match)
+  OCR1A = TIMER1_TOP;
+  TCNT1 = 0;
+  TCCR1B |= (1 << CS12) | (1 << CS10);  // prescaler 1024
+  TIMSK1 |= (1 << OCIE1A);
+  epochSeconds = 0;
+  fields = Time();
+  ticks++;
+  lagUs = 0;
+  interrupts();
+}
+
+void tick() {
+  epochSeconds += READ_INTERVAL_SECONDS;
+  for (uint8_t i = 0; i < READ_INTERVAL_SECONDS; i++) {
+    if (++fields.seconds < 60) continue;
+    fields.seconds = 0;
+    if (++fields.minutes < 60) continue;
+    fields.minutes = 0;
+    if (++fields.hours < 24) continue;
+    fields.hours = 0;
+    fields.day++;
+  }
+  ticks++;
+}
+
+void setMillis(uint32_t ms) {
+  uint32_t s = ms / 1000UL;
+  setSeconds(s, (uint16_t)(ms - s * 1000UL));
+}
+
+void setSeconds(uint32_t s, uint16_t ms) {
+  s += ms / 1000;
+  const uint16_t rest = ms % 1000;
+  // the ticks fall on whole periods, so part of the seconds may be phase
+  uint8_t phase = (uint8_t)(s % READ_INTERVAL_SECONDS);
+  s -= phase;
+  // rounded up, so millis() reads back at least @p ms
+  uint16_t count = (uint16_t)((((uint32_t)phase * 1000UL + rest) * TICKS_PER_SECOND + 999UL) / 1000UL);
+
+  Time t;
+  t.day = (uint16_t)(s / 86400UL);
+  uint32_t inDay = s - (uint32_t)t.day * 86400UL;
+  t.hours = (uint8_t)(inDay / 3600UL);
+  uint16_t inHour = (uint16_t)(inDay - (uint32_t)t.hours * 3600UL);
+  t.minutes = (uint8_t)(inHour / 60);
+  t.seconds = (uint8_t)(inHour - t.minutes * 60);
+
+  noInterrupts();
+  Hal::timer1SetCount(count);
+  epochSeconds = s;
+  fields = t;
+  ticks++;
+  lagUs = 0;
+  interrupts();
+}
+
+/**
+ * @brief Consistent seconds at the last tick and Timer1 count since then,
+ * including a tick whose interrupt is still pending.
+ */
+static void snapshot(uint32_t& epoch, uint16_t& count) {
+  noInterrupts();
+  count = Hal::timer1Count();
+  epoch = epochSeconds;
+  if (Hal::timer1Pending() && count < TIMER1_TOP / 2) epoch += READ_INTERVAL_SECONDS;
+  interrupts();
+}
+
+uint32_t seconds() {
+  uint32_t epoch;
+  uint16_t count;
+  snapshot(epoch, count);
+  return epoch + count / TICKS_PER_SECOND;
+}
+
+uint32_t millis() {
+  uint32_t epoch;
+  uint16_t count;
+  snapshot(epoch, count);
+  return epoch * 1000UL + (uint32_t)count * 1000UL / TICKS_PER_SECOND;
+}
+
+uint32_t tickSeconds() {
+  return epochSeconds;
+}
+
+Time now() {
+  noInterrupts();
+  Time t = fields;
+  interrupts();
+  return t;
+}
+
+const char* text() {
+  if (headerValid && headerTicks == ticks) return header;
+  noInterrupts();
+  Time t = fields;
+  headerTicks = ticks;
+  interrupts();
+  headerValid = true;
+
+  char sep = (t.seconds & 1) ? ' ' : ':';
+  header[0] = (char)('0' + t.hours / 10);
+  header[1] = (char)('0' + t.hours % 10);
+  header[2] = sep;
+  header[3] = (char)('0' + t.minutes / 10);
+  header[4] = (char)('0' + t.minutes % 10);
+  header[5] = sep;
+  header[6] = (char)('0' + t.seconds / 10);
+  header[7] = (char)('0' + t.seconds % 10);
+  header[8] = '\0';
+  return header;
+}
+
+void compensate(uint16_t us) {
+  lagUs += us;
+  if (lagUs < US_PER_TICK) return;
+  uint16_t add = lagUs / US_PER_TICK;
+  noInterrupts();
+  uint16_t count = Hal::timer1Count();
+  // Moving past the compare value would skip a tick; wait for the next period.
+  if (!Hal::timer1Pending() && count + add < TIMER1_TOP) {
+    Hal::timer1SetCount(count + add);
+    lagUs -= add * US_PER_TICK;
+  }
+  interrupts();
+}
+
+}  // namespace Clock
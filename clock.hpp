@@ -0,0 +1,92 @@
+/**
+ * @file clock.hpp
+ * @brief Wall clock driven by the Timer1 tick.
+ *
+ * The Timer1 compare interrupt (every @ref READ_INTERVAL_SECONDS) calls
+ * @ref Clock::tick(), which advances a 32-bit count of seconds and the day,
+ * hour, minute and second fields by carrying from one to the next, so
+ * reading the time of day needs no division. The header string is
+ * formatted from the fields at most once per tick.
+ *
+ * The position of Timer1 within its period is the sub-second part: setting
+ * the clock (T=) moves Timer1 to the millisecond given, and the time Timer1
+ * stands still in ADC noise-reduction sleep is made up for by advancing it
+ * (@ref Clock::compensate()). The seconds count wraps after 136 years,
+ * unlike millis() after 49 days.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Clock
+ * @brief Time of day and seconds since the clock origin.
+ */
+namespace Clock {
+
+/**
+ * @brief Broken-down time of the last tick.
+ */
+struct Time {
+  uint16_t day;  ///< days since the origin
+  uint8_t hours;
+  uint8_t minutes;
+  uint8_t seconds;
+};
+
+/**
+ * @brief Start Timer1 (CTC mode, prescaler 1024, compare interrupt every
+ * @ref READ_INTERVAL_SECONDS) with the clock at 0.
+ */
+void begin();
+
+/**
+ * @brief Advance by one Timer1 period; call from the Timer1 compare ISR.
+ */
+void tick();
+
+/**
+ * @brief Set the clock to @p ms milliseconds since the origin.
+ */
+void setMillis(uint32_t ms);
+
+/**
+ * @brief Set the clock to @p s seconds and @p ms milliseconds since the
+ * origin (@p ms may exceed 999). Unlike @ref setMillis() it reaches the
+ * full range of the seconds count.
+ */
+void setSeconds(uint32_t s, uint16_t ms);
+
+/**
+ * @brief Seconds since the origin.
+ */
+uint32_t seconds();
+
+/**
+ * @brief Milliseconds since the origin, truncated to 32 bit (wraps after
+ * 49 days like millis()).
+ */
+uint32_t millis();
+
+/**
+ * @brief Seconds since the origin at the last tick. For interrupt
+ * handlers, which must not use @ref seconds().
+ */
+uint32_t tickSeconds();
+/**
+ * @brief Fields of the last tick.
+ */
+Time now();
+
+/**
+ * @brief The time of day as "HH:MM:SS", with blank separators on odd
+ * seconds. Formatted once per tick; valid until the next call.
+ */
+const char* text();
+
+/**
+ * @brief Make up for @p us during which Timer1 stood still.
+ */
+void compensate(uint16_t us);
+
+}  // namespace Clock
@@ -13,7 +13,11 @@
 
 #pragma once
 
+#if defined(ARDUINO)
 #include <Arduino.h>
+#else
+#include "hal_host.hpp"
+#endif
 
 /*****************************/
 /**   Setup your project    **/
@@ -57,54 +61,247 @@
  */
 #define SERIAL_LOG
 
+/**
+ * @def TELEMETRY_BINARY
+ * @brief Compile in the COBS-framed binary telemetry (@ref Telemetry),
+ * selectable at runtime with MODE=BIN.
+ */
+#define TELEMETRY_BINARY
+
 #define WIRE_HAS_TIMEOUT
 
+/**
+ * @def TWI_ASYNC
+ * @brief Run the I2C bus from the TWI interrupt with a transaction queue
+ * (@ref Twi) instead of Wire: display transfers overlap with the other
+ * tasks, and I2C soil sensors (@ref SENSOR_I2C) share the bus.
+ *
+ * The driver defines @c TWI_vect, which Wire defines as well, so Wire must
+ * not be linked: build U8g2 without its hardware I2C support
+ * (@c U8X8_HAVE_HW_I2C in U8x8lib.h), or exclude Wire in the build system.
+ */
+//#define TWI_ASYNC
 
 /**
- * @brief Interval for showing debug messages on display (milliseconds).
+ * @def SENSOR_I2C
+ * @brief Allow I2C capacitive soil sensors (Adafruit STEMMA / seesaw) as
+ * @ref SENSOR_LIST sources via @c I2C_SOIL(n) (requires @ref TWI_ASYNC).
  */
-constexpr uint16_t T_SHOWDEBUG = 2000;
+//#define SENSOR_I2C
+
 /**
- * @brief Number of samples to average per sensor read.
+ * @def ADC_ASYNC
+ * @brief Sample the sensors with the interrupt-driven ADC engine (@ref Adc)
+ * instead of the blocking Lib::readSensorsAndUpdateMemory().
  */
-constexpr uint8_t AVERAGE_OF = 3;
+#define ADC_ASYNC
 
 /**
- * @def NUM_SENSORS
- * @brief Number of sensors connected.
+ * @def ADC_OVERSAMPLE
+ * @brief Oversample and decimate in the ADC engine for a high-resolution raw
+ * value per sensor (@ref Lib::SensorContext::raw). The 0–99 values are
+ * unchanged. Oversampling only gains resolution if the input carries at
+ * least ~1 LSB of noise; the host simulator's --noise=<lsb> compares it
+ * with plain averaging. Cannot be combined with @ref SAMPLE_FILTER.
  */
-#define NUM_SENSORS 3
-static_assert(NUM_SENSORS > 0, "NUM_SENSORS must be greater than 0");
+//#define ADC_OVERSAMPLE
 
+/**
+ * @brief Oversampling ratio as a power of four: 4^n samples per sensor and
+ * round (1–3, i.e. 4, 16 or 64 samples). Used with @ref ADC_OVERSAMPLE.
+ */
+constexpr uint8_t ADC_OVERSAMPLE_LOG4 = 2;
 
-/// Configuration for each sensor
+/**
+ * @brief Extra bits of the decimated raw value (1 .. @ref ADC_OVERSAMPLE_LOG4),
+ * giving 10 + n effective bits. Ratios above 4^n average the rest away.
+ */
+constexpr uint8_t ADC_OVERSAMPLE_BITS = 2;
+
+/**
+ * @def POWER_SAVE
+ * @brief Sleep in idle mode whenever the main loop has no work (@ref Power).
+ */
+#define POWER_SAVE
+
+/**
+ * @def ADC_NOISE_SLEEP
+ * @brief Run the sampling conversions in ADC noise-reduction sleep (requires
+ * @ref ADC_ASYNC and @ref POWER_SAVE). The UART clock stops during a
+ * conversion (~104 µs), so a serial byte arriving in that moment is lost.
+ * With @ref SERIAL_IN the sleep is skipped while a command line is being
+ * received and for @ref ADC_SLEEP_RX_QUIET_MS after the last byte, but the
+ * first byte after a quiet spell can still be lost; enable it only where
+ * the serial input is unused or the sender repeats unanswered commands.
+ */
+//#define ADC_NOISE_SLEEP
+
+/**
+ * @brief Time after the last received serial byte during which the
+ * conversions run in idle sleep instead (@ref ADC_NOISE_SLEEP).
+ */
+constexpr uint16_t ADC_SLEEP_RX_QUIET_MS = 1000;
+
+/**
+ * @brief Entries of the interrupt-to-loop event ring (@ref Events), a power
+ * of two. Each takes 5 bytes of SRAM.
+ */
+constexpr uint8_t EVENT_QUEUE_SIZE = 8;
+
+/**
+ * @def FAST_BOOT
+ * @brief After a watchdog or brown-out reset, start the timers right away
+ * and leave the splash screen and the first reading to the main loop
+ * (@ref Boot). Power-on and external resets boot normally.
+ */
+#define FAST_BOOT
+
+/**
+ * @def WARM_RESTART
+ * @brief Keep the latest values, the runtime settings, the clock and the
+ * history ring in .noinit SRAM and take them over after a watchdog or
+ * external reset instead of starting cold (@ref Snapshot). Costs about
+ * 80 bytes of SRAM with three sensors.
+ */
+//#define WARM_RESTART
+
+/**
+ * @def LATENCY_STATS
+ * @brief Record log2 latency histograms of the main loop stages
+ * (@ref Latency, STATS command) and the per-task scheduler statistics
+ * (TASKS command). Costs about 340 bytes of SRAM; compiles out entirely
+ * when not defined.
+ */
+//#define LATENCY_STATS
+
+/**
+ * @def HISTORY
+ * @brief Keep a bit-packed history of averaged readings in SRAM (@ref History,
+ * HIST command). Costs @ref HISTORY_SRAM_BYTES plus about 20 bytes, which
+ * the default configuration cannot spare on an ATmega328P: leave it off or
+ * turn other options off to make room.
+ */
+//#define HISTORY
+
+/**
+ * @brief SRAM budget of the history ring in bytes.
+ *
+ * The default holds ten blocks of 16 samples (45 bytes each with three
+ * sensors), i.e. at least 24 h at @ref HISTORY_SAMPLE_SECONDS = 600.
+ */
+constexpr uint16_t HISTORY_SRAM_BYTES = 460;
+
+/**
+ * @brief Seconds covered by one history sample; all readings within are averaged.
+ */
+constexpr uint16_t HISTORY_SAMPLE_SECONDS = 600;
+
+/**
+ * @def SENSOR_STATS
+ * @brief Keep streaming statistics per sensor: Welford mean and variance, a
+ * moving average and the extremes of the last hour and day
+ * (@ref SensorStats, SUMMARY command, summary packets in the binary
+ * telemetry). Costs 52 bytes of SRAM per sensor.
+ */
+//#define SENSOR_STATS
+
+/**
+ * @brief Weight of a new reading in the moving average of @ref SENSOR_STATS,
+ * as alpha = 2^-shift. With 4 and 10 s reads a step is followed to 63% in
+ * about 160 s.
+ */
+constexpr uint8_t SENSOR_STATS_EMA_SHIFT = 4;
+
+/**
+ * @brief Readings between two rounds of summary packets in the binary
+ * telemetry (every 5 minutes at 10 s reads).
+ */
+constexpr uint8_t SENSOR_STATS_PACKET_READINGS = 30;
+
+/**
+ * @def LOG_EEPROM
+ * @brief Append readings to a wear-leveled log in EEPROM (@ref LogStore).
+ */
+#define LOG_EEPROM
+
+/**
+ * @brief Seconds between two log records. The default region holds 89
+ * records, i.e. about 29 h at 1200 s.
+ */
+constexpr uint16_t LOG_INTERVAL_SECONDS = 1200;
+
+/**
+ * @brief Interval for showing debug messages on display (milliseconds).
+ */
+constexpr uint16_t T_SHOWDEBUG = 2000;
+/**
+ * @brief Milliseconds per pixel of the scrolling sensor list on the display.
+ */
+constexpr uint16_t DISP_SCROLL_STEP_MS = 40;
+/**
+ * @brief Milliseconds the sensor list rests when a row is aligned at the top.
+ * Only the clock is redrawn while it rests.
+ */
+constexpr uint16_t DISP_SCROLL_HOLD_MS = 1500;
+/**
+ * @brief Milliseconds the splash screen is shown after startup.
+ */
+constexpr uint16_t DISP_SPLASH_MS = 1000;
+
+/**
+ * @def LABEL_CACHE
+ * @brief Rasterize the digits and sensor names once at startup and blit them
+ * on the main screen instead of decoding the font glyph by glyph on every
+ * page (@ref LabelCache).
+ */
+//#define LABEL_CACHE
 
 /**
- * @brief Human-readable identifier for sensor 1 (stored in flash).
+ * @brief SRAM pool of the label cache in bytes. The digits take about
+ * 160 bytes, a name about 18 bytes per character with the default font;
+ * what does not fit is printed as before. The default holds the digits and
+ * the first two default names.
  */
-#define SENSOR_1_ID F("Monstera")
+constexpr uint16_t LABEL_CACHE_BYTES = 512;
 /**
- * @brief Analog pin for sensor 1.
+ * @brief Number of samples to average per sensor read.
  */
-constexpr uint8_t SENSOR_1_PIN = A0;
+constexpr uint8_t AVERAGE_OF = 3;
 
 /**
- * @brief Human-readable identifier for sensor 2 (stored in flash).
+ * @def SAMPLE_FILTER
+ * @brief Reduce the samples of a sensor with a robust filter instead of
+ * their mean (@ref Filter): median, trimmed mean or Hampel outlier
+ * rejection, selected per sensor with CFG=FILTER<s>. Both sampling paths
+ * take @ref FILTER_SAMPLES samples per sensor and reading. Cannot be
+ * combined with @ref ADC_OVERSAMPLE, which only keeps the sums.
  */
-#define SENSOR_2_ID F("Schaeflerer")
+//#define SAMPLE_FILTER
+
 /**
- * @brief Analog pin for sensor 2.
+ * @brief Samples per sensor and reading with @ref SAMPLE_FILTER (3–16). The
+ * ADC engine keeps them all, 2 bytes each per sensor.
  */
-constexpr uint8_t SENSOR_2_PIN = A1;
+constexpr uint8_t FILTER_SAMPLES = 7;
 
 /**
- * @brief Human-readable identifier for sensor 3 (stored in flash).
+ * @brief Filter of every sensor until another is configured: 0 mean,
+ * 1 median, 2 trimmed mean, 3 Hampel.
  */
-#define SENSOR_3_ID F("Gl. Feder")
+constexpr uint8_t FILTER_DEFAULT_MODE = 1;
+
 /**
- * @brief Analog pin for sensor 3.
+ * @brief Samples the trimmed mean drops at each end.
  */
-constexpr uint8_t SENSOR_3_PIN = A2;
+constexpr uint8_t FILTER_TRIM = 2;
+
+/**
+ * @brief Hampel threshold in standard deviations, estimated as 1.4826 times
+ * the median absolute deviation.
+ */
+constexpr uint8_t FILTER_HAMPEL_SIGMAS = 3;
+
+/// Configuration for each sensor
 
 /**
  * @brief Calibrated minimum raw value (sensor immersed in water).
@@ -115,17 +312,101 @@ constexpr uint16_t SENSOR_CALIBRATED_MIN = 360;
  */
 constexpr uint16_t SENSOR_CALIBRATED_MAX = 790;
 
+/**
+ * @def SENSOR_LIST
+ * @brief Sensor registry: one @c X(name, source, calibratedMin, calibratedMax)
+ * entry per sensor, in display order.
+ *
+ * - @c name: label of up to 11 characters, stored in flash.
+ * - @c source: analog pin (A0..A7), @c MUX_CHANNEL(n) for channel n of
+ *   the analog multiplexer (requires @ref SENSOR_MUX) or @c I2C_SOIL(n) for
+ *   the I2C soil sensor at address 0x36 + n (requires @ref SENSOR_I2C).
+ * - @c calibratedMin / @c calibratedMax: default calibration, raw value in
+ *   water and in dry air. Can be replaced at runtime with the CAL command
+ *   (@ref Calibration).
+ *
+ * Each sensor costs about 38 bytes of SRAM (value, raw value, ADC
+ * accumulator, history and display state, and 28 bytes of calibration curve
+ * with @ref CAL_MAX_POINTS = 4) and 41 bytes of flash (registry entry and
+ * default curve). The bit-packed history and the log get proportionally
+ * shorter; with the default @ref HISTORY_SRAM_BYTES the 24 h history fits
+ * up to three sensors.
+ */
+#define SENSOR_LIST(X) \
+  X("Monstera", A0, SENSOR_CALIBRATED_MIN, SENSOR_CALIBRATED_MAX) \
+  X("Schaeflerer", A1, SENSOR_CALIBRATED_MIN, SENSOR_CALIBRATED_MAX) \
+  X("Gl. Feder", A2, SENSOR_CALIBRATED_MIN, SENSOR_CALIBRATED_MAX)
+
+/**
+ * @brief Milliseconds an I2C soil sensor needs between the measurement
+ * command and reading the result (@ref SENSOR_I2C).
+ */
+constexpr uint8_t I2C_SOIL_MEASURE_MS = 5;
+
+/**
+ * @def SENSOR_MUX
+ * @brief Read sensors through a CD74HC4067-style 16:1 analog multiplexer
+ * whose common pin is wired to @ref MUX_SIG_PIN.
+ */
+//#define SENSOR_MUX
+
+/**
+ * @brief Analog pin connected to the multiplexer's common (SIG) pin.
+ */
+constexpr uint8_t MUX_SIG_PIN = A3;
+/**
+ * @brief Digital pins driving the multiplexer's channel select inputs S0..S3.
+ */
+constexpr uint8_t MUX_S0_PIN = 4;
+constexpr uint8_t MUX_S1_PIN = 5;
+constexpr uint8_t MUX_S2_PIN = 6;
+constexpr uint8_t MUX_S3_PIN = 7;
+/**
+ * @brief Conversions discarded after switching to a multiplexer channel, so
+ * the sample-and-hold capacitor can follow the new source.
+ */
+constexpr uint8_t MUX_SETTLE_CONVERSIONS = 2;
+
 /************************************************************************/
 /** Do NOT edit anything beyond this point (unless you know what you do) **/
 /************************************************************************/
 
 // PIN Config.
+/**
+ * @def MUX_CHANNEL
+ * @brief Sensor source for channel @p n (0–15) of the analog multiplexer.
+ */
+#define MUX_CHANNEL(n) (0x80 | (n))
+
+/**
+ * @def I2C_SOIL
+ * @brief Sensor source for the I2C soil sensor at address 0x36 + @p n (0–3).
+ * Its capacitance reading is mapped to the 10-bit analog scale (lower =
+ * wetter), so the calibration works like for analog sensors.
+ */
+#define I2C_SOIL(n) (0x40 | (n))
+
+/** Counts the entries of @ref SENSOR_LIST. */
+#define SENSOR_COUNT_ENTRY(name, source, calibratedMin, calibratedMax) +1
+
+/**
+ * @def NUM_SENSORS
+ * @brief Number of sensors connected (entries in @ref SENSOR_LIST).
+ */
+#define NUM_SENSORS (0 SENSOR_LIST(SENSOR_COUNT_ENTRY))
+static_assert(NUM_SENSORS > 0, "NUM_SENSORS must be greater than 0");
+
 /**
  * @brief Maximum number of sensors supported by the firmware.
  */
-constexpr uint8_t MAX_SENSORS = 3;
+constexpr uint8_t MAX_SENSORS = 32;
 static_assert(NUM_SENSORS <= MAX_SENSORS, "Error: NUM_SENSORS exceeds MAX_SENSORS. Please adjust configuration.");
 
+/**
+ * @brief Storage for a sensor name including the terminating zero.
+ */
+constexpr uint8_t SENSOR_NAME_LENGTH = 12;
+
 // Advanced Config.
 /**
  * @def BAUDRATE
@@ -138,6 +419,91 @@ static_assert(NUM_SENSORS <= MAX_SENSORS, "Error: NUM_SENSORS exceeds MAX_SENSOR
  */
 #define ANALOG_REF DEFAULT
 
+/**
+ * @brief First EEPROM address of the runtime configuration record
+ * (@ref Settings). The compile-time values in this file are its defaults.
+ */
+constexpr uint16_t SETTINGS_EEPROM_START = 0;
+
+/**
+ * @brief First EEPROM address of the reading log. Bytes below are left for
+ * other persistent data (the @ref Settings record).
+ */
+constexpr uint16_t LOG_EEPROM_START = 128;
+
+/**
+ * @brief Size of the EEPROM region used by the reading log.
+ */
+constexpr uint16_t LOG_EEPROM_BYTES = 896;
+
+/**
+ * @brief Records staged in RAM before they are queued for writing as one batch.
+ */
+constexpr uint8_t LOG_BATCH_RECORDS = 2;
+
+/**
+ * @brief Staging entries (16 bytes each) of the non-blocking EEPROM writer (@ref Nvm).
+ */
+constexpr uint8_t NVM_QUEUE_CHUNKS = 4;
+
+/**
+ * @brief Maximum points of a calibration curve (@ref Calibration); each
+ * point beyond two adds 8 bytes of SRAM per sensor.
+ */
+constexpr uint8_t CAL_MAX_POINTS = 4;
+
+/**
+ * @brief Longest serial command line in characters (@ref SERIAL_IN); one
+ * line can carry several ';'-separated commands. 48 fits the longest
+ * single command (a four-point CAL line) or a short batch such as
+ * @c CFG=NAME0=Ficus;CFG=SAVE. Longer batches are opt-in at one byte of
+ * SRAM per character.
+ */
+constexpr uint8_t SERIAL_LINE_LENGTH = 48;
+
+/**
+ * @brief Serial output ring in bytes (@ref SerialOut), on top of the 64-byte
+ * UART buffer of the core. Output beyond both is dropped by priority or,
+ * for command replies, waited for.
+ */
+constexpr uint8_t SERIAL_OUT_BUFFER = 64;
+
+/**
+ * @brief Bytes of @ref SERIAL_OUT_BUFFER that debug output leaves free for
+ * readings and replies.
+ */
+constexpr uint8_t SERIAL_OUT_RESERVE = 16;
+
+/**
+ * @brief I2C clock of the @ref Twi driver in Hz.
+ */
+constexpr uint32_t TWI_CLOCK = 400000UL;
+
+/**
+ * @brief Ring buffer for display transfers of the @ref Twi driver. The
+ * display only waits when it is full, so more room means more overlap.
+ */
+constexpr uint8_t TWI_STREAM_BYTES = 96;
+
+/**
+ * @brief The @ref Twi driver recovers the bus when a transfer makes no
+ * progress for this many microseconds.
+ */
+constexpr uint16_t TWI_TIMEOUT_US = 1000;
+
+/**
+ * @brief Task slots of the main loop scheduler (@ref Scheduler); setup()
+ * registers five tasks. Each slot costs 15 bytes of SRAM, 31 with
+ * @ref LATENCY_STATS.
+ */
+constexpr uint8_t SCHED_MAX_TASKS = 5;
+
+/**
+ * @brief Conversions discarded after switching the ADC input channel so the
+ * sample-and-hold capacitor can settle (used by @ref Adc).
+ */
+constexpr uint8_t ADC_SETTLE_CONVERSIONS = 1;
+
 #define DISP_CONTRAST 0
 
 /**
@@ -156,11 +522,37 @@ constexpr uint8_t READ_INTERVAL_SECONDS = 1;
  * fire every READ_INTERVAL_SECONDS and the ISR will count up to reach this
  * target. Set to any positive value; actual interval will be
  * multiplier * READ_INTERVAL_SECONDS where multiplier = ceil(READ_TARGET_SECONDS / READ_INTERVAL_SECONDS).
+ *
+ * This is the shortest interval of @ref ReadRate; the RATE command changes
+ * it at runtime.
  */
 constexpr uint8_t READ_TARGET_SECONDS = 10;
 
+/**
+ * @brief Longest read interval in seconds. While the readings stay calm the
+ * interval doubles up to this value; the default keeps it fixed at
+ * @ref READ_TARGET_SECONDS (try 640 for soil that dries over days).
+ */
+constexpr uint16_t READ_MAX_SECONDS = READ_TARGET_SECONDS;
+
+/**
+ * @brief Change of a reading in percent that drops the interval to
+ * @ref READ_TARGET_SECONDS.
+ */
+constexpr uint8_t READ_FAST_DELTA = 3;
+
+/**
+ * @brief Largest change of a reading in percent that counts as calm.
+ */
+constexpr uint8_t READ_CALM_DELTA = 1;
+
+/**
+ * @brief Calm readings in a row that double the read interval.
+ */
+constexpr uint8_t READ_CALM_READINGS = 3;
+
 // Validate that the base interval is representable for Timer1 with prescaler 1024
 static_assert(READ_INTERVAL_SECONDS >= 1 && (unsigned long)(F_CPU / 1024UL) * (unsigned long)READ_INTERVAL_SECONDS - 1UL <= 0xFFFFUL, "READ_INTERVAL_SECONDS too large for Timer1 with prescaler 1024 on this F_CPU; choose a smaller value or use a smaller prescaler.");
 
-// Ensure the computed multiplier will fit in a uint8_t
-static_assert(((READ_TARGET_SECONDS + READ_INTERVAL_SECONDS - 1) / READ_INTERVAL_SECONDS) <= 0xFF, "READ_TARGET_SECONDS/READ_INTERVAL_SECONDS multiplier too large to store in uint8_t.");
\ No newline at end of file
+static_assert(READ_TARGET_SECONDS >= 1 && READ_TARGET_SECONDS <= READ_MAX_SECONDS && READ_MAX_SECONDS <= 3600, "Read interval limits must satisfy 1 <= READ_TARGET_SECONDS <= READ_MAX_SECONDS <= 3600.");
+static_assert(READ_CALM_DELTA < READ_FAST_DELTA, "READ_CALM_DELTA must be below READ_FAST_DELTA.");
\ No newline at end of file
@@ -0,0 +1,60 @@
+/**
+ * @file crc.hpp
+ * @brief Small CRC helpers used for persisted and transmitted records.
+ *
+ * On the target the avr-libc table-free implementations from
+ * @c util/crc16.h are used; the host build gets equivalent portable code.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <util/crc16.h>
+#endif
+
+/**
+ * @namespace Crc
+ * @brief CRC-8 (poly 0x07) and CRC-16/CCITT (poly 0x1021) helpers.
+ */
+namespace Crc {
+
+/** Feed one byte into a CRC-8 (poly 0x07, MSB first). */
+inline uint8_t crc8Update(uint8_t crc, uint8_t data) {
+#if defined(ARDUINO)
+  return _crc8_ccitt_update(crc, data);
+#else
+  crc ^= data;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+#endif
+}
+
+/** Feed one byte into a CRC-16/CCITT (poly 0x1021, MSB first). */
+inline uint16_t crc16Update(uint16_t crc, uint8_t data) {
+#if defined(ARDUINO)
+  return _crc_xmodem_update(crc, data);
+#else
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+#endif
+}
+
+/** CRC-8 over a buffer. */
+inline uint8_t crc8(const uint8_t* data, uint16_t len, uint8_t crc = 0) {
+  while (len--) crc = crc8Update(crc, *data++);
+  return crc;
+}
+
+/** CRC-16/CCITT over a buffer (init 0xFFFF gives CRC-16/CCITT-FALSE). */
+inline uint16_t crc16(const uint8_t* data, uint16_t len, uint16_t crc = 0xFFFF) {
+  while (len--) crc = crc16Update(crc, *data++);
+  return crc;
+}
+
+}  // namespace Crc
@@ -0,0 +1,108 @@
+/**
+ * @file events.cpp
+ * @brief Implementation of the ISR-to-loop event ring.
+ */
+#include "events.hpp"
+#include "config.hpp"
+
+namespace Events {
+
+static_assert(EVENT_QUEUE_SIZE >= 2 && EVENT_QUEUE_SIZE <= 128 && (EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)) == 0,
+              "EVENT_QUEUE_SIZE must be a power of two from 2 to 128");
+constexpr uint8_t MASK = EVENT_QUEUE_SIZE - 1;
+
+static Event ring[EVENT_QUEUE_SIZE];
+/** Free-running indices; the fill level is head - tail (mod 256). */
+static volatile uint8_t head = 0;  ///< written by the producer only
+static volatile uint8_t tail = 0;  ///< written by the consumer only
+/** Producer-side counters. */
+static volatile uint32_t pushed = 0;
+static volatile uint32_t overflows = 0;
+static volatile uint8_t peak = 0;
+/** Consumer-side counters. */
+static uint32_t taken = 0;
+static uint32_t coalesced = 0;
+
+/** Keeps the compiler from moving ring accesses across the index accesses. */
+static inline void barrier() {
+  __asm__ __volatile__("" ::: "memory");
+}
+
+bool push(Type type) {
+  const uint8_t h = head;
+  const uint8_t used = (uint8_t)(h - tail);
+  if (used >= EVENT_QUEUE_SIZE) {
+    overflows++;
+    return false;
+  }
+  Event& e = ring[h & MASK];
+  e.millis = millis();
+  e.type = type;
+  barrier();
+  head = (uint8_t)(h + 1);  // publishes the entry
+  pushed++;
+  if (used + 1 > peak) peak = used + 1;
+  return true;
+}
+
+bool post(Type type) {
+  const uint8_t s = SREG;
+  cli();
+  bool ok = push(type);
+  SREG = s;
+  return ok;
+}
+
+uint8_t drain(Event* out, uint8_t max) {
+  const uint8_t h = head;  // entries before it are complete
+  barrier();
+  uint8_t t = tail;
+  uint8_t n = 0;
+  while (t != h && n < max) {
+    out[n++] = ring[t & MASK];
+    t++;
+  }
+  barrier();
+  tail = t;  // frees the entries
+  taken += n;
+  return n;
+}
+
+bool pending() {
+  return head != tail;
+}
+
+uint8_t queued() {
+  return (uint8_t)(head - tail);
+}
+
+void countCoalesced(uint8_t n) {
+  coalesced += n;
+}
+
+Stats stats() {
+  Stats s;
+  const uint8_t sreg = SREG;
+  cli();
+  s.pushed = pushed;
+  s.overflows = overflows;
+  s.peak = peak;
+  SREG = sreg;
+  s.taken = taken;
+  s.coalesced = coalesced;
+  return s;
+}
+
+void resetStats() {
+  const uint8_t s = SREG;
+  cli();
+  // events still queued count as pushed, so pushed = taken + queued() holds
+  peak = (uint8_t)(head - tail);
+  pushed = peak;
+  overflows = 0;
+  SREG = s;
+  taken = 0;
+  coalesced = 0;
+}
+
+}  // namespace Events
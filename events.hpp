@@ -0,0 +1,100 @@
+/**
+ * @file events.hpp
+ * @brief Timestamped event queue from interrupt handlers to the main loop.
+ *
+ * A single-producer/single-consumer ring of @ref EVENT_QUEUE_SIZE entries.
+ * On the AVR interrupt handlers do not nest, so all of them together are
+ * the one producer: they write an entry and then publish it by storing the
+ * head index, a single byte. The main loop is the consumer and frees
+ * entries by storing the tail index. Neither side disables interrupts; the
+ * rare push from the loop (@ref Events::post()) does, since it competes
+ * with the handlers for the head.
+ *
+ * Every event carries the millis() of its origin, so work started late
+ * (for example after a long display flush) still knows when it was asked
+ * for. A push into a full ring is dropped and counted; the loop counts the
+ * requests it merges into one piece of work as coalesced.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Events
+ * @brief Lock-free event ring between ISRs and the loop.
+ */
+namespace Events {
+
+/**
+ * @brief What happened.
+ */
+enum Type : uint8_t {
+  ReadTick,     ///< the Timer1 read interval elapsed
+  ReadCommand,  ///< a read was requested over serial
+  ReadBoot      ///< first read of a fast boot (@ref Boot)
+};
+
+/**
+ * @brief One queued event.
+ */
+struct Event {
+  uint32_t millis;  ///< millis() when it was pushed
+  Type type;
+};
+
+/**
+ * @brief Queue counters since boot (or the last reset).
+ */
+struct Stats {
+  uint32_t pushed;     ///< events queued
+  uint32_t taken;      ///< events drained by the loop
+  uint32_t overflows;  ///< events dropped on a full ring
+  uint32_t coalesced;  ///< events merged into other work by the loop
+  uint8_t peak;        ///< most events queued at once
+};
+
+/**
+ * @brief Queue an event from interrupt context (or with interrupts off).
+ * @return false if the ring was full and the event was dropped.
+ */
+bool push(Type type);
+
+/**
+ * @brief Queue an event from the main loop, or from code that may run with
+ * interrupts off; the interrupt state is saved and restored.
+ * @return false if the ring was full and the event was dropped.
+ */
+bool post(Type type);
+
+/**
+ * @brief Take up to @p max events, oldest first, in one batch.
+ * @return Number of events written to @p out.
+ */
+uint8_t drain(Event* out, uint8_t max);
+
+/**
+ * @brief True if events are waiting. Safe with interrupts off.
+ */
+bool pending();
+
+/**
+ * @brief Events waiting to be drained.
+ */
+uint8_t queued();
+
+/**
+ * @brief Count @p n events the loop merged into other work.
+ */
+void countCoalesced(uint8_t n);
+
+/**
+ * @brief Consistent copy of the counters.
+ */
+Stats stats();
+
+/**
+ * @brief Clear the counters.
+ */
+void resetStats();
+
+}  // namespace Events
@@ -0,0 +1,87 @@
+/**
+ * @file filter.cpp
+ * @brief Implementation of the sample filters.
+ */
+#include "filter.hpp"
+#include "config.hpp"
+
+namespace Filter {
+
+static_assert(FILTER_SAMPLES >= 3 && FILTER_SAMPLES <= 16, "FILTER_SAMPLES must be 3-16");
+static_assert(2 * FILTER_TRIM < FILTER_SAMPLES, "FILTER_TRIM leaves no samples");
+static_assert(FILTER_DEFAULT_MODE < MODES, "FILTER_DEFAULT_MODE must be 0-3");
+
+constexpr uint8_t N = FILTER_SAMPLES;
+
+/** Rounded mean of @p count samples from @p v (16 * 1023 fits 16 bit). */
+static uint16_t mean(const uint16_t* v, uint8_t count) {
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < count; i++) sum += v[i];
+  return (uint16_t)((sum + count / 2) / count);
+}
+
+/** Median of the sorted samples @p v. */
+static uint16_t median(const uint16_t* v) {
+  if (N & 1) return v[N / 2];
+  return (uint16_t)((v[N / 2 - 1] + v[N / 2] + 1) / 2);
+}
+
+/** |a - b| without a branch, for values below 32768. */
+static inline uint16_t distance(uint16_t a, uint16_t b) {
+  const int16_t d = (int16_t)(a - b);
+  const int16_t sign = d >> 15;
+  return (uint16_t)((d ^ sign) - sign);
+}
+
+/**
+ * @brief Replace the samples further than the threshold from the median by
+ * the median and return the mean.
+ */
+static uint16_t hampel(uint16_t* v) {
+  Network<N>::sort(v);
+  const uint16_t m = median(v);
+  uint16_t d[N];
+  for (uint8_t i = 0; i < N; i++) d[i] = distance(v[i], m);
+  Network<N>::sort(d);
+  // 1.4826 * MAD estimates the standard deviation of normal noise
+  const uint16_t limit = (uint16_t)(((uint32_t)median(d) * FILTER_HAMPEL_SIGMAS * 1518 + 512) >> 10);
+  uint16_t sum = 0;
+  for (uint8_t i = 0; i < N; i++) {
+    const uint16_t inlier = (uint16_t)-(uint16_t)(distance(v[i], m) <= limit);
+    sum += (v[i] & inlier) | (m & ~inlier);
+  }
+  return (uint16_t)((sum + N / 2) / N);
+}
+
+uint16_t apply(Mode mode, uint16_t* samples) {
+  switch (mode) {
+    case Median:
+      Network<N>::sort(samples);
+      return median(samples);
+    case Trimmed:
+      Network<N>::sort(samples);
+      return mean(samples + FILTER_TRIM, N - 2 * FILTER_TRIM);
+    case Hampel:
+      return hampel(samples);
+    default:
+      return mean(samples, N);
+  }
+}
+
+const __FlashStringHelper* modeName(Mode mode) {
+  switch (mode) {
+    case Median: return F("MEDIAN");
+    case Trimmed: return F("TRIM");
+    case Hampel: return F("HAMPEL");
+    default: return F("MEAN");
+  }
+}
+
+Mode parseMode(const char* name) {
+  for (uint8_t m = 0; m < MODES; m++) {
+    if (strcmp_P(name, (PGM_P)modeName((Mode)m)) == 0) return (Mode)m;
+  }
+  return MODES;
+}
+
+}  // namespace Filter
@@ -0,0 +1,157 @@
+/**
+ * @file filter.hpp
+ * @brief Robust reduction of the raw samples of one reading.
+ *
+ * The mean of the samples lets a single spike (pump switching, a loose
+ * connector) pull the reading. The other modes sort the samples first and
+ * then take the median, the mean without the @ref FILTER_TRIM lowest and
+ * highest samples, or the mean after replacing every sample further than
+ * @ref FILTER_HAMPEL_SIGMAS estimated standard deviations from the median
+ * by the median (Hampel identifier; the deviation is estimated from the
+ * median absolute deviation, which a second sort provides).
+ *
+ * The sort is a Batcher odd-even merge network generated at compile time
+ * for the sample count: the network of the next power of two, without the
+ * comparators that reach past the last sample (those would only compare
+ * with padding that sorts last). Every compare-exchange is branch-free, so
+ * the cost of a filter does not depend on the data.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Filter
+ * @brief Mean, median, trimmed mean and Hampel filter over sorted samples.
+ */
+namespace Filter {
+
+/**
+ * @brief How the samples of a reading are reduced.
+ */
+enum Mode : uint8_t {
+  Mean,     ///< plain rounded mean
+  Median,   ///< middle sample (mean of the middle two for an even count)
+  Trimmed,  ///< mean without @ref FILTER_TRIM samples at each end
+  Hampel,   ///< mean after replacing outliers by the median
+  MODES
+};
+
+/**
+ * @brief Sort @p a and @p b in place without a branch. Both must be below
+ * 32768 (raw ADC values are), so their difference keeps its sign.
+ */
+inline void compareExchange(uint16_t& a, uint16_t& b) {
+  const uint16_t swap = (uint16_t)((int16_t)(b - a) >> 15);  // all ones if b < a
+  const uint16_t diff = (uint16_t)((a ^ b) & swap);
+  a ^= diff;
+  b ^= diff;
+}
+
+/** Smallest power of two not below @p n. */
+constexpr uint8_t powerOfTwo(uint8_t n, uint8_t p = 1) {
+  return p >= n ? p : powerOfTwo(n, (uint8_t)(p * 2));
+}
+
+/** Comparator (I, J) of an @p N sample network; dropped if J is padding. */
+template <uint8_t N, uint8_t I, uint8_t J, bool Used = (J < N)>
+struct Comparator {
+  static constexpr uint8_t COUNT = 1;
+  static inline void apply(uint16_t* v) {
+    compareExchange(v[I], v[J]);
+  }
+};
+
+template <uint8_t N, uint8_t I, uint8_t J>
+struct Comparator<N, I, J, false> {
+  static constexpr uint8_t COUNT = 0;
+  static inline void apply(uint16_t*) {}
+};
+
+/** Comparators (i, i + R) for i = I, I + 2R, ... below End. */
+template <uint8_t N, uint8_t I, uint8_t End, uint8_t R, bool More = (I < End)>
+struct MergeStep {
+  static constexpr uint8_t COUNT = Comparator<N, I, I + R>::COUNT + MergeStep<N, I + 2 * R, End, R>::COUNT;
+  static inline void apply(uint16_t* v) {
+    Comparator<N, I, I + R>::apply(v);
+    MergeStep<N, I + 2 * R, End, R>::apply(v);
+  }
+};
+
+template <uint8_t N, uint8_t I, uint8_t End, uint8_t R>
+struct MergeStep<N, I, End, R, false> {
+  static constexpr uint8_t COUNT = 0;
+  static inline void apply(uint16_t*) {}
+};
+
+/** Odd-even merge of the sorted halves of Lo..Hi (inclusive), elements R apart. */
+template <uint8_t N, uint8_t Lo, uint8_t Hi, uint8_t R, bool Split = (2 * R < Hi - Lo)>
+struct Merge {
+  static constexpr uint8_t COUNT = Merge<N, Lo, Hi, 2 * R>::COUNT + Merge<N, Lo + R, Hi, 2 * R>::COUNT
+                                   + MergeStep<N, Lo + R, Hi - R, R>::COUNT;
+  static inline void apply(uint16_t* v) {
+    Merge<N, Lo, Hi, 2 * R>::apply(v);
+    Merge<N, Lo + R, Hi, 2 * R>::apply(v);
+    MergeStep<N, Lo + R, Hi - R, R>::apply(v);
+  }
+};
+
+template <uint8_t N, uint8_t Lo, uint8_t Hi, uint8_t R>
+struct Merge<N, Lo, Hi, R, false> {
+  static constexpr uint8_t COUNT = Comparator<N, Lo, Lo + R>::COUNT;
+  static inline void apply(uint16_t* v) {
+    Comparator<N, Lo, Lo + R>::apply(v);
+  }
+};
+
+/** Sort Lo..Hi (inclusive) of an @p N sample network. */
+template <uint8_t N, uint8_t Lo, uint8_t Hi, bool Split = (Hi > Lo)>
+struct Sort {
+  static constexpr uint8_t MID = Lo + (Hi - Lo) / 2;
+  static constexpr uint8_t COUNT = Sort<N, Lo, MID>::COUNT + Sort<N, MID + 1, Hi>::COUNT + Merge<N, Lo, Hi, 1>::COUNT;
+  static inline void apply(uint16_t* v) {
+    Sort<N, Lo, MID>::apply(v);
+    Sort<N, MID + 1, Hi>::apply(v);
+    Merge<N, Lo, Hi, 1>::apply(v);
+  }
+};
+
+template <uint8_t N, uint8_t Lo, uint8_t Hi>
+struct Sort<N, Lo, Hi, false> {
+  static constexpr uint8_t COUNT = 0;
+  static inline void apply(uint16_t*) {}
+};
+
+/**
+ * @brief Sorting network for @p N values.
+ */
+template <uint8_t N>
+struct Network {
+  static_assert(N >= 1 && N <= 16, "Sorting networks are generated for 1-16 values");
+  /** Compare-exchanges of the network. */
+  static constexpr uint8_t COMPARATORS = Sort<N, 0, powerOfTwo(N) - 1>::COUNT;
+  /** Sort @p v ascending. */
+  static inline void sort(uint16_t* v) {
+    Sort<N, 0, powerOfTwo(N) - 1>::apply(v);
+  }
+};
+
+/**
+ * @brief Reduce @ref FILTER_SAMPLES raw samples (below 32768) with @p mode.
+ * The samples are reordered.
+ * @return The filtered raw value, rounded.
+ */
+uint16_t apply(Mode mode, uint16_t* samples);
+
+/**
+ * @brief Name of @p mode as used by the CFG command (MEAN, MEDIAN, TRIM,
+ * HAMPEL).
+ */
+const __FlashStringHelper* modeName(Mode mode);
+
+/**
+ * @brief Mode named @p name; @ref MODES if there is none.
+ */
+Mode parseMode(const char* name);
+
+}  // namespace Filter
@@ -0,0 +1,376 @@
+/**
+ * @file hal.hpp
+ * @brief Thin hardware abstraction layer for the peripherals used by Plant Monitor.
+ *
+ * On the target (@c ARDUINO defined) the HAL functions map directly onto the
+ * AVR registers. On any other platform they are implemented by
+ * @ref hal_host.cpp on top of simulated peripherals, so the firmware logic
+ * can be exercised on a PC.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "config.hpp"
+
+#if defined(ARDUINO)
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <EEPROM.h>
+#if !defined(TWI_ASYNC)
+#include <Wire.h>
+#endif  // !TWI_ASYNC
+#include <U8g2lib.h>
+
+/**
+ * @brief Place a variable in .noinit: the C runtime does not clear it, so
+ * it keeps its content across a watchdog or external reset (@ref Snapshot).
+ */
+#define NOINIT __attribute__((section(".noinit")))
+
+// Timer0 counters of the Arduino core (wiring.c), see Hal::timer0Compensate()
+extern "C" volatile unsigned long timer0_millis;
+extern "C" volatile unsigned long timer0_overflow_count;
+#endif  // ARDUINO
+
+/**
+ * @namespace Hal
+ * @brief Register-level helpers shared by the firmware modules.
+ */
+namespace Hal {
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////   DISPLAY   ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(ARDUINO) && defined(TWI_ASYNC)
+/** U8x8 byte procedure that hands the display transfers to @ref Twi. */
+uint8_t u8x8ByteTwi(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr);
+
+/**
+ * @brief OLED driver: 128x64 SH1106 over the interrupt-driven @ref Twi
+ * driver, two tile rows per page.
+ */
+class Display : public U8G2 {
+public:
+  Display(const u8g2_cb_t* rotation, uint8_t reset = U8X8_PIN_NONE)
+    : U8G2() {
+    u8g2_Setup_sh1106_i2c_128x64_noname_2(&u8g2, rotation, u8x8ByteTwi, u8x8_gpio_and_delay_arduino);
+    u8x8_SetPin_HW_I2C(getU8x8(), reset, U8X8_PIN_NONE, U8X8_PIN_NONE);
+  }
+};
+#elif defined(ARDUINO)
+/** OLED driver: 128x64 SH1106 over hardware I2C, two tile rows per page. */
+typedef U8G2_SH1106_128X64_NONAME_2_HW_I2C Display;
+#else
+typedef HostDisplay Display;
+#endif  // ARDUINO
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////     TWI     ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Bus actions of the TWI unit, see @ref twiAct().
+ */
+enum TwiAction : uint8_t {
+  TwiStart,      ///< (repeated) START
+  TwiWrite,      ///< send the data byte
+  TwiReadAck,    ///< receive a byte and acknowledge it
+  TwiReadNack,   ///< receive the last byte
+  TwiStop,       ///< STOP; no interrupt follows
+  TwiStopStart   ///< STOP followed by a START
+};
+
+#if defined(ARDUINO)
+
+/**
+ * @brief Enable the TWI unit with its interrupt at @p clock Hz (prescaler 1)
+ * and the internal pull-ups on SDA/SCL.
+ */
+inline void twiInit(uint32_t clock) {
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+  TWSR = 0;
+  TWBR = (uint8_t)((F_CPU / clock - 16) / 2);
+  TWCR = (1 << TWEN) | (1 << TWIE);
+}
+
+/**
+ * @brief Issue @p action; every action but @ref TwiStop ends with @c TWI_vect.
+ * @param data Byte sent by @ref TwiWrite.
+ */
+inline void twiAct(TwiAction action, uint8_t data = 0) {
+  const uint8_t run = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+  switch (action) {
+    case TwiStart:
+      while (TWCR & (1 << TWSTO)) {}  // a STOP is still being sent (a few µs)
+      TWCR = run | (1 << TWSTA);
+      break;
+    case TwiWrite:
+      TWDR = data;
+      TWCR = run;
+      break;
+    case TwiReadAck:
+      TWCR = run | (1 << TWEA);
+      break;
+    case TwiReadNack:
+      TWCR = run;
+      break;
+    case TwiStop:
+      TWCR = run | (1 << TWSTO);
+      break;
+    case TwiStopStart:
+      TWCR = run | (1 << TWSTO) | (1 << TWSTA);
+      break;
+  }
+}
+
+/**
+ * @brief Status of the last bus action (TWSR without the prescaler bits).
+ */
+inline uint8_t twiStatus() {
+  return TWSR & 0xF8;
+}
+
+/**
+ * @brief Last received byte.
+ */
+inline uint8_t twiData() {
+  return TWDR;
+}
+
+/**
+ * @brief Free a bus held by a slave and leave it idle.
+ *
+ * Disables the TWI unit, clocks SCL until the slave releases SDA (at most
+ * nine clocks finish any byte it was sending) and sends a STOP. Takes about
+ * 100 µs; call @ref twiInit() afterwards.
+ */
+inline void twiRecover() {
+  TWCR = 0;
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, OUTPUT);
+  for (uint8_t i = 0; i < 9 && digitalRead(SDA) == LOW; i++) {
+    digitalWrite(SCL, LOW);
+    delayMicroseconds(5);
+    digitalWrite(SCL, HIGH);
+    delayMicroseconds(5);
+  }
+  // STOP: SDA rises while SCL is high
+  digitalWrite(SCL, LOW);
+  pinMode(SDA, OUTPUT);
+  digitalWrite(SDA, LOW);
+  delayMicroseconds(5);
+  digitalWrite(SCL, HIGH);
+  delayMicroseconds(5);
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, INPUT_PULLUP);
+}
+
+/**
+ * @brief Called in loops that wait for an interrupt to make progress.
+ * Nothing to do on the target, the interrupt simply fires.
+ */
+inline void spinWait() {}
+
+#else
+
+void twiInit(uint32_t clock);
+void twiAct(TwiAction action, uint8_t data = 0);
+uint8_t twiStatus();
+uint8_t twiData();
+void twiRecover();
+/** Host: advance the virtual clock to the next simulated event. */
+void spinWait();
+
+#endif  // ARDUINO
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////     ADC     ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(ARDUINO)
+
+/**
+ * @brief Select the input channel of @p pin and enable the ADC complete
+ * interrupt without starting a conversion.
+ *
+ * The conversion is started by @ref adcTrigger() or by entering
+ * @ref SleepAdc.
+ * @param pin Arduino analog pin (A0..A7) or raw channel number.
+ */
+inline void adcSelect(uint8_t pin) {
+  uint8_t channel = (pin >= A0) ? (pin - A0) : pin;
+  ADMUX = (ANALOG_REF << REFS0) | (channel & 0x07);
+  ADCSRA |= (1 << ADIE);
+}
+
+/**
+ * @brief Start a conversion on the selected channel.
+ */
+inline void adcTrigger() {
+  ADCSRA |= (1 << ADSC);
+}
+
+/**
+ * @brief Select the input channel of @p pin and start a single conversion.
+ *
+ * The ADC complete interrupt is enabled, so @c ADC_vect fires once the
+ * result is available (~104 µs with the core's prescaler of 128).
+ * @param pin Arduino analog pin (A0..A7) or raw channel number.
+ */
+inline void adcStart(uint8_t pin) {
+  adcSelect(pin);
+  adcTrigger();
+}
+
+/**
+ * @brief Disable the ADC complete interrupt so analogRead() can poll again.
+ */
+inline void adcStop() {
+  ADCSRA &= ~(1 << ADIE);
+}
+
+/**
+ * @brief Return the result of the last conversion.
+ */
+inline uint16_t adcResult() {
+  return ADC;
+}
+
+#else
+
+void adcSelect(uint8_t pin);
+void adcTrigger();
+void adcStart(uint8_t pin);
+void adcStop();
+uint16_t adcResult();
+
+#endif  // ARDUINO
+
+#if defined(SENSOR_MUX)
+/**
+ * @brief Route channel @p channel (0–15) of the analog multiplexer to
+ * @ref MUX_SIG_PIN. Safe to call from an ISR.
+ */
+inline void muxSelect(uint8_t channel) {
+  digitalWrite(MUX_S0_PIN, channel & 0x01);
+  digitalWrite(MUX_S1_PIN, (channel >> 1) & 0x01);
+  digitalWrite(MUX_S2_PIN, (channel >> 2) & 0x01);
+  digitalWrite(MUX_S3_PIN, (channel >> 3) & 0x01);
+}
+#endif  // SENSOR_MUX
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////   TIMER1    ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(ARDUINO)
+
+/**
+ * @brief Current Timer1 count. Call with interrupts disabled (the 16-bit
+ * access goes through the shared TEMP register).
+ */
+inline uint16_t timer1Count() {
+  return TCNT1;
+}
+
+/**
+ * @brief Continue the current Timer1 period from @p count and discard a
+ * pending compare match. Call with interrupts disabled.
+ */
+inline void timer1SetCount(uint16_t count) {
+  TCNT1 = count;
+  TIFR1 = (1 << OCF1A);
+}
+
+/**
+ * @brief True if a compare match occurred whose interrupt has not run yet.
+ */
+inline bool timer1Pending() {
+  return TIFR1 & (1 << OCF1A);
+}
+
+#else
+
+uint16_t timer1Count();
+void timer1SetCount(uint16_t count);
+/** Host: interrupts run as soon as they are due, so never true. */
+inline bool timer1Pending() {
+  return false;
+}
+
+#endif  // ARDUINO
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////    POWER    ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Sleep modes used by @ref Power.
+ */
+enum SleepMode : uint8_t {
+  SleepIdle,  ///< CPU stopped, all peripherals and timers keep running
+  SleepAdc    ///< ADC noise reduction: I/O clock stopped, starts a pending conversion
+};
+
+#if defined(ARDUINO)
+
+/**
+ * @brief Enter @p mode until the next wake-up interrupt.
+ *
+ * Call with interrupts disabled: they are re-enabled together with the sleep
+ * instruction, so an interrupt arriving after the caller's checks still
+ * wakes the CPU instead of being missed.
+ */
+inline void sleep(SleepMode mode) {
+  set_sleep_mode(mode == SleepAdc ? SLEEP_MODE_ADC : SLEEP_MODE_IDLE);
+  sleep_enable();
+  sei();
+  sleep_cpu();
+  sleep_disable();
+}
+
+/**
+ * @brief Add @p us during which Timer0 stood still (ADC noise-reduction
+ * sleep) to millis() and micros(), as the core's overflow interrupt would
+ * have; the remainders below one millisecond and one overflow carry over.
+ */
+inline void timer0Compensate(uint16_t us) {
+  static uint16_t msRest = 0;
+  static uint16_t overflowRest = 0;
+  uint8_t s = SREG;
+  cli();
+  msRest += us;
+  while (msRest >= 1000) {
+    msRest -= 1000;
+    timer0_millis++;
+  }
+  overflowRest += us;
+  while (overflowRest >= 1024) {  // 64 * 256 CPU cycles at 16 MHz
+    overflowRest -= 1024;
+    timer0_overflow_count++;
+  }
+  SREG = s;
+}
+
+/**
+ * @brief True when the UART has no byte queued or on the wire.
+ *
+ * TXC0 is cleared by every write and set once the last stop bit is out.
+ */
+inline bool uartTxIdle() {
+  return Serial.availableForWrite() >= SERIAL_TX_BUFFER_SIZE - 1 && (UCSR0A & (1 << TXC0));
+}
+
+#else
+
+void sleep(SleepMode mode);
+void timer0Compensate(uint16_t us);
+bool uartTxIdle();
+
+#endif  // ARDUINO
+
+}  // namespace Hal
@@ -0,0 +1,886 @@
+/**
+ * @file hal_host.cpp
+ * @brief Simulated peripherals and virtual clock for host builds.
+ *
+ * Compiled to nothing on the target. On a PC it implements the Arduino
+ * subset declared in @ref hal_host.hpp and the @ref Hal functions, so the
+ * firmware modules run unchanged against deterministic, scriptable inputs.
+ */
+#if !defined(ARDUINO)
+
+#include "hal.hpp"
+#include "adc.hpp"
+#include "twi.hpp"
+
+// Interrupt handlers provided by the sketch; weak so harnesses may omit them.
+extern "C" void hal_isr_timer1_compa() __attribute__((weak));
+
+volatile uint8_t SREG = 0x80;
+volatile uint8_t MCUSR = (1 << PORF);
+volatile uint8_t TCCR1A = 0;
+volatile uint8_t TCCR1B = 0;
+volatile uint8_t TIMSK1 = 0;
+volatile uint16_t OCR1A = 0;
+volatile uint16_t TCNT1 = 0;
+
+HardwareSerial Serial;
+TwoWire Wire;
+EEPROMClass EEPROM;
+
+namespace Hal {
+namespace Sim {
+
+static uint64_t now = 0;  // never wraps; millis()/micros() truncate to 32 bit like the AVR core
+// Time the I/O clock was stopped (ADC noise reduction); Timer0 did not count it.
+static uint64_t ioStoppedUs = 0;
+// The last ADC noise-reduction sleeps (start and end), for ioStoppedDuring().
+static uint64_t stopStart[8] = { 0 };
+static uint64_t stopEnd[8] = { 0 };
+static uint8_t stopNext = 0;
+static const unsigned long TIMER0_OVERFLOW_US = 1024;
+static Counters stats = {};
+
+// ADC: a started conversion completes ADC_CONVERSION_US later.
+static AnalogSource analogSource = nullptr;
+static uint16_t analogValues[8] = { 0 };
+static bool adcPending = false;
+static bool adcIrqEnabled = false;
+static uint8_t adcPin = 0;
+static uint64_t adcDoneAt = 0;
+static uint16_t adcValue = 0;
+
+// Digital pins: level written last (LOW/HIGH); unwritten pins read HIGH.
+static bool digitalLow[32] = { false };
+
+// Timer1 in CTC mode, compare match A.
+static bool timer1Armed = false;
+static uint64_t timer1Next = 0;
+
+// Extra periodic interrupt of the harness.
+static void (*periodicHandler)() = nullptr;
+static unsigned long periodicUs = 0;
+static uint64_t periodicNext = 0;
+
+// Watchdog.
+static bool wdtEnabled = false;
+static uint64_t wdtDeadline = 0;
+static const unsigned long WDT_TIMEOUT_US = 8000000UL;
+
+// UART: bytes drain one per byteUs; the buffer holds SERIAL_TX_BUFFER_SIZE.
+static unsigned long serialByteUs = 87;
+static uint8_t txUsed = 0;
+static uint64_t txNextDone = 0;
+static uint8_t rxBuffer[SERIAL_RX_BUFFER_SIZE];
+static uint8_t rxHead = 0;
+static uint8_t rxTail = 0;
+static void stdoutSink(uint8_t c) {
+  putchar(c);
+}
+static SerialSink serialSink = stdoutSink;
+
+// I2C bus.
+static uint32_t i2cClock = 100000UL;
+static I2cDevice i2cDevices[4];
+static uint8_t i2cDeviceCount = 0;
+static uint8_t i2cAddress = 0;
+static uint8_t i2cTx[32];
+static uint8_t i2cTxLen = 0;
+static uint8_t i2cRx[32];
+static uint8_t i2cRxLen = 0;
+static uint8_t i2cRxPos = 0;
+// The display answers at its address even without an attached device.
+static I2cDevice displayDevice = { HostDisplay::I2C_ADDRESS, nullptr, nullptr };
+
+// TWI unit: every bus action completes after its bus time and raises TWI_vect.
+enum TwiPhase : uint8_t { TwiBusIdle,
+                          TwiAddress,
+                          TwiWriting,
+                          TwiReading,
+                          TwiRejected };
+static bool twiPending = false;
+static uint64_t twiDoneAt = 0;
+static uint8_t twiStatusReg = 0xF8;
+static uint8_t twiNextStatus = 0xF8;
+static uint8_t twiDataReg = 0;
+static uint8_t twiPhase = TwiBusIdle;
+static I2cDevice *twiDevice = nullptr;
+static uint32_t twiRemainderNs = 0;
+static bool i2cStuck = false;
+
+// EEPROM.
+static uint8_t eeprom[E2END + 1];
+static uint16_t eepromWear[E2END + 1];
+static uint64_t eepromBusyUntil = 0;
+static bool eepromInitialized = false;
+
+static uint16_t convert(uint8_t pin) {
+  stats.adcConversions++;
+#if defined(SENSOR_MUX)
+  if (pin == MUX_SIG_PIN) {
+    // the multiplexer routes the channel selected on S0..S3 to the common pin
+    uint8_t channel = (!digitalLow[MUX_S0_PIN]) | (!digitalLow[MUX_S1_PIN] << 1)
+                      | (!digitalLow[MUX_S2_PIN] << 2) | (!digitalLow[MUX_S3_PIN] << 3);
+    pin = MUX_PIN_BASE + channel;
+  }
+#endif  // SENSOR_MUX
+  uint16_t raw = analogSource ? analogSource(pin, (unsigned long)(uint32_t)now) : analogValues[(pin >= A0 ? pin - A0 : pin) & 0x07];
+  return raw > 1023 ? 1023 : raw;
+}
+
+static uint16_t timer1Prescaler() {
+  static const uint16_t prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+  return prescalers[TCCR1B & 0x07];
+}
+
+static void updateTimer1() {
+  uint16_t prescaler = timer1Prescaler();
+  bool armed = (TIMSK1 & (1 << OCIE1A)) && prescaler;
+  if (armed && !timer1Armed) {
+    timer1Next = now + ((uint64_t)OCR1A + 1 - TCNT1) * prescaler / (F_CPU / 1000000UL);
+  }
+  timer1Armed = armed;
+}
+
+static uint64_t timer1Period() {
+  return ((uint64_t)OCR1A + 1) * timer1Prescaler() / (F_CPU / 1000000UL);
+}
+
+/** Charge the bus time of @p bytes on the I2C bus to the virtual clock. */
+static void i2cTransfer(unsigned long bytes) {
+  // 9 clocks per byte (8 data + ACK) plus start/stop
+  unsigned long us = (unsigned long)(((uint64_t)bytes * 9 + 2) * 1000000ULL / i2cClock);
+  stats.i2cBytes += bytes;
+  stats.i2cBusUs += us;
+  advanceMicros(us);
+}
+
+static I2cDevice *findDevice(uint8_t address) {
+  for (uint8_t i = 0; i < i2cDeviceCount; i++) {
+    if (i2cDevices[i].address == address) return &i2cDevices[i];
+  }
+  return address == displayDevice.address ? &displayDevice : nullptr;
+}
+
+/** Bus time of @p bits clocks, keeping the sub-microsecond remainder. */
+static unsigned long twiBusTime(uint8_t bits) {
+  uint32_t ns = (uint32_t)bits * (1000000000UL / i2cClock) + twiRemainderNs;
+  twiRemainderNs = ns % 1000;
+  return ns / 1000;
+}
+
+/** A STOP or repeated START ends a write: hand the bytes to the device. */
+static void twiEndWrite() {
+  if (twiPhase == TwiWriting && twiDevice && twiDevice->onWrite) twiDevice->onWrite(i2cTx, i2cTxLen);
+  twiDevice = nullptr;
+}
+
+static void initEeprom() {
+  if (eepromInitialized) return;
+  memset(eeprom, 0xFF, sizeof(eeprom));  // erased state
+  eepromInitialized = true;
+}
+
+static void waitEeprom() {
+  if (now < eepromBusyUntil) {
+    stats.eepromStallUs += (unsigned long)(eepromBusyUntil - now);
+    advanceMicros((unsigned long)(eepromBusyUntil - now));
+  }
+}
+
+void setI2cStuck(bool stuck) {
+  i2cStuck = stuck;
+}
+
+void setPeriodicInterrupt(unsigned long periodUs, void (*handler)()) {
+  periodicHandler = periodUs ? handler : nullptr;
+  periodicUs = periodUs;
+  periodicNext = now + periodUs;
+}
+
+void setAnalogSource(AnalogSource source) {
+  analogSource = source;
+}
+
+void setAnalogValue(uint8_t pin, uint16_t value) {
+  analogValues[(pin >= A0 ? pin - A0 : pin) & 0x07] = value;
+}
+
+uint64_t nowMicros() {
+  return now;
+}
+
+void setSerialSink(SerialSink sink) {
+  serialSink = sink;
+}
+
+size_t serialInject(const char *s) {
+  size_t accepted = 0;
+  for (; *s; s++) {
+    uint8_t next = (uint8_t)((rxHead + 1) % SERIAL_RX_BUFFER_SIZE);
+    if (next == rxTail) break;  // overflow, rest is lost
+    rxBuffer[rxHead] = (uint8_t)*s;
+    rxHead = next;
+    accepted++;
+  }
+  return accepted;
+}
+
+bool ioStoppedDuring(uint64_t fromUs, uint64_t toUs) {
+  for (uint8_t i = 0; i < 8; i++) {
+    if (stopStart[i] < toUs && stopEnd[i] > fromUs) return true;
+  }
+  return false;
+}
+
+bool attachI2cDevice(const I2cDevice &device) {
+  if (i2cDeviceCount >= sizeof(i2cDevices) / sizeof(i2cDevices[0])) return false;
+  i2cDevices[i2cDeviceCount++] = device;
+  return true;
+}
+
+Counters &counters() {
+  return stats;
+}
+
+const uint16_t *eepromWearMap() {
+  return eepromWear;
+}
+
+uint8_t *eepromData() {
+  initEeprom();
+  return eeprom;
+}
+
+// Bounds of the "noinit" section, provided by the linker; weak, so they are
+// null if no variable is declared NOINIT.
+extern "C" uint8_t __start_noinit[] __attribute__((weak));
+extern "C" uint8_t __stop_noinit[] __attribute__((weak));
+
+uint8_t *noinitData() {
+  return __start_noinit;
+}
+
+size_t noinitSize() {
+  return (size_t)(__stop_noinit - __start_noinit);
+}
+
+void advanceMicros(unsigned long us) {
+  enum Event : uint8_t { None,
+                         AdcDone,
+                         TwiDone,
+                         Timer1,
+                         TxDone,
+                         Watchdog,
+                         Periodic };
+  const uint64_t target = now + us;
+  for (;;) {
+    uint64_t due = target;
+    Event ev = None;
+    updateTimer1();
+    if (adcPending && adcIrqEnabled && adcDoneAt <= due) {
+      due = adcDoneAt;
+      ev = AdcDone;
+    }
+    if (twiPending && twiDoneAt <= due && (ev == None || twiDoneAt < due)) {
+      due = twiDoneAt;
+      ev = TwiDone;
+    }
+    if (timer1Armed && timer1Next <= due && (ev == None || timer1Next < due)) {
+      due = timer1Next;
+      ev = Timer1;
+    }
+    if (txUsed && txNextDone <= due && (ev == None || txNextDone < due)) {
+      due = txNextDone;
+      ev = TxDone;
+    }
+    if (wdtEnabled && wdtDeadline <= due && (ev == None || wdtDeadline < due)) {
+      due = wdtDeadline;
+      ev = Watchdog;
+    }
+    if (periodicHandler && periodicNext <= due && (ev == None || periodicNext < due)) {
+      due = periodicNext;
+      ev = Periodic;
+    }
+    if (ev == None) break;
+
+    now = due;
+    switch (ev) {
+      case AdcDone:
+        adcPending = false;
+        adcValue = convert(adcPin);
+        Adc::onConversionComplete(adcValue);  // ADC_vect
+        break;
+      case TwiDone:
+        twiPending = false;
+        twiStatusReg = twiNextStatus;
+#if defined(TWI_ASYNC)
+        Twi::onInterrupt();  // TWI_vect
+#endif  // TWI_ASYNC
+        break;
+      case Timer1:
+        stats.timer1Interrupts++;
+        timer1Next += timer1Period();
+        if (hal_isr_timer1_compa) hal_isr_timer1_compa();
+        break;
+      case TxDone:
+        txUsed--;
+        txNextDone += serialByteUs;
+        break;
+      case Watchdog:
+        stats.watchdogExpiries++;
+        wdtDeadline = now + WDT_TIMEOUT_US;
+        break;
+      case Periodic:
+        periodicNext += periodicUs;
+        periodicHandler();
+        break;
+      default:
+        break;
+    }
+  }
+  now = target;
+}
+
+}  // namespace Sim
+
+uint16_t timer1Count() {
+  using namespace Sim;
+  updateTimer1();
+  if (!timer1Armed) return TCNT1;
+  // whole timer ticks left until the compare match
+  uint64_t usPerTick = timer1Prescaler() / (F_CPU / 1000000UL);
+  uint64_t left = (timer1Next - now + usPerTick - 1) / usPerTick;
+  return (uint16_t)(OCR1A + 1 - left);
+}
+
+void timer1SetCount(uint16_t count) {
+  using namespace Sim;
+  updateTimer1();
+  TCNT1 = count;
+  if (!timer1Armed) return;
+  // The prescaler keeps running, so the next count still comes at the
+  // same time; only the counts after it move.
+  uint64_t usPerTick = timer1Prescaler() / (F_CPU / 1000000UL);
+  uint64_t edge = (timer1Next - now - 1) % usPerTick + 1;
+  timer1Next = now + edge + ((uint64_t)OCR1A - count) * usPerTick;
+}
+
+void adcSelect(uint8_t pin) {
+  Sim::adcPin = pin;
+  Sim::adcIrqEnabled = true;
+}
+
+void adcTrigger() {
+  Sim::adcPending = true;
+  Sim::adcDoneAt = Sim::now + Sim::ADC_CONVERSION_US;
+}
+
+void adcStart(uint8_t pin) {
+  adcSelect(pin);
+  adcTrigger();
+}
+
+void adcStop() {
+  Sim::adcIrqEnabled = false;
+}
+
+uint16_t adcResult() {
+  return Sim::adcValue;
+}
+
+void sleep(SleepMode mode) {
+  using namespace Sim;
+  if (mode == SleepAdc) {
+    // Entering ADC noise reduction starts a pending conversion; the I/O
+    // clock stops, so Timer0 (millis/micros) and Timer1 stand still until
+    // the conversion-complete interrupt wakes the CPU.
+    if (adcIrqEnabled && !adcPending) adcTrigger();
+    if (!adcPending || !adcIrqEnabled) return;
+    unsigned long us = (unsigned long)(adcDoneAt - now);
+    stopStart[stopNext] = now;
+    stopEnd[stopNext] = adcDoneAt;
+    stopNext = (uint8_t)((stopNext + 1) % 8);
+    ioStoppedUs += us;
+    timer1Next += us;
+    stats.sleepAdcUs += us;
+    advanceMicros(us);
+    return;
+  }
+  // Idle: any interrupt wakes the CPU, at the latest the next Timer0
+  // overflow (every 1024 us) that drives millis().
+  if (rxHead != rxTail) return;
+  uint64_t wake = ((now - ioStoppedUs) / TIMER0_OVERFLOW_US + 1) * TIMER0_OVERFLOW_US + ioStoppedUs;
+  updateTimer1();
+  if (adcPending && adcIrqEnabled && adcDoneAt < wake) wake = adcDoneAt;
+  if (twiPending && twiDoneAt < wake) wake = twiDoneAt;
+  if (timer1Armed && timer1Next < wake) wake = timer1Next;
+  if (txUsed && txNextDone < wake) wake = txNextDone;
+  unsigned long us = (unsigned long)(wake - now);
+  stats.sleepIdleUs += us;
+  advanceMicros(us);
+}
+
+void timer0Compensate(uint16_t us) {
+  Sim::ioStoppedUs -= us < Sim::ioStoppedUs ? us : Sim::ioStoppedUs;
+}
+
+bool uartTxIdle() {
+  return Sim::txUsed == 0;
+}
+
+void twiInit(uint32_t clock) {
+  Sim::i2cClock = clock;
+  Sim::twiPending = false;
+  Sim::twiPhase = Sim::TwiBusIdle;
+}
+
+void twiAct(TwiAction action, uint8_t data) {
+  using namespace Sim;
+  unsigned long us;
+  uint8_t status;
+  switch (action) {
+    case TwiStart:
+    case TwiStopStart:
+      twiEndWrite();
+      if (action == TwiStopStart) twiPhase = TwiBusIdle;
+      if (i2cStuck) return;  // SDA held low: the START never completes
+      status = twiPhase == TwiBusIdle ? 0x08 : 0x10;
+      twiPhase = TwiAddress;
+      us = twiBusTime(action == TwiStopStart ? 2 : 1);
+      break;
+    case TwiWrite:
+      stats.i2cBytes++;
+      us = twiBusTime(9);
+      if (twiPhase == TwiAddress) {
+        I2cDevice *dev = findDevice(data >> 1);
+        bool read = data & 1;
+        if (!dev) {
+          twiPhase = TwiRejected;
+          status = read ? 0x48 : 0x20;
+        } else if (read) {
+          i2cRxLen = dev->onRead ? dev->onRead(i2cRx, sizeof(i2cRx)) : 0;
+          i2cRxPos = 0;
+          twiPhase = TwiReading;
+          status = 0x40;
+        } else {
+          twiDevice = dev;
+          i2cTxLen = 0;
+          twiPhase = TwiWriting;
+          status = 0x18;
+        }
+      } else {
+        if (i2cTxLen < sizeof(i2cTx)) i2cTx[i2cTxLen++] = data;
+        status = 0x28;
+      }
+      break;
+    case TwiReadAck:
+    case TwiReadNack:
+      stats.i2cBytes++;
+      us = twiBusTime(9);
+      twiDataReg = i2cRxPos < i2cRxLen ? i2cRx[i2cRxPos++] : 0xFF;
+      status = action == TwiReadAck ? 0x50 : 0x58;
+      break;
+    case TwiStop:
+    default:
+      twiEndWrite();
+      twiPhase = TwiBusIdle;
+      stats.i2cBusUs += twiBusTime(1);
+      return;
+  }
+  stats.i2cBusUs += us;
+  twiNextStatus = status;
+  twiDoneAt = now + us;
+  twiPending = true;
+}
+
+uint8_t twiStatus() {
+  return Sim::twiStatusReg;
+}
+
+uint8_t twiData() {
+  return Sim::twiDataReg;
+}
+
+void twiRecover() {
+  // nine clocks free the slave holding SDA; bit-banged by the CPU
+  Sim::twiPending = false;
+  Sim::twiPhase = Sim::TwiBusIdle;
+  Sim::twiDevice = nullptr;
+  Sim::i2cStuck = false;
+  Sim::advanceMicros(100);
+}
+
+void spinWait() {
+  using namespace Sim;
+  uint64_t wake = now + 64;
+  if (twiPending && twiDoneAt < wake) wake = twiDoneAt;
+  if (adcPending && adcIrqEnabled && adcDoneAt < wake) wake = adcDoneAt;
+  if (txUsed && txNextDone < wake) wake = txNextDone;
+  advanceMicros(wake > now ? (unsigned long)(wake - now) : 1);
+}
+
+}  // namespace Hal
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////    CORE     ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+unsigned long millis() {
+  return (uint32_t)((Hal::Sim::now - Hal::Sim::ioStoppedUs) / 1000UL);
+}
+
+unsigned long micros() {
+  return (uint32_t)(Hal::Sim::now - Hal::Sim::ioStoppedUs);
+}
+
+void delay(unsigned long ms) {
+  Hal::Sim::advanceMicros(ms * 1000UL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  Hal::Sim::advanceMicros(us);
+}
+
+void pinMode(uint8_t /*pin*/, uint8_t /*mode*/) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < sizeof(Hal::Sim::digitalLow)) Hal::Sim::digitalLow[pin] = (val == LOW);
+}
+
+int digitalRead(uint8_t pin) {
+  return (pin < sizeof(Hal::Sim::digitalLow) && Hal::Sim::digitalLow[pin]) ? LOW : HIGH;
+}
+
+int analogRead(uint8_t pin) {
+  Hal::Sim::advanceMicros(Hal::Sim::ADC_CONVERSION_US);
+  return Hal::Sim::convert(pin);
+}
+
+void wdt_enable(uint8_t /*timeout*/) {
+  Hal::Sim::wdtEnabled = true;
+  Hal::Sim::wdtDeadline = Hal::Sim::now + Hal::Sim::WDT_TIMEOUT_US;
+}
+
+void wdt_disable() {
+  Hal::Sim::wdtEnabled = false;
+}
+
+void wdt_reset() {
+  Hal::Sim::wdtDeadline = Hal::Sim::now + Hal::Sim::WDT_TIMEOUT_US;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////    PRINT    ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) {
+    size_t t = print('-');
+    return t + printNumber((unsigned long)(-n), DEC);
+  }
+  return printNumber((unsigned long)n, base);
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = (char)(n % base);
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////  PERIPHERALS  /////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void HardwareSerial::begin(unsigned long baud) {
+  Hal::Sim::serialByteUs = (10000000UL + baud / 2) / baud;  // 8N1 = 10 bits
+}
+
+int HardwareSerial::available() {
+  return (SERIAL_RX_BUFFER_SIZE + Hal::Sim::rxHead - Hal::Sim::rxTail) % SERIAL_RX_BUFFER_SIZE;
+}
+
+int HardwareSerial::peek() {
+  if (Hal::Sim::rxHead == Hal::Sim::rxTail) return -1;
+  return Hal::Sim::rxBuffer[Hal::Sim::rxTail];
+}
+
+int HardwareSerial::read() {
+  if (Hal::Sim::rxHead == Hal::Sim::rxTail) return -1;
+  uint8_t c = Hal::Sim::rxBuffer[Hal::Sim::rxTail];
+  Hal::Sim::rxTail = (uint8_t)((Hal::Sim::rxTail + 1) % SERIAL_RX_BUFFER_SIZE);
+  return c;
+}
+
+int HardwareSerial::availableForWrite() {
+  // The AVR core keeps one ring slot free
+  return SERIAL_TX_BUFFER_SIZE - 1 - (Hal::Sim::txUsed ? Hal::Sim::txUsed - 1 : 0);
+}
+
+void HardwareSerial::flush() {
+  while (Hal::Sim::txUsed) {
+    Hal::Sim::advanceMicros((unsigned long)(Hal::Sim::txNextDone - Hal::Sim::now));
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  using namespace Hal::Sim;
+  if (txUsed >= SERIAL_TX_BUFFER_SIZE) {
+    // buffer full: the AVR core spins until the UDRE interrupt frees a slot
+    unsigned long wait = (unsigned long)(txNextDone - now);
+    stats.serialStallUs += wait;
+    advanceMicros(wait);
+  }
+  if (!txUsed) txNextDone = now + serialByteUs;
+  txUsed++;
+  stats.serialTxBytes++;
+  if (serialSink) serialSink(c);
+  return 1;
+}
+
+void TwoWire::setClock(uint32_t clock) {
+  Hal::Sim::i2cClock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  Hal::Sim::i2cAddress = address;
+  Hal::Sim::i2cTxLen = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (Hal::Sim::i2cTxLen >= sizeof(Hal::Sim::i2cTx)) return 0;
+  Hal::Sim::i2cTx[Hal::Sim::i2cTxLen++] = data;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool /*sendStop*/) {
+  using namespace Hal::Sim;
+  I2cDevice *dev = findDevice(i2cAddress);
+  i2cTransfer(1 + (dev ? i2cTxLen : 0));
+  if (!dev) return 2;  // NACK on address
+  if (dev->onWrite) dev->onWrite(i2cTx, i2cTxLen);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  using namespace Hal::Sim;
+  I2cDevice *dev = findDevice(address);
+  if (quantity > sizeof(i2cRx)) quantity = sizeof(i2cRx);
+  i2cRxLen = (dev && dev->onRead) ? dev->onRead(i2cRx, quantity) : 0;
+  i2cRxPos = 0;
+  i2cTransfer(1 + i2cRxLen);
+  return i2cRxLen;
+}
+
+int TwoWire::available() {
+  return Hal::Sim::i2cRxLen - Hal::Sim::i2cRxPos;
+}
+
+int TwoWire::read() {
+  if (Hal::Sim::i2cRxPos >= Hal::Sim::i2cRxLen) return -1;
+  return Hal::Sim::i2cRx[Hal::Sim::i2cRxPos++];
+}
+
+uint8_t EEPROMClass::read(int idx) {
+  Hal::Sim::initEeprom();
+  Hal::Sim::waitEeprom();
+  return Hal::Sim::eeprom[idx & E2END];
+}
+
+void EEPROMClass::write(int idx, uint8_t val) {
+  using namespace Hal::Sim;
+  initEeprom();
+  waitEeprom();
+  eeprom[idx & E2END] = val;
+  eepromWear[idx & E2END]++;
+  stats.eepromWrites++;
+  eepromBusyUntil = now + EEPROM_WRITE_US;
+}
+
+void EEPROMClass::update(int idx, uint8_t val) {
+  if (read(idx) != val) write(idx, val);
+}
+
+bool eeprom_is_ready() {
+  return Hal::Sim::now >= Hal::Sim::eepromBusyUntil;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////   DISPLAY   ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Glyph metrics: width, height, ascent, descent.
+const uint8_t u8g2_font_profont10_tr[] = { 5, 10, 7, (uint8_t)-2 };
+const uint8_t u8g2_font_profont11_mr[] = { 6, 11, 8, (uint8_t)-2 };
+const uint8_t u8g2_font_profont17_mr[] = { 9, 17, 12, (uint8_t)-4 };
+const uint8_t u8g2_font_profont22_mr[] = { 12, 22, 16, (uint8_t)-5 };
+
+HostDisplay::HostDisplay(uint8_t /*rotation*/, uint8_t /*reset*/) {
+  clearBuffer();
+}
+
+bool HostDisplay::begin() {
+  Wire.begin();
+  clearDisplay();
+  return true;
+}
+
+void HostDisplay::setContrast(uint8_t /*value*/) {
+  Hal::Sim::i2cTransfer(4);  // address, control, command, value
+}
+
+void HostDisplay::setPowerSave(uint8_t /*is_enable*/) {
+  Hal::Sim::i2cTransfer(3);
+}
+
+void HostDisplay::clearDisplay() {
+  firstPage();
+  while (nextPage()) {}
+}
+
+void HostDisplay::firstPage() {
+  currTileRow = 0;
+  clearBuffer();
+}
+
+uint8_t HostDisplay::nextPage() {
+  transmitPage();
+  currTileRow += BUFFER_TILE_ROWS;
+  if (currTileRow >= HEIGHT / 8) {
+    currTileRow = 0;
+    Hal::Sim::stats.displayFrames++;
+    return 0;
+  }
+  clearBuffer();
+  return 1;
+}
+
+void HostDisplay::clearBuffer() {
+  memset(buffer, 0, sizeof(buffer));
+}
+
+void HostDisplay::sendBuffer() {
+  transmitPage();
+}
+
+void HostDisplay::setBufferCurrTileRow(uint8_t row) {
+  currTileRow = row;
+}
+
+void HostDisplay::transmitPage() {
+  // Per tile row the SH1106 needs one command transfer (address, control,
+  // page, column low, column high) and 128 data bytes sent in 32-byte
+  // chunks, each prefixed with address and control byte.
+  uint8_t rows = BUFFER_TILE_ROWS;
+  if (currTileRow + rows > HEIGHT / 8) rows = HEIGHT / 8 - currTileRow;
+  Hal::Sim::stats.displayPages++;
+#if defined(TWI_ASYNC)
+  // the same transfers, handed to the driver like the U8g2 byte callback does
+  static const uint8_t dataControl = 0x40;
+  for (uint8_t r = 0; r < rows; r++) {
+    const uint8_t cmd[] = { 0x00, (uint8_t)(0xB0 | (currTileRow + r)), 0x02, 0x10 };
+    Twi::streamStart(I2C_ADDRESS);
+    Twi::streamSend(cmd, sizeof(cmd));
+    Twi::streamEnd();
+    for (uint8_t x = 0; x < WIDTH; x += 32) {
+      Twi::streamStart(I2C_ADDRESS);
+      Twi::streamSend(&dataControl, 1);
+      Twi::streamSend(&buffer[r * WIDTH + x], 32);
+      Twi::streamEnd();
+    }
+  }
+#else
+  Hal::Sim::i2cTransfer((unsigned long)rows * (5 + (WIDTH / 32) * (2 + 32)));
+#endif  // TWI_ASYNC
+}
+
+int8_t HostDisplay::getAscent() {
+  return font ? (int8_t)font[2] : 0;
+}
+
+int8_t HostDisplay::getDescent() {
+  return font ? (int8_t)font[3] : 0;
+}
+
+int8_t HostDisplay::getMaxCharHeight() {
+  return font ? (int8_t)font[1] : 0;
+}
+
+int8_t HostDisplay::getMaxCharWidth() {
+  return font ? (int8_t)font[0] : 0;
+}
+
+uint16_t HostDisplay::getStrWidth(const char *s) {
+  return font ? (uint16_t)(strlen(s) * font[0]) : 0;
+}
+
+void HostDisplay::drawPixel(int16_t x, int16_t y) {
+  int16_t top = currTileRow * 8;
+  if (x < 0 || x >= WIDTH || y < top || y >= top + BUFFER_TILE_ROWS * 8) return;
+  uint8_t *b = &buffer[((y - top) / 8) * WIDTH + x];
+  uint8_t mask = (uint8_t)(1 << ((y - top) & 7));
+  if (drawColor == 0) *b &= (uint8_t)~mask;
+  else if (drawColor == 1) *b |= mask;
+  else *b ^= mask;
+}
+
+void HostDisplay::drawHLine(int16_t x, int16_t y, int16_t w) {
+  for (int16_t i = 0; i < w; i++) drawPixel(x + i, y);
+}
+
+void HostDisplay::drawBox(int16_t x, int16_t y, int16_t w, int16_t h) {
+  for (int16_t j = 0; j < h; j++) drawHLine(x, y + j, w);
+}
+
+void HostDisplay::drawRBox(int16_t x, int16_t y, int16_t w, int16_t h, int16_t /*r*/) {
+  drawBox(x, y, w, h);
+}
+
+void HostDisplay::drawXBM(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *bitmap) {
+  const int16_t stride = (w + 7) / 8;
+  const uint8_t color = drawColor;
+  for (int16_t j = 0; j < h; j++) {
+    for (int16_t i = 0; i < w; i++) {
+      bool set = bitmap[j * stride + i / 8] & (1 << (i & 7));
+      if (!set && bitmapTransparent) continue;
+      drawColor = set ? color : (uint8_t)!color;
+      drawPixel(x + i, y + j);
+    }
+  }
+  drawColor = color;
+}
+
+size_t HostDisplay::write(uint8_t c) {
+  // Stand-in for the U8g2 glyph decoder: a fixed pattern per character,
+  // drawn pixel by pixel, so text costs time as it does on the target.
+  // Like U8g2, a glyph outside the current page is skipped.
+  int16_t top = cursorY - getAscent();
+  int16_t height = getAscent() - getDescent();
+  int16_t pageTop = currTileRow * 8;
+  if (font && top < pageTop + BUFFER_TILE_ROWS * 8 && top + height > pageTop) {
+    for (int16_t j = 0; j < height; j++) {
+      for (int16_t i = 0; i < getMaxCharWidth() - 1; i++) {
+        if (((c + i * 3 + j * 5) & 3) == 0) drawPixel(cursorX + i, top + j);
+      }
+    }
+  }
+  cursorX += getMaxCharWidth();
+  return 1;
+}
+
+#endif  // !ARDUINO
@@ -0,0 +1,500 @@
+/**
+ * @file hal_host.hpp
+ * @brief Arduino-compatible subset for building the firmware logic on a PC.
+ *
+ * Only included when @c ARDUINO is not defined. Provides the core functions,
+ * types, registers and peripheral objects (Serial, Wire, EEPROM, display) the
+ * sources rely on, backed by a virtual clock and scriptable simulated
+ * peripherals (see @ref Hal::Sim). Timing-relevant behaviour is modelled:
+ * ADC conversions take 104 µs, serial output drains at the configured baud
+ * rate, display pages cost their I2C transfer time at 400 kHz and EEPROM
+ * writes keep the EEPROM busy for 3.3 ms.
+ */
+#pragma once
+
+#if !defined(ARDUINO)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////    CORE     ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define LOW 0x0
+#define HIGH 0x1
+#define DEFAULT 1
+
+#define DEC 10
+#define HEX 16
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+/** Flash strings live in ordinary memory on the host. */
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+#define strncpy_P strncpy
+#define strcpy_P strcpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strlen_P strlen
+#define memcpy_P memcpy
+/** A named section, so a simulated reset can keep it (@ref Hal::Sim::noinitData()). */
+#define NOINIT __attribute__((section("noinit")))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+/** Interrupts are simulated synchronously, so masking them is a no-op. */
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+/** Status register; only the I bit is kept, for code that saves and restores it around cli(). */
+extern volatile uint8_t SREG;
+inline void cli() {
+  SREG &= (uint8_t)~0x80;
+}
+inline void sei() {
+  SREG |= 0x80;
+}
+
+/** Arduino sketch entry points (defined in Plant_Monitor.ino). */
+void setup();
+void loop();
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////  REGISTERS  ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Declare an interrupt handler. The simulator calls the handlers
+ * through weak references, so a test harness may omit the sketch.
+ */
+#define ISR(vector) extern "C" void vector()
+#define TIMER1_COMPA_vect hal_isr_timer1_compa
+
+extern volatile uint8_t MCUSR;
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint8_t TIMSK1;
+extern volatile uint16_t OCR1A;
+extern volatile uint16_t TCNT1;
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define OCIE1A 1
+
+#define WDTO_8S 9
+void wdt_enable(uint8_t timeout);
+void wdt_disable();
+void wdt_reset();
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////    PRINT    ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Minimal re-implementation of the Arduino Print class.
+ */
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) {
+    return str ? write((const uint8_t *)str, strlen(str)) : 0;
+  }
+  virtual int availableForWrite() {
+    return 0;
+  }
+
+  size_t print(const __FlashStringHelper *s) {
+    return write(reinterpret_cast<const char *>(s));
+  }
+  size_t print(const char *s) {
+    return write(s);
+  }
+  size_t print(char c) {
+    return write((uint8_t)c);
+  }
+  size_t print(unsigned char n, int base = DEC) {
+    return printNumber(n, base);
+  }
+  size_t print(int n, int base = DEC) {
+    return print((long)n, base);
+  }
+  size_t print(unsigned int n, int base = DEC) {
+    return printNumber(n, base);
+  }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC) {
+    return printNumber(n, base);
+  }
+
+  size_t println() {
+    return write("\r\n");
+  }
+  template<typename T>
+  size_t println(T v) {
+    size_t n = print(v);
+    return n + println();
+  }
+  template<typename T>
+  size_t println(T v, int base) {
+    size_t n = print(v, base);
+    return n + println();
+  }
+
+private:
+  size_t printNumber(unsigned long n, uint8_t base);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////  PERIPHERALS  /////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/** Size of the simulated UART transmit/receive buffers (same as the AVR core). */
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+/**
+ * @brief Simulated UART. Transmitted bytes leave the 64-byte buffer at the
+ * configured baud rate; writing into a full buffer blocks (advances the
+ * virtual clock) exactly like the AVR core does.
+ */
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  int available();
+  int peek();
+  int read();
+  int availableForWrite() override;
+  void flush();
+  size_t write(uint8_t c) override;
+  using Print::write;
+  operator bool() {
+    return true;
+  }
+};
+extern HardwareSerial Serial;
+
+/**
+ * @brief Simulated I2C master (Wire). Transfers cost their bus time at the
+ * configured clock and are addressed to simulated devices.
+ */
+class TwoWire {
+public:
+  void begin() {}
+  void setClock(uint32_t clock);
+  void setWireTimeout(uint32_t timeout = 25000, bool reset = false) {
+    (void)timeout;
+    (void)reset;
+  }
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  int available();
+  int read();
+};
+extern TwoWire Wire;
+
+/** Size of the simulated EEPROM (ATmega328P). */
+#define E2END 0x3FF
+
+/**
+ * @brief Simulated EEPROM. Each physical write keeps the EEPROM busy for
+ * 3.3 ms; writing while busy blocks like the AVR implementation.
+ */
+class EEPROMClass {
+public:
+  uint8_t read(int idx);
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val);
+  uint16_t length() {
+    return E2END + 1;
+  }
+};
+extern EEPROMClass EEPROM;
+
+/** Non-blocking EEPROM ready check (avr/eeprom.h). */
+bool eeprom_is_ready();
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////   DISPLAY   ///////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+#define U8G2_R0 0
+#define U8X8_PIN_NONE 255
+#define U8X8_PROGMEM
+
+/** Font handles; on the host only the glyph metrics are modelled. */
+extern const uint8_t u8g2_font_profont10_tr[];
+extern const uint8_t u8g2_font_profont11_mr[];
+extern const uint8_t u8g2_font_profont17_mr[];
+extern const uint8_t u8g2_font_profont22_mr[];
+
+/**
+ * @brief Page-buffered 128x64 display compatible with the U8g2 API subset
+ * used by the firmware (two tile rows per page, like the SH1106 "_2" driver).
+ *
+ * Drawing operates on a real page buffer; text advances the cursor by the
+ * glyph width without rasterizing. Every transmitted page costs its I2C
+ * bus time on the virtual clock.
+ */
+class HostDisplay : public Print {
+public:
+  HostDisplay(uint8_t rotation, uint8_t reset);
+
+  bool begin();
+  void setContrast(uint8_t value);
+  void setPowerSave(uint8_t is_enable);
+  void clearDisplay();
+
+  void firstPage();
+  uint8_t nextPage();
+  void clearBuffer();
+  void sendBuffer();
+  void setBufferCurrTileRow(uint8_t row);
+  uint8_t getBufferCurrTileRow() {
+    return currTileRow;
+  }
+  uint8_t getBufferTileHeight() {
+    return BUFFER_TILE_ROWS;
+  }
+  uint8_t getBufferTileWidth() {
+    return WIDTH / 8;
+  }
+  uint8_t *getBufferPtr() {
+    return buffer;
+  }
+  uint8_t getDisplayWidth() {
+    return WIDTH;
+  }
+  uint8_t getDisplayHeight() {
+    return HEIGHT;
+  }
+
+  void setDrawColor(uint8_t color) {
+    drawColor = color;
+  }
+  void setBitmapMode(uint8_t is_transparent) {
+    bitmapTransparent = is_transparent;
+  }
+  void setFont(const uint8_t *font) {
+    this->font = font;
+  }
+  void setCursor(int16_t x, int16_t y) {
+    cursorX = x;
+    cursorY = y;
+  }
+  int8_t getAscent();
+  int8_t getDescent();
+  int8_t getMaxCharHeight();
+  int8_t getMaxCharWidth();
+  uint16_t getStrWidth(const char *s);
+
+  void drawPixel(int16_t x, int16_t y);
+  void drawHLine(int16_t x, int16_t y, int16_t w);
+  void drawBox(int16_t x, int16_t y, int16_t w, int16_t h);
+  void drawRBox(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r);
+  void drawXBM(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *bitmap);
+  void drawXBMP(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *bitmap) {
+    drawXBM(x, y, w, h, bitmap);
+  }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  static constexpr uint8_t WIDTH = 128;
+  static constexpr uint8_t HEIGHT = 64;
+  static constexpr uint8_t BUFFER_TILE_ROWS = 2;
+  static constexpr uint8_t I2C_ADDRESS = 0x3C;
+
+private:
+  void transmitPage();
+
+  uint8_t buffer[WIDTH * BUFFER_TILE_ROWS];
+  uint8_t currTileRow = 0;
+  uint8_t drawColor = 1;
+  uint8_t bitmapTransparent = 0;
+  const uint8_t *font = nullptr;
+  int16_t cursorX = 0;
+  int16_t cursorY = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////  SIMULATION  //////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Hal {
+/**
+ * @namespace Hal::Sim
+ * @brief Controls for the simulated peripherals and the virtual clock.
+ */
+namespace Sim {
+
+/** Simulated ADC conversion time in microseconds (13 ADC clocks @ 125 kHz). */
+constexpr unsigned long ADC_CONVERSION_US = 104;
+
+/** Simulated EEPROM byte write time in microseconds. */
+constexpr unsigned long EEPROM_WRITE_US = 3300;
+
+/** Virtual CPU time charged for one loop() pass by the host runner. */
+constexpr unsigned long LOOP_COST_US = 20;
+
+/**
+ * @brief Pin number passed to the analog source for multiplexer channel n
+ * (@ref SENSOR_MUX): MUX_PIN_BASE + n.
+ */
+constexpr uint8_t MUX_PIN_BASE = 32;
+
+/**
+ * @brief Source for simulated analog values.
+ * @param pin Analog pin being converted, or @ref MUX_PIN_BASE + channel for
+ * a conversion of the multiplexer's common pin.
+ * @param nowMicros Virtual time of the conversion.
+ * @return Raw 10-bit value.
+ */
+typedef uint16_t (*AnalogSource)(uint8_t pin, unsigned long nowMicros);
+
+/** Install a scriptable analog source (nullptr returns to fixed values). */
+void setAnalogSource(AnalogSource source);
+
+/** Set a fixed raw value returned for @p pin when no source is installed. */
+void setAnalogValue(uint8_t pin, uint16_t value);
+
+/**
+ * @brief Advance the virtual clock and fire any simulated interrupts that
+ * became due (ADC complete, TWI, Timer1 compare match, UART transmit).
+ */
+void advanceMicros(unsigned long us);
+
+/**
+ * @brief Fire @p handler as a simulated interrupt every @p periodUs
+ * microseconds (0 or nullptr stops it), e.g. to stress the firmware's
+ * interrupt paths at rates the real peripherals never reach.
+ */
+void setPeriodicInterrupt(unsigned long periodUs, void (*handler)());
+
+/** Virtual time since start in microseconds (does not wrap). */
+uint64_t nowMicros();
+
+/** Receiver for bytes leaving the simulated UART (nullptr discards them). */
+typedef void (*SerialSink)(uint8_t c);
+
+/** Route transmitted serial bytes (default: stdout). */
+void setSerialSink(SerialSink sink);
+
+/**
+ * @brief Feed characters into the UART receive buffer (loopback input).
+ * @return Number of bytes accepted (the rest overflowed, as on the AVR).
+ */
+size_t serialInject(const char *s);
+
+/**
+ * @brief True if the I/O clock was stopped (ADC noise-reduction sleep) at
+ * some time between @p fromUs and @p toUs, so the UART receiver would have
+ * lost a byte on the wire then. Covers the last 8 sleeps.
+ */
+bool ioStoppedDuring(uint64_t fromUs, uint64_t toUs);
+
+/** Simulated I2C device: handles a write and returns bytes for a read. */
+struct I2cDevice {
+  uint8_t address;
+  void (*onWrite)(const uint8_t *data, uint8_t len);
+  uint8_t (*onRead)(uint8_t *data, uint8_t len);
+};
+
+/** Attach a simulated device to the I2C bus (up to 4). */
+bool attachI2cDevice(const I2cDevice &device);
+
+/**
+ * @brief Simulate a slave holding SDA low: STARTs of the TWI unit never
+ * complete until the bus is recovered (@ref Hal::twiRecover()).
+ */
+void setI2cStuck(bool stuck);
+
+/**
+ * @brief Counters collected by the simulated peripherals.
+ */
+struct Counters {
+  unsigned long adcConversions;   ///< ADC conversions (blocking and interrupt-driven)
+  unsigned long serialTxBytes;    ///< bytes transmitted by the UART
+  unsigned long serialStallUs;    ///< time spent blocked on a full TX buffer
+  unsigned long serialRxLost;     ///< received bytes lost while the I/O clock was stopped
+  unsigned long i2cBytes;         ///< bytes clocked over the I2C bus
+  unsigned long i2cBusUs;         ///< time the I2C bus was busy
+  unsigned long displayFrames;    ///< completed firstPage()/nextPage() loops
+  unsigned long displayPages;     ///< pages transmitted to the display
+  unsigned long eepromWrites;     ///< physical EEPROM byte writes
+  unsigned long eepromStallUs;    ///< time spent waiting for a busy EEPROM
+  unsigned long timer1Interrupts; ///< Timer1 compare match interrupts
+  unsigned long watchdogExpiries; ///< times the watchdog would have reset the MCU
+  unsigned long sleepIdleUs;      ///< time spent in idle sleep
+  unsigned long sleepAdcUs;       ///< time spent in ADC noise-reduction sleep (Timer0 stopped)
+};
+
+/** Access the peripheral counters. */
+Counters &counters();
+
+/** Per-address EEPROM write counts (wear). */
+const uint16_t *eepromWearMap();
+
+/** Raw EEPROM contents (e.g. to pre-load or corrupt them). */
+uint8_t *eepromData();
+
+/**
+ * @brief The variables declared @c NOINIT, which keep their content across
+ * a reset, as one block of @ref noinitSize() bytes (e.g. to carry them into
+ * a restarted simulation).
+ */
+uint8_t *noinitData();
+
+/** Size of @ref noinitData() in bytes (0 if nothing is declared @c NOINIT). */
+size_t noinitSize();
+
+}  // namespace Sim
+}  // namespace Hal
+
+#endif  // !ARDUINO
@@ -0,0 +1,1018 @@
+/**
+ * @file hal_host_main.cpp
+ * @brief Host counterpart of the Arduino core's main(): runs setup()/loop()
+ * against the simulated peripherals and reports throughput and latency.
+ *
+ * Usage: @c plant_monitor_host [virtual-seconds] [option...] [command...]
+ *
+ * The options (@c @uptime and the @c -- options below) come before the
+ * commands, in any order; an unknown @c -- option is an error.
+ *
+ * With @c @uptime the board boots that many virtual seconds after the
+ * simulation starts, e.g. @c @4294900 runs setup() shortly before millis()
+ * wraps after 49.7 days.
+ * With @c --watering the analog sensors follow a watering trace instead of
+ * the triangle waves, and the report adds the readings taken and how far
+ * their linear interpolation is from the trace (see @ref ReadRate).
+ * With @c --noise=<lsb> the analog samples carry Gaussian noise of that
+ * standard deviation, and the report compares the rounded mean of
+ * @ref AVERAGE_OF samples with @ref ADC_OVERSAMPLE on synthetic inputs
+ * between the ADC steps (and, in a build with @ref ADC_OVERSAMPLE, adds the
+ * error of the engine's raw values against the clean input).
+ * With @c --spikes=<percent> that share of the analog samples jumps by
+ * 100–400 LSB, and the report adds a benchmark of every @ref Filter mode on
+ * synthetic windows with the same spike rate: host time per call (the
+ * fastest of five passes) and the error against the undisturbed value.
+ * With @c --calcheck the report compares the calibration reciprocals with
+ * the integer division they replace, for every span, humidity delta and
+ * offset, and for every raw value 0–1023 through the active curve of each
+ * sensor, with the host time per conversion (see @ref Calibration).
+ * With @c --labels (with @ref LABEL_CACHE) the report times full main
+ * screen frames at every scroll position from the label cache and with
+ * every text printed, and checks that both draw the same pages (see
+ * @ref LabelCache).
+ * With @c --latency (with @ref LATENCY_STATS) the report adds the loop
+ * histogram against the simulator's loop count, checks the bin edges and
+ * times an empty @ref LATENCY_SCOPE on the host (see @ref Latency).
+ * With @c --dispatch the report looks up every command keyword and a few
+ * unknown words by hash, as the dispatcher does, and by comparing keyword
+ * after keyword, as the former strcmp chain did, with the keyword compares
+ * and host time per lookup (see @ref SerialController).
+ * With @c --telemetry the report sends synthetic readings through
+ * @ref Telemetry::sendReadings and through the log and plotter lines,
+ * decodes both with @ref Telemetry::decodeFrame and a line parser, and
+ * compares the bytes per reading, the host time to decode one reading and
+ * whether every value came back. With @ref SENSOR_STATS the summary frames
+ * in between are decoded with @ref Telemetry::decodeStatsFrame.
+ * With @c --stress=<us> a simulated interrupt pushes a read event every
+ * @c us microseconds on top of Timer1, and the report adds the event ring
+ * counters and checks that every event pushed was taken or is still queued
+ * (see @ref Events).
+ * With @c --reset=wdt, @c --reset=bor or @c --reset=ext the board starts as
+ * after a watchdog, brown-out or external reset instead of power-on; the
+ * first two select the fast boot (see @ref Boot). The report always
+ * includes the boot phase times.
+ * With @c --restart=<seconds> the watchdog resets the board that many
+ * virtual seconds into the run: the simulator saves the virtual time, the
+ * EEPROM and the @c NOINIT variables to a file and executes itself again
+ * with @c --resume=<file> in place of @c @uptime, so everything else starts
+ * from zero as after a real reset. The remaining seconds and commands carry
+ * over, and the report of the resumed run adds what the warm restart kept
+ * (see @ref Snapshot).
+ * Each command is fed into the simulated UART from the first loop() pass on.
+ * A command written as @c <seconds>:<command> (e.g. @c 60:EVENTS) is fed in
+ * once that many virtual seconds have passed instead. Characters arrive at
+ * @ref BAUDRATE, so a long line overflows the receive buffer only if the
+ * firmware does not poll it in time.
+ * Serial output of the firmware goes to stdout, followed by a report of loop
+ * iterations per second (wall clock), worst-case loop latency (virtual
+ * clock) and the peripheral counters.
+ */
+#if !defined(ARDUINO)
+
+#include "hal.hpp"
+#include "boot.hpp"
+#include "calibration.hpp"
+#include "clock.hpp"
+#include "events.hpp"
+#include "filter.hpp"
+#include "history.hpp"
+#include "labelcache.hpp"
+#include "latency.hpp"
+#include "lib.hpp"
+#include "readrate.hpp"
+#include "serialout.hpp"
+#include "snapshot.hpp"
+#include "SerialController.hpp"
+#include "telemetry.hpp"
+#include "view.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * @brief Default analog source: slow, phase-shifted triangle waves that sweep
+ * each sensor across the calibrated range once every ten minutes.
+ */
+static uint16_t triangleSource(uint8_t pin, unsigned long nowMicros) {
+  const unsigned long periodMs = 600000UL;
+  unsigned long t = (nowMicros / 1000UL + (unsigned long)(pin - A0) * (periodMs / 4)) % periodMs;
+  unsigned long half = periodMs / 2;
+  unsigned long pos = t < half ? t : periodMs - t;
+  return (uint16_t)(SENSOR_CALIBRATED_MIN + (SENSOR_CALIBRATED_MAX - SENSOR_CALIBRATED_MIN) * pos / half);
+}
+
+/**
+ * @brief Humidity in percent of the watering trace at pin @p pin after
+ * @p seconds: every 8 hours (staggered by 2.5 hours per pin) the soil is
+ * watered within two minutes to 95%, drains towards 55% over the next
+ * hour and dries by 1.5% per hour.
+ */
+static double wateringPercent(uint8_t pin, double seconds) {
+  const double period = 8 * 3600.0;
+  const double ramp = 120.0;
+  double t = fmod(seconds + (pin - A0) * 9000.0, period);
+  auto drained = [](double u) { return 55.0 + 40.0 * exp(-u / 1800.0) - u * 1.5 / 3600.0; };
+  if (t >= ramp) return drained(t - ramp);
+  double low = drained(period - ramp);
+  return low + (95.0 - low) * t / ramp;
+}
+
+/**
+ * @brief Analog source of @c --watering: the trace mapped onto the
+ * calibrated range, with one count of noise.
+ */
+static uint16_t wateringSource(uint8_t pin, unsigned long nowMicros) {
+  double pct = wateringPercent(pin, (double)Hal::Sim::nowMicros() / 1e6);
+  int noise = (int)((nowMicros / 1000UL * 2654435761UL + pin) >> 7 & 3) - 1;
+  if (noise > 1) noise = 0;
+  return (uint16_t)(lround(SENSOR_CALIBRATED_MAX - (SENSOR_CALIBRATED_MAX - SENSOR_CALIBRATED_MIN) * pct / 100.0) + noise);
+}
+
+/** Share of spiked samples in percent (@c --spikes), and the source they disturb. */
+static unsigned long spikePercent = 0;
+static Hal::Sim::AnalogSource cleanSource = triangleSource;
+static uint32_t randomState = 0x2545F491UL;
+
+/** xorshift32, so every run sees the same spikes. */
+static uint32_t nextRandom() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+/** @p value spiked by 100–400 LSB in either direction, within 10 bit. */
+static uint16_t spike(uint16_t value) {
+  long jump = 100 + (long)(nextRandom() % 301);
+  long v = (nextRandom() & 1) ? value + jump : value - jump;
+  return (uint16_t)(v < 0 ? 0 : v > 1023 ? 1023 : v);
+}
+
+/** Standard deviation of the Gaussian noise in LSB (@c --noise). */
+static double noiseLsb = 0;
+
+/** Standard normal deviate (Box-Muller) from @ref nextRandom(). */
+static double gaussian() {
+  double u = (nextRandom() + 1.0) / 4294967297.0;
+  double v = nextRandom() / 4294967296.0;
+  return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/** ADC result for the input @p truth in LSB with @ref noiseLsb of noise. */
+static uint16_t quantize(double truth) {
+  long v = lround(truth + noiseLsb * gaussian());
+  return (uint16_t)(v < 0 ? 0 : v > 1023 ? 1023 : v);
+}
+
+/** Analog source of @c --noise and @c --spikes: @ref cleanSource disturbed. */
+static uint16_t disturbedSource(uint8_t pin, unsigned long nowMicros) {
+  uint16_t v = cleanSource(pin, nowMicros);
+  if (noiseLsb > 0) v = quantize(v);
+  return nextRandom() % 100 < spikePercent ? spike(v) : v;
+}
+
+/**
+ * @brief Compare averaging and oversampling on synthetic inputs with
+ * @ref noiseLsb of noise: the rounded mean of @ref AVERAGE_OF samples (the
+ * plain engine) and 4^@ref ADC_OVERSAMPLE_LOG4 samples decimated to
+ * 10 + @ref ADC_OVERSAMPLE_BITS bits (@ref ADC_OVERSAMPLE), each against
+ * the true input, which falls between the ADC steps.
+ */
+static void reportNoise() {
+  const unsigned long windows = 100000;
+  const uint8_t oversamples = 1 << (2 * ADC_OVERSAMPLE_LOG4);
+  const uint8_t shift = 2 * ADC_OVERSAMPLE_LOG4 - ADC_OVERSAMPLE_BITS;
+  double meanSq = 0, overSq = 0;
+  for (unsigned long w = 0; w < windows; w++) {
+    const double truth = SENSOR_CALIBRATED_MIN + (SENSOR_CALIBRATED_MAX - SENSOR_CALIBRATED_MIN) * (nextRandom() / 4294967296.0);
+    uint16_t sum = 0;
+    for (uint8_t k = 0; k < AVERAGE_OF; k++) sum += quantize(truth);
+    double err = (double)((sum + AVERAGE_OF / 2) / AVERAGE_OF) - truth;
+    meanSq += err * err;
+    sum = 0;
+    for (uint8_t k = 0; k < oversamples; k++) sum += quantize(truth);
+    // the same rounding as Adc::poll()
+    err = (double)((sum + (1 << (shift - 1))) >> shift) / (1 << ADC_OVERSAMPLE_BITS) - truth;
+    overSq += err * err;
+  }
+  fprintf(stderr, "noise %.2f LSB       %u-sample mean error rms %.2f LSB, %ux oversampled to %u bit rms %.2f LSB\n",
+          noiseLsb, AVERAGE_OF, sqrt(meanSq / windows), oversamples, 10 + ADC_OVERSAMPLE_BITS, sqrt(overSq / windows));
+}
+
+/**
+ * @brief Run every filter mode over the same synthetic windows: a true value,
+ * +-2 LSB of noise and spikes at the @c --spikes rate. Reports host time per
+ * call and the error of the filtered value against the true one.
+ */
+static void reportFilters() {
+  const size_t windows = 100000;
+  std::vector<uint16_t> truth(windows);
+  std::vector<uint16_t> data(windows * FILTER_SAMPLES);
+  for (size_t w = 0; w < windows; w++) {
+    truth[w] = (uint16_t)(SENSOR_CALIBRATED_MIN + nextRandom() % (SENSOR_CALIBRATED_MAX - SENSOR_CALIBRATED_MIN));
+    for (uint8_t k = 0; k < FILTER_SAMPLES; k++) {
+      uint16_t v = (uint16_t)(truth[w] + nextRandom() % 5 - 2);
+      data[w * FILTER_SAMPLES + k] = nextRandom() % 100 < spikePercent ? spike(v) : v;
+    }
+  }
+  std::vector<uint16_t> out(windows);
+  for (uint8_t m = 0; m < Filter::MODES; m++) {
+    double ns = 0;
+    for (int pass = 0; pass < 5; pass++) {  // the fastest pass, the others see other processes
+      auto t0 = std::chrono::steady_clock::now();
+      for (size_t w = 0; w < windows; w++) {
+        uint16_t v[FILTER_SAMPLES];
+        memcpy(v, &data[w * FILTER_SAMPLES], sizeof(v));
+        out[w] = Filter::apply((Filter::Mode)m, v);
+      }
+      double passNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / windows;
+      if (pass == 0 || passNs < ns) ns = passNs;
+    }
+    double sq = 0;
+    unsigned worst = 0;
+    for (size_t w = 0; w < windows; w++) {
+      unsigned err = (unsigned)abs((int)out[w] - (int)truth[w]);
+      sq += (double)err * err;
+      if (err > worst) worst = err;
+    }
+    const unsigned sorts = m == Filter::Mean ? 0 : m == Filter::Hampel ? 2 : 1;
+    fprintf(stderr, "filter %-12s %u samples %lu%% spiked, %u compare-exchanges, %.1f ns/call, error rms %.2f max %u LSB\n",
+            reinterpret_cast<const char *>(Filter::modeName((Filter::Mode)m)), FILTER_SAMPLES, spikePercent,
+            sorts * Filter::Network<FILTER_SAMPLES>::COMPARATORS, ns, sqrt(sq / windows), worst);
+  }
+}
+
+/** Check the calibration reciprocals against the division (@c --calcheck). */
+static bool calibrationCheck = false;
+/** Keeps the timed conversions from being optimized away. */
+static volatile unsigned calibrationSink;
+
+/**
+ * @brief Reference for @ref Calibration::toHumidity(): the same curve
+ * through @p count @p points, with an integer division per conversion.
+ */
+static uint8_t divideHumidity(const Calibration::Point *points, uint8_t count, uint16_t raw) {
+  uint8_t pct;
+  if (raw <= points[0].raw) {
+    pct = points[0].pct;
+  } else if (raw >= points[count - 1].raw) {
+    pct = points[count - 1].pct;
+  } else {
+    uint8_t i = 0;
+    while (raw >= points[i + 1].raw) i++;
+    const Calibration::Point &a = points[i];
+    const Calibration::Point &b = points[i + 1];
+    const bool falling = b.pct < a.pct;
+    const uint8_t delta = (uint8_t)((uint32_t)(raw - a.raw) * (falling ? a.pct - b.pct : b.pct - a.pct) / (b.raw - a.raw));
+    pct = falling ? a.pct - delta : a.pct + delta;
+  }
+  return pct > 99 ? 99 : pct;
+}
+
+/**
+ * @brief Compare the Q22 reciprocals with the integer division they replace:
+ * every span 1–1023, humidity delta 0–100 and offset in the span, then every
+ * raw value 0–1023 through the active curve of each sensor, and the host time
+ * per conversion of both (the fastest of five passes).
+ */
+static void reportCalibration() {
+  unsigned long checked = 0;
+  unsigned long mismatches = 0;
+  for (uint16_t span = 1; span <= 1023; span++) {
+    for (uint8_t delta = 0; delta <= 100; delta++) {
+      const uint32_t r = Calibration::reciprocal(delta, span);
+      for (uint16_t off = 0; off <= span; off++) {
+        if ((uint32_t)(off * r) >> Calibration::RECIPROCAL_SHIFT != (uint32_t)off * delta / span) mismatches++;
+        checked++;
+      }
+    }
+  }
+  fprintf(stderr, "calibration         %lu span/delta/offset cases, %lu differ from the division\n", checked, mismatches);
+
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    Calibration::Point points[CAL_MAX_POINTS];
+    const uint8_t count = Calibration::points(s, points);
+    unsigned differ = 0;
+    for (uint16_t raw = 0; raw <= 1023; raw++) {
+      if (Calibration::toHumidity(s, raw) != divideHumidity(points, count, raw)) differ++;
+    }
+    double recipNs = 0;
+    double divNs = 0;
+    unsigned sink = 0;
+    for (int pass = 0; pass < 5; pass++) {  // the fastest pass, the others see other processes
+      auto t0 = std::chrono::steady_clock::now();
+      for (int k = 0; k < 100; k++) {
+        for (uint16_t raw = 0; raw <= 1023; raw++) sink += Calibration::toHumidity(s, raw);
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      for (int k = 0; k < 100; k++) {
+        for (uint16_t raw = 0; raw <= 1023; raw++) sink += divideHumidity(points, count, raw);
+      }
+      auto t2 = std::chrono::steady_clock::now();
+      double r = std::chrono::duration<double, std::nano>(t1 - t0).count() / 102400;
+      double d = std::chrono::duration<double, std::nano>(t2 - t1).count() / 102400;
+      if (pass == 0 || r < recipNs) recipNs = r;
+      if (pass == 0 || d < divNs) divNs = d;
+    }
+    calibrationSink = sink;
+    fprintf(stderr, "calibration %-8s %u points, raw 0-1023: %u differ, reciprocal %.1f ns, division %.1f ns\n",
+            Lib::getSensorName(s), count, differ, recipNs, divNs);
+  }
+}
+
+#if defined(DISP) && defined(LABEL_CACHE)
+/** Benchmark the label cache (@c --labels). */
+static bool labelCheck = false;
+/** FNV-1a over the pages drawn by @ref View::drawMainFrame(). */
+static uint32_t pageHash;
+
+static void hashPage(const uint8_t *page, uint16_t bytes) {
+  while (bytes--) pageHash = (pageHash ^ *page++) * 16777619UL;
+}
+
+/**
+ * @brief Time full main screen frames at every scroll position, once from
+ * the label cache and once with every text printed (the fastest of five
+ * passes), and check that both draw the same pixels.
+ * @return Microseconds per frame; @p hash receives the hash of all pages.
+ */
+static double timeFrames(uint32_t &hash) {
+  double us = 0;
+  for (int pass = 0; pass < 5; pass++) {  // the fastest pass, the others see other processes
+    pageHash = 2166136261UL;
+    unsigned frames = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint8_t sensor = 0; sensor < NUM_SENSORS; sensor++) {
+      for (int8_t scroll = 0; scroll >= -16; scroll--, frames++) View::drawMainFrame(scroll, sensor, hashPage);
+    }
+    double passUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / frames;
+    if (pass == 0 || passUs < us) us = passUs;
+  }
+  hash = pageHash;
+  return us;
+}
+
+static void reportLabels() {
+  uint32_t cachedHash;
+  uint32_t printedHash;
+  const uint16_t used = LabelCache::bytesUsed();
+  const double cachedUs = timeFrames(cachedHash);
+  LabelCache::clear();
+  const double printedUs = timeFrames(printedHash);
+  View::namesChanged();  // fill the cache again
+  fprintf(stderr, "labels              cache %u of %u bytes %.1f us/frame, printed %.1f us/frame (host), pages %s\n", used,
+          (unsigned)LABEL_CACHE_BYTES, cachedUs, printedUs, cachedHash == printedHash ? "identical" : "DIFFER");
+}
+#endif  // DISP && LABEL_CACHE
+
+#if defined(LATENCY_STATS)
+/** Benchmark the latency scopes (@c --latency). */
+static bool latencyCheck = false;
+
+/**
+ * @brief Summarize the loop histogram of the run against the simulator's
+ * own loop count, check the bin edges, and time an empty
+ * @ref LATENCY_SCOPE on the host (the fastest of five passes). Clears the
+ * histograms, so it runs after the simulation.
+ */
+static void reportLatency(unsigned long iterations) {
+  const Latency::Histogram &loopHist = Latency::histogram(Latency::Loop);
+  fprintf(stderr, "latency loop        %lu passes (simulator %lu), min %u us, max %lu us (virtual), boot overhead %u us\n",
+          (unsigned long)loopHist.count, iterations, loopHist.count ? loopHist.minUs : 0U, (unsigned long)loopHist.maxUs,
+          Latency::overheadUs());
+
+  // 2^b and 2^(b+1)-1 us both belong to bin b; 0 us to bin 0, the rest to the last
+  Latency::reset();
+  const Latency::Histogram &h = Latency::histogram(Latency::DebugScreen);
+  unsigned wrongBins = 0;
+  for (uint8_t b = 0; b < Latency::BINS; b++) {
+    const uint32_t edges[] = { (uint32_t)1 << b, ((uint32_t)2 << b) - 1 };
+    for (uint32_t us : edges) {
+      const uint16_t before = h.bins[b];
+      Latency::record(Latency::DebugScreen, us);
+      if (h.bins[b] != before + 1) wrongBins++;
+    }
+  }
+  Latency::record(Latency::DebugScreen, 0);
+  Latency::record(Latency::DebugScreen, 0xFFFFFFFFUL);
+  if (h.bins[0] != 3 || h.bins[Latency::BINS - 1] != 3) wrongBins++;
+
+  const unsigned long scopes = 10000000UL;
+  double ns = 0;
+  for (int pass = 0; pass < 5; pass++) {  // the fastest pass, the others see other processes
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < scopes; i++) {
+      LATENCY_SCOPE(DebugScreen);
+    }
+    double passNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / scopes;
+    if (pass == 0 || passNs < ns) ns = passNs;
+  }
+  fprintf(stderr, "latency scope       %lu empty scopes, %.1f ns/scope (host), bin edges %s\n", scopes, ns,
+          wrongBins ? "WRONG" : "ok");
+  Latency::reset();
+}
+#endif  // LATENCY_STATS
+
+#if defined(SERIAL_IN)
+/** Benchmark the command lookup (@c --dispatch). */
+static bool dispatchCheck = false;
+/** Keeps the timed lookups from being optimized away. */
+static volatile unsigned dispatchSink;
+
+/**
+ * @brief Look up every keyword of the command table and a few unknown ones,
+ * by hash as the dispatcher does and by comparing keyword after keyword as
+ * the former strcmp chain did: whether both agree, keyword compares per
+ * lookup and host time per lookup (the fastest of five passes).
+ */
+static void reportDispatch() {
+  std::vector<std::string> words;
+  for (uint8_t i = 0; i < SerialController::commandCount(); i++) {
+    words.push_back(reinterpret_cast<const char *>(SerialController::commandKeyword(i)));
+  }
+  const size_t known = words.size();
+  for (const char *w : { "WATER", "STATUS", "X", "HELPX" }) words.push_back(w);
+
+  bool agree = true;
+  unsigned long scanCompares = 0;
+  for (size_t i = 0; i < words.size(); i++) {
+    const int8_t byHash = SerialController::findByHash(words[i].c_str(), (uint8_t)words[i].size());
+    const int8_t byScan = SerialController::findByScan(words[i].c_str(), (uint8_t)words[i].size());
+    agree = agree && byHash == byScan && (byHash >= 0) == (i < known);
+    scanCompares += byScan >= 0 ? byScan + 1 : SerialController::commandCount();
+  }
+
+  const int rounds = 20000;
+  double ns[2] = { 0, 0 };
+  unsigned sink = 0;
+  for (int pass = 0; pass < 5; pass++) {  // the fastest pass, the others see other processes
+    for (int m = 0; m < 2; m++) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (int r = 0; r < rounds; r++) {
+        for (const std::string &w : words) {
+          sink += (uint8_t)(m == 0 ? SerialController::findByHash(w.c_str(), (uint8_t)w.size())
+                                   : SerialController::findByScan(w.c_str(), (uint8_t)w.size()));
+        }
+      }
+      double passNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / (rounds * words.size());
+      if (pass == 0 || passNs < ns[m]) ns[m] = passNs;
+    }
+  }
+  dispatchSink = sink;
+  fprintf(stderr, "dispatch hash       %zu keywords + %zu unknown, at most 1 keyword compare, %.1f ns/lookup\n", known,
+          words.size() - known, ns[0]);
+  fprintf(stderr, "dispatch scan       %.1f keyword compares per lookup, %.1f ns/lookup, %s\n",
+          (double)scanCompares / words.size(), ns[1], agree ? "same results" : "RESULTS DIFFER");
+}
+#endif  // SERIAL_IN
+
+#if defined(TELEMETRY_BINARY) && defined(SERIAL_OUT)
+/** Report the binary telemetry against the ASCII lines (@c --telemetry). */
+static bool telemetryCheck = false;
+/** Serial bytes captured by @ref captureSink. */
+static std::vector<uint8_t> captured;
+
+static void captureSink(uint8_t c) {
+  captured.push_back(c);
+}
+
+/** Run the queued serial output onto the simulated wire. */
+static void drainSerial() {
+  while (!SerialOut::isIdle()) {
+    SerialOut::service();  // loop() is not running
+    Hal::Sim::advanceMicros(1000);
+  }
+  // the UART's own buffer
+  Hal::Sim::advanceMicros(64 * 10 * 1000000UL / BAUDRATE + 1000);
+}
+
+/** Split @p bytes after every @p delimiter (which is dropped). */
+static std::vector<std::vector<uint8_t>> splitCaptured(const std::vector<uint8_t> &bytes, uint8_t delimiter) {
+  std::vector<std::vector<uint8_t>> parts(1);
+  for (uint8_t c : bytes) {
+    if (c == delimiter) parts.emplace_back();
+    else parts.back().push_back(c);
+  }
+  parts.pop_back();
+  return parts;
+}
+
+/** Parse the plotter line of a reading ("v0 v1 ... ") into @p values. */
+static bool parsePlotLine(const std::vector<uint8_t> &line, uint8_t *values) {
+  const char *p = reinterpret_cast<const char *>(line.data());
+  const char *end = p + line.size();
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    char *next;
+    long v = strtol(p, &next, 10);
+    if (next == p || next > end) return false;
+    values[s] = (uint8_t)v;
+    p = next;
+  }
+  return true;
+}
+
+/**
+ * @brief Send synthetic readings through the firmware's own outputs, once as
+ * binary frames (@ref Telemetry::sendReadings) and once as the log and
+ * plotter lines, and decode both again: bytes on the wire per reading,
+ * host time to decode one reading (the fastest of five passes) and whether
+ * every value came back.
+ */
+static void reportTelemetry() {
+  const size_t readings = 10000;
+  std::vector<Lib::SensorContext> sent(readings);
+  for (Lib::SensorContext &c : sent) {
+    c.requestMillis = millis();
+    for (uint8_t s = 0; s < NUM_SENSORS; s++) c.values[s] = (uint8_t)(nextRandom() % 100);
+#if defined(ADC_OVERSAMPLE)
+    for (uint8_t s = 0; s < NUM_SENSORS; s++) c.raw[s] = (uint16_t)(nextRandom() % (1024U << ADC_OVERSAMPLE_BITS));
+#endif  // ADC_OVERSAMPLE
+  }
+  const Lib::SensorContext live = Lib::ctx;
+  Hal::Sim::setSerialSink(captureSink);
+
+  drainSerial();
+  captured.clear();
+  for (const Lib::SensorContext &c : sent) {
+    Telemetry::sendReadings(c);
+#if defined(SENSOR_STATS)
+    Telemetry::countReading();
+#endif  // SENSOR_STATS
+    drainSerial();
+  }
+  std::vector<std::vector<uint8_t>> frames;
+  std::vector<std::vector<uint8_t>> statsFrames;
+  for (std::vector<uint8_t> &f : splitCaptured(captured, 0x00)) {
+    // the type byte is never 0, so COBS leaves it right after the first code byte
+    if (f.size() > 1 && f[1] == Telemetry::PACKET_STATS) statsFrames.push_back(std::move(f));
+    else frames.push_back(std::move(f));
+  }
+  size_t binaryBytes = 0;
+  for (const std::vector<uint8_t> &f : frames) binaryBytes += f.size() + 1;  // with the delimiter
+
+  captured.clear();
+  for (const Lib::SensorContext &c : sent) {
+    Lib::ctx = c;
+    View::valuesSerialPrint();
+    View::valuesSerialPlot();
+    drainSerial();
+  }
+  const size_t asciiBytes = captured.size();
+  const std::vector<std::vector<uint8_t>> lines = splitCaptured(captured, '\n');
+  const size_t linesPerReading = lines.size() / readings;
+  Lib::ctx = live;
+  Hal::Sim::setSerialSink([](uint8_t c) { putchar(c); });
+
+  std::vector<Telemetry::Frame> decoded(frames.size());
+  std::vector<bool> ok(frames.size());
+  double frameNs = 0;
+  for (int pass = 0; pass < 5; pass++) {  // the fastest pass, the others see other processes
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+      uint8_t buf[Telemetry::MAX_PACKET_BYTES + 2];
+      const uint8_t len = (uint8_t)std::min(frames[i].size(), sizeof(buf));
+      memcpy(buf, frames[i].data(), len);
+      ok[i] = Telemetry::decodeFrame(buf, len, decoded[i]);
+    }
+    double passNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / readings;
+    if (pass == 0 || passNs < frameNs) frameNs = passNs;
+  }
+  size_t frameMatches = 0;
+  bool rawFrames = false;
+  for (size_t i = 0; i < frames.size() && i < readings; i++) {
+    bool same = ok[i] && memcmp(decoded[i].values, sent[i].values, NUM_SENSORS) == 0;
+    rawFrames |= ok[i] && decoded[i].hasRaw;
+#if defined(ADC_OVERSAMPLE)
+    same = same && decoded[i].hasRaw && memcmp(decoded[i].raw, sent[i].raw, sizeof(sent[i].raw)) == 0;
+#endif  // ADC_OVERSAMPLE
+    if (same) frameMatches++;
+  }
+
+  size_t statsOk = 0;
+  for (std::vector<uint8_t> &f : statsFrames) {
+    Telemetry::StatsFrame st;
+    if (f.size() <= 0xFF && Telemetry::decodeStatsFrame(f.data(), (uint8_t)f.size(), st) && st.sensor < NUM_SENSORS) {
+      statsOk++;
+    }
+  }
+
+  // the plotter line carries the values alone; a collector would parse that one
+  std::vector<std::array<uint8_t, NUM_SENSORS>> parsed(readings);
+  std::vector<bool> parsedOk(readings);
+  double lineNs = 0;
+  for (int pass = 0; pass < 5 && linesPerReading; pass++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < readings; i++) {
+      parsedOk[i] = parsePlotLine(lines[(i + 1) * linesPerReading - 1], parsed[i].data());
+    }
+    double passNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / readings;
+    if (pass == 0 || passNs < lineNs) lineNs = passNs;
+  }
+  size_t lineMatches = 0;
+  for (size_t i = 0; i < readings && linesPerReading; i++) {
+    if (parsedOk[i] && memcmp(parsed[i].data(), sent[i].values, NUM_SENSORS) == 0) lineMatches++;
+  }
+
+  fprintf(stderr, "telemetry binary    %zu readings in %zu %s frames, %.1f bytes/reading, decode %.1f ns, %zu decoded intact\n",
+          readings, frames.size(), rawFrames ? "raw" : "plain", (double)binaryBytes / readings, frameNs, frameMatches);
+  fprintf(stderr, "telemetry ascii     %zu readings in %zu lines, %.1f bytes/reading, parse %.1f ns, %zu parsed intact\n",
+          readings, lines.size(), (double)asciiBytes / readings, lineNs, lineMatches);
+  if (!statsFrames.empty()) {
+    fprintf(stderr, "telemetry stats     %zu summary frames, %zu decoded\n", statsFrames.size(), statsOk);
+  }
+}
+#endif  // TELEMETRY_BINARY && SERIAL_OUT
+
+/** One reading of the analog sensors while replaying the watering trace. */
+struct TraceSample {
+  double seconds;
+  uint8_t values[NUM_SENSORS];
+};
+
+/**
+ * @brief Print the samples taken and the error of interpolating them
+ * linearly, against the trace at every second, over all analog sensors.
+ */
+static void reportTrace(const std::vector<TraceSample> &samples) {
+  double sumSq = 0, worst = 0;
+  unsigned long points = 0;
+  for (size_t i = 1; i < samples.size(); i++) {
+    const TraceSample &a = samples[i - 1], &b = samples[i];
+    for (double t = ceil(a.seconds); t < b.seconds; t += 1.0) {
+      double f = (t - a.seconds) / (b.seconds - a.seconds);
+      for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+        if (Lib::getSensorI2cAddress(s)) continue;
+        double err = fabs(a.values[s] + (b.values[s] - a.values[s]) * f - wateringPercent(Lib::getSensorPin(s), t));
+        sumSq += err * err;
+        worst = std::max(worst, err);
+        points++;
+      }
+    }
+  }
+  fprintf(stderr, "watering trace      %lu readings, error rms %.2f %%, max %.2f %%\n", (unsigned long)samples.size(),
+          points ? sqrt(sumSq / points) : 0.0, worst);
+}
+
+/** Events the stress interrupt tried to push, and how many were dropped. */
+static unsigned long stressPushes = 0;
+static unsigned long stressDrops = 0;
+
+/** Stress interrupt: one read event per call, like the Timer1 ISR. */
+static void stressIsr() {
+  stressPushes++;
+  if (!Events::push(Events::ReadTick)) stressDrops++;
+}
+
+/**
+ * @brief What a simulated reset carries into the resumed run, followed in
+ * the file by the @c NOINIT bytes and the EEPROM.
+ */
+struct RestartState {
+  uint64_t nowMicros;    ///< virtual time of the reset
+  uint32_t clockMillis;  ///< Clock::millis() at the reset
+  uint16_t historySize;  ///< samples in the history ring at the reset
+  uint8_t values[NUM_SENSORS];
+  uint32_t noinitBytes;
+};
+
+/**
+ * @brief Save the state that survives a watchdog reset to @p path and
+ * execute the simulator again with the rest of the run.
+ */
+static void restart(const char *path, char **argv, unsigned long seconds, bool watering, unsigned long stressUs,
+                    uint64_t elapsedUs, const std::vector<std::pair<uint64_t, const char *>> &pending) {
+  RestartState st = {};
+  st.nowMicros = Hal::Sim::nowMicros();
+  st.clockMillis = Clock::millis();
+#if defined(HISTORY)
+  st.historySize = History::size();
+#endif  // HISTORY
+  memcpy(st.values, Lib::ctx.values, NUM_SENSORS);
+  st.noinitBytes = (uint32_t)Hal::Sim::noinitSize();
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  fwrite(&st, sizeof(st), 1, f);
+  fwrite(Hal::Sim::noinitData(), 1, st.noinitBytes, f);
+  fwrite(Hal::Sim::eepromData(), 1, E2END + 1, f);
+  fclose(f);
+
+  std::vector<std::string> args;
+  args.push_back(argv[0]);
+  args.push_back(std::to_string(seconds - elapsedUs / 1000000ULL));
+  args.push_back(std::string("--resume=") + path);
+  if (watering) args.push_back("--watering");
+  if (spikePercent) args.push_back("--spikes=" + std::to_string(spikePercent));
+  if (noiseLsb > 0) args.push_back("--noise=" + std::to_string(noiseLsb));
+  if (calibrationCheck) args.push_back("--calcheck");
+#if defined(DISP) && defined(LABEL_CACHE)
+  if (labelCheck) args.push_back("--labels");
+#endif  // DISP && LABEL_CACHE
+#if defined(LATENCY_STATS)
+  if (latencyCheck) args.push_back("--latency");
+#endif  // LATENCY_STATS
+#if defined(SERIAL_IN)
+  if (dispatchCheck) args.push_back("--dispatch");
+#endif  // SERIAL_IN
+#if defined(TELEMETRY_BINARY) && defined(SERIAL_OUT)
+  if (telemetryCheck) args.push_back("--telemetry");
+#endif  // TELEMETRY_BINARY && SERIAL_OUT
+  if (stressUs) args.push_back("--stress=" + std::to_string(stressUs));
+  for (const std::pair<uint64_t, const char *> &c : pending) {
+    uint64_t at = c.first > elapsedUs ? c.first - elapsedUs : 0;
+    args.push_back(std::to_string(at / 1000000ULL) + ":" + c.second);
+  }
+  std::vector<char *> execArgs;
+  for (std::string &a : args) execArgs.push_back(&a[0]);
+  execArgs.push_back(nullptr);
+
+  fflush(stdout);
+  fprintf(stderr, "\n--- watchdog reset at %.3f virtual s ---\n", (double)st.nowMicros / 1e6);
+  execv(argv[0], execArgs.data());
+  perror(argv[0]);
+  exit(1);
+}
+
+/**
+ * @brief Load what @ref restart() saved: jump to the time of the reset and
+ * put back the @c NOINIT bytes and the EEPROM.
+ */
+static RestartState resume(const char *path) {
+  RestartState st;
+  FILE *f = fopen(path, "rb");
+  if (!f || fread(&st, sizeof(st), 1, f) != 1 || st.noinitBytes != Hal::Sim::noinitSize()
+      || fread(Hal::Sim::noinitData(), 1, st.noinitBytes, f) != st.noinitBytes
+      || fread(Hal::Sim::eepromData(), 1, E2END + 1, f) != E2END + 1) {
+    fprintf(stderr, "%s: not a restart state of this build\n", path);
+    exit(1);
+  }
+  fclose(f);
+  remove(path);
+  Hal::Sim::advanceMicros(st.nowMicros - Hal::Sim::nowMicros());
+  MCUSR = 1 << WDRF;
+  return st;
+}
+
+/**
+ * @brief Simulated seesaw soil sensor at 0x36 + @p N: answers a read with
+ * the big-endian capacitance that @ref I2cSoil maps back to the triangle
+ * wave of pin A4 + N.
+ */
+template <uint8_t N>
+static uint8_t seesawRead(uint8_t *data, uint8_t len) {
+  if (len < 2) return 0;
+  uint16_t cap = 2046 - 2 * triangleSource(A0 + 4 + N, (unsigned long)Hal::Sim::nowMicros());
+  data[0] = (uint8_t)(cap >> 8);
+  data[1] = (uint8_t)cap;
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  const unsigned long seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 60UL;
+  Hal::Sim::setAnalogSource(triangleSource);
+  Hal::Sim::attachI2cDevice({ 0x36, nullptr, seesawRead<0> });
+  Hal::Sim::attachI2cDevice({ 0x37, nullptr, seesawRead<1> });
+
+  // Options come before the commands, in any order.
+  int firstCommand = 2;
+  bool resumed = false;
+  RestartState before = {};
+  unsigned long uptimeSeconds = 0;
+  const char *resumePath = nullptr;
+  bool watering = false;
+  unsigned long stressUs = 0;
+  uint8_t resetFlags = 0;
+  unsigned long restartSeconds = 0;
+  for (; firstCommand < argc; firstCommand++) {
+    const char *arg = argv[firstCommand];
+    if (arg[0] == '@') {
+      uptimeSeconds = strtoul(arg + 1, nullptr, 10);
+    } else if (strncmp(arg, "--", 2) != 0) {
+      break;
+    } else if (strncmp(arg, "--resume=", 9) == 0) {
+      resumePath = arg + 9;
+    } else if (strcmp(arg, "--watering") == 0) {
+      watering = true;
+    } else if (strcmp(arg, "--calcheck") == 0) {
+      calibrationCheck = true;
+#if defined(DISP) && defined(LABEL_CACHE)
+    } else if (strcmp(arg, "--labels") == 0) {
+      labelCheck = true;
+#endif  // DISP && LABEL_CACHE
+#if defined(LATENCY_STATS)
+    } else if (strcmp(arg, "--latency") == 0) {
+      latencyCheck = true;
+#endif  // LATENCY_STATS
+#if defined(SERIAL_IN)
+    } else if (strcmp(arg, "--dispatch") == 0) {
+      dispatchCheck = true;
+#endif  // SERIAL_IN
+    } else if (strncmp(arg, "--noise=", 8) == 0) {
+      noiseLsb = strtod(arg + 8, nullptr);
+    } else if (strncmp(arg, "--spikes=", 9) == 0) {
+      spikePercent = strtoul(arg + 9, nullptr, 10);
+#if defined(TELEMETRY_BINARY) && defined(SERIAL_OUT)
+    } else if (strcmp(arg, "--telemetry") == 0) {
+      telemetryCheck = true;
+#endif  // TELEMETRY_BINARY && SERIAL_OUT
+    } else if (strncmp(arg, "--stress=", 9) == 0) {
+      stressUs = strtoul(arg + 9, nullptr, 10);
+    } else if (strcmp(arg, "--reset=wdt") == 0) {
+      resetFlags = 1 << WDRF;
+    } else if (strcmp(arg, "--reset=bor") == 0) {
+      resetFlags = 1 << BORF;
+    } else if (strcmp(arg, "--reset=ext") == 0) {
+      resetFlags = 1 << EXTRF;
+    } else if (strncmp(arg, "--restart=", 10) == 0) {
+      restartSeconds = strtoul(arg + 10, nullptr, 10);
+    } else {
+      fprintf(stderr, "%s: unknown option %s\n", argv[0], arg);
+      return 2;
+    }
+  }
+  if (resumePath && uptimeSeconds) {
+    fprintf(stderr, "%s: @uptime and --resume= exclude each other\n", argv[0]);
+    return 2;
+  }
+  if (resumePath) {
+    before = resume(resumePath);
+    resumed = true;
+  } else {
+    // nothing is armed before setup(), so this is a plain jump of the clock
+    Hal::Sim::advanceMicros((uint64_t)uptimeSeconds * 1000000ULL);
+  }
+  if (resetFlags) MCUSR = resetFlags;
+  if (watering) cleanSource = wateringSource;
+  Hal::Sim::setAnalogSource(spikePercent || noiseLsb > 0 ? disturbedSource : cleanSource);
+  std::vector<TraceSample> trace;
+  uint32_t tracedReadings = 0;
+#if defined(ADC_OVERSAMPLE)
+  // error of the engine's oversampled raw values against the clean input
+  uint32_t noiseReadings = 0;
+  unsigned long noisePoints = 0;
+  double noiseSq = 0;
+#endif  // ADC_OVERSAMPLE
+  setup();
+  // what the warm restart brought back, before the loop replaces it
+  const bool valuesKept = resumed && memcmp(Lib::ctx.values, before.values, NUM_SENSORS) == 0;
+#if defined(HISTORY)
+  const uint16_t historyKept = History::size();
+#else
+  const uint16_t historyKept = 0;
+#endif  // HISTORY
+  if (stressUs) Hal::Sim::setPeriodicInterrupt(stressUs, stressIsr);
+  const uint64_t start = Hal::Sim::nowMicros();
+  // Injection time (virtual us after start) and text of every command.
+  std::vector<std::pair<uint64_t, const char *>> commands;
+  for (int i = firstCommand; i < argc; i++) {
+    char *colon;
+    unsigned long at = strtoul(argv[i], &colon, 10);
+    if (colon != argv[i] && *colon == ':') commands.push_back(std::make_pair((uint64_t)at * 1000000ULL, colon + 1));
+    else commands.push_back(std::make_pair((uint64_t)0, (const char *)argv[i]));
+  }
+  size_t injected = 0;
+  // Characters sent but not yet on the wire, and the fraction of a character
+  // time already elapsed.
+  std::string wire;
+  double wireChars = 0;
+  uint64_t wireTime = start;
+  std::stable_sort(commands.begin(), commands.end(),
+                   [](const std::pair<uint64_t, const char *> &a, const std::pair<uint64_t, const char *> &b) {
+                     return a.first < b.first;
+                   });
+
+  const uint64_t end = start + (uint64_t)seconds * 1000000ULL;
+  unsigned long iterations = 0;
+  unsigned long worstLoopUs = 0;
+  uint64_t totalLoopUs = 0;
+  auto wallStart = std::chrono::steady_clock::now();
+  while (Hal::Sim::nowMicros() < end) {
+    uint64_t t0 = Hal::Sim::nowMicros();
+    if (restartSeconds && t0 - start >= (uint64_t)restartSeconds * 1000000ULL) {
+      std::vector<std::pair<uint64_t, const char *>> pending(commands.begin() + injected, commands.end());
+      restart("plant_monitor_restart.bin", argv, seconds, watering, stressUs, t0 - start, pending);
+    }
+    while (injected < commands.size() && commands[injected].first <= t0 - start) {
+      wire += commands[injected].second;
+      wire += '\n';
+      injected++;
+    }
+    if (wire.empty()) {
+      wireChars = 0;
+    } else {
+      const double charUs = 1e6 / (BAUDRATE / 10);
+      const double before = wireChars;
+      wireChars += (double)(t0 - wireTime) / charUs;
+      size_t n = std::min((size_t)wireChars, wire.size());
+      // a character whose frame overlaps a stop of the I/O clock never reaches the buffer
+      std::string arrived;
+      for (size_t j = 0; j < n; j++) {
+        const uint64_t done = wireTime + (uint64_t)((j + 1 - before) * charUs);
+        if (Hal::Sim::ioStoppedDuring(done - (uint64_t)charUs, done)) Hal::Sim::counters().serialRxLost++;
+        else arrived += wire[j];
+      }
+      Hal::Sim::serialInject(arrived.c_str());  // what does not fit is lost
+      wire.erase(0, n);
+      wireChars -= n;
+    }
+    wireTime = t0;
+    loop();
+    if (watering && ReadRate::readings() != tracedReadings) {
+      tracedReadings = ReadRate::readings();
+      TraceSample sample;
+      sample.seconds = (double)Hal::Sim::nowMicros() / 1e6;
+      memcpy(sample.values, Lib::ctx.values, sizeof(sample.values));
+      trace.push_back(sample);
+    }
+#if defined(ADC_OVERSAMPLE)
+    if (noiseLsb > 0 && ReadRate::readings() != noiseReadings) {
+      noiseReadings = ReadRate::readings();
+      for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+        if (Lib::getSensorI2cAddress(s)) continue;
+        double err = (double)Lib::ctx.raw[s] / (1 << ADC_OVERSAMPLE_BITS)
+                     - cleanSource(Lib::getSensorPin(s), (unsigned long)Hal::Sim::nowMicros());
+        noiseSq += err * err;
+        noisePoints++;
+      }
+    }
+#endif  // ADC_OVERSAMPLE
+    Hal::Sim::advanceMicros(Hal::Sim::LOOP_COST_US);
+    unsigned long dt = (unsigned long)(Hal::Sim::nowMicros() - t0);
+    if (dt > worstLoopUs) worstLoopUs = dt;
+    totalLoopUs += dt;
+    iterations++;
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  const Hal::Sim::Counters &c = Hal::Sim::counters();
+  fprintf(stderr, "\n--- host run: %lu virtual s ---\n", seconds);
+  fprintf(stderr, "loop iterations     %lu (%.0f/s wall, %.3f s wall)\n", iterations, wall > 0 ? iterations / wall : 0.0, wall);
+  fprintf(stderr, "loop latency        avg %lu us, worst %lu us (virtual)\n",
+          iterations ? (unsigned long)(totalLoopUs / iterations) : 0UL, worstLoopUs);
+  fprintf(stderr, "adc conversions     %lu\n", c.adcConversions);
+  fprintf(stderr, "serial tx           %lu bytes, stalled %lu us\n", c.serialTxBytes, c.serialStallUs);
+  if (c.serialRxLost) fprintf(stderr, "serial rx           %lu bytes lost in ADC noise-reduction sleep\n", c.serialRxLost);
+  fprintf(stderr, "i2c                 %lu bytes, bus busy %lu us\n", c.i2cBytes, c.i2cBusUs);
+  fprintf(stderr, "display             %lu frames, %lu pages\n", c.displayFrames, c.displayPages);
+  fprintf(stderr, "eeprom              %lu writes, stalled %lu us\n", c.eepromWrites, c.eepromStallUs);
+  fprintf(stderr, "timer1 interrupts   %lu\n", c.timer1Interrupts);
+  fprintf(stderr, "watchdog expiries   %lu\n", c.watchdogExpiries);
+  fprintf(stderr, "sleep               idle %lu us, adc %lu us, awake %.1f%%\n", c.sleepIdleUs, c.sleepAdcUs,
+          100.0 - 100.0 * (c.sleepIdleUs + c.sleepAdcUs) / ((double)seconds * 1e6));
+  fprintf(stderr, "boot                %s, us after setup(): serial %lu, display %lu, timers %lu, first reading %lu\n",
+          Boot::isFast() ? "fast" : "normal", (unsigned long)Boot::elapsedUs(Boot::SerialReady),
+          (unsigned long)Boot::elapsedUs(Boot::DisplayReady), (unsigned long)Boot::elapsedUs(Boot::TimersStarted),
+          (unsigned long)Boot::elapsedUs(Boot::FirstReading));
+  if (resumed) {
+    // the virtual clock never stopped, so the wall clock should have moved by the same time
+    long clockError = (int32_t)(Clock::millis() - before.clockMillis - (uint32_t)((Hal::Sim::nowMicros() - before.nowMicros) / 1000ULL));
+#if defined(WARM_RESTART)
+    const bool restored = Snapshot::restored();
+#else
+    const bool restored = false;
+#endif  // WARM_RESTART
+    fprintf(stderr, "warm restart        snapshot %s, clock off by %ld ms, history %u of %u samples, values %s\n",
+            restored ? "restored" : "NOT restored", clockError, historyKept, before.historySize,
+            valuesKept ? "kept" : "lost");
+  }
+  if (watering) reportTrace(trace);
+  if (spikePercent) reportFilters();
+  if (noiseLsb > 0) {
+    reportNoise();
+#if defined(ADC_OVERSAMPLE)
+    fprintf(stderr, "noise engine        %lu raw values, error rms %.2f LSB\n", noisePoints,
+            noisePoints ? sqrt(noiseSq / noisePoints) : 0.0);
+#endif  // ADC_OVERSAMPLE
+  }
+  if (calibrationCheck) reportCalibration();
+#if defined(DISP) && defined(LABEL_CACHE)
+  if (labelCheck) reportLabels();
+#endif  // DISP && LABEL_CACHE
+#if defined(LATENCY_STATS)
+  if (latencyCheck) reportLatency(iterations);
+#endif  // LATENCY_STATS
+#if defined(SERIAL_IN)
+  if (dispatchCheck) reportDispatch();
+#endif  // SERIAL_IN
+#if defined(TELEMETRY_BINARY) && defined(SERIAL_OUT)
+  if (telemetryCheck) reportTelemetry();
+#endif  // TELEMETRY_BINARY && SERIAL_OUT
+  if (stressUs) {
+    const Events::Stats st = Events::stats();
+    bool balanced = st.pushed - st.taken == Events::queued();
+    fprintf(stderr, "events              stress %lu pushes (%lu dropped), pushed %lu taken %lu overflow %lu coalesced %lu peak %u/%u, %s\n",
+            stressPushes, stressDrops, (unsigned long)st.pushed, (unsigned long)st.taken, (unsigned long)st.overflows,
+            (unsigned long)st.coalesced, st.peak, EVENT_QUEUE_SIZE, balanced ? "balanced" : "LOST EVENTS");
+  }
+  return 0;
+}
+
+#endif  // !ARDUINO
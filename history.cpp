@@ -0,0 +1,207 @@
+/**
+ * @file history.cpp
+ * @brief Implementation of the bit-packed history ring buffer.
+ */
+#include "history.hpp"
+#include "config.hpp"
+#include "hal.hpp"
+#include "bitpack.hpp"
+#include "crc.hpp"
+
+#if defined(HISTORY)
+
+namespace History {
+
+/** Samples per block; one 16-bit period stamp is shared by all of them. */
+constexpr uint8_t BLOCK_SAMPLES = 16;
+/** Packed payload bytes per block. */
+constexpr uint16_t BLOCK_BYTES = Bitpack::bytesFor7((uint16_t)BLOCK_SAMPLES * NUM_SENSORS);
+
+/**
+ * @brief A run of samples from consecutive periods.
+ */
+struct Block {
+  uint16_t firstPeriod;       ///< period number of the first sample
+  uint8_t count;              ///< samples stored in this block
+  uint8_t bits[BLOCK_BYTES];  ///< 7-bit values, sensor-major within a sample
+};
+
+/** Number of blocks that fit into the configured budget. */
+constexpr uint8_t BLOCKS = HISTORY_SRAM_BYTES / sizeof(Block);
+static_assert(BLOCKS >= 2, "HISTORY_SRAM_BYTES too small for two history blocks");
+static_assert((uint32_t)(BLOCKS - 1) * BLOCK_SAMPLES * HISTORY_SAMPLE_SECONDS >= 86400UL,
+              "History does not cover 24 h; raise HISTORY_SRAM_BYTES or HISTORY_SAMPLE_SECONDS "
+              "(each sensor adds 14 bytes per block)");
+
+#if defined(WARM_RESTART)
+NOINIT static Block blocks[BLOCKS];  // garbage after power-on; only used blocks are read
+#else
+static Block blocks[BLOCKS];
+#endif  // WARM_RESTART
+/** Index of the block receiving new samples. */
+static volatile uint8_t headBlock = 0;
+/** Blocks in use (1..BLOCKS once the first sample was stored). */
+static volatile uint8_t usedBlocks = 0;
+
+/** Number of the period currently being accumulated. */
+static uint16_t currentPeriod = 0;
+static uint32_t periodStartMillis = 0;
+/** Time into the current period at the last record(), for @ref saveState(). */
+static uint32_t recordElapsedMs = 0;
+static uint16_t sums[NUM_SENSORS];
+static uint8_t sumCount = 0;
+
+/** CRC of the blocks in use, valid until they change. */
+static uint16_t blocksCrc;
+static bool blocksCrcValid = false;
+
+/**
+ * @brief Append one averaged sample for @p period in O(1).
+ */
+static void append(uint16_t period, const uint8_t* values) {
+  Block* b = &blocks[headBlock];
+  if (usedBlocks == 0 || b->count >= BLOCK_SAMPLES || (uint16_t)(b->firstPeriod + b->count) != period) {
+    // start a new block; fill it before publishing the new head
+    uint8_t next = usedBlocks == 0 ? headBlock : (uint8_t)((headBlock + 1) % BLOCKS);
+    b = &blocks[next];
+    b->count = 0;
+    b->firstPeriod = period;
+    headBlock = next;
+    if (usedBlocks < BLOCKS) usedBlocks++;
+  }
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    Bitpack::put7(b->bits, (uint16_t)b->count * NUM_SENSORS + s, values[s]);
+  }
+  b->count++;  // single byte store publishes the sample
+  blocksCrcValid = false;
+}
+
+void record(const Lib::SensorContext& ctx) {
+  // close all periods that elapsed since the last call (wrap-safe)
+  const uint32_t periodMillis = (uint32_t)HISTORY_SAMPLE_SECONDS * 1000UL;
+  while ((uint32_t)millis() - periodStartMillis >= periodMillis) {
+    if (sumCount) {
+      uint8_t avg[NUM_SENSORS];
+      for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+        avg[s] = (sums[s] + sumCount / 2) / sumCount;
+        sums[s] = 0;
+      }
+      append(currentPeriod, avg);
+      sumCount = 0;
+    }
+    currentPeriod++;
+    periodStartMillis += periodMillis;
+  }
+  recordElapsedMs = (uint32_t)millis() - periodStartMillis;
+
+  if (sumCount == 0xFF) return;  // average of the first 255 readings is plenty
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    sums[s] += ctx.values[s];
+  }
+  sumCount++;
+}
+
+uint16_t size() {
+  uint8_t used = usedBlocks;
+  if (used == 0) return 0;
+  // all blocks but the head are full
+  return (uint16_t)(used - 1) * BLOCK_SAMPLES + blocks[headBlock].count;
+}
+
+uint16_t capacity() {
+  return (uint16_t)BLOCKS * BLOCK_SAMPLES;
+}
+
+bool sampleAt(uint16_t age, uint8_t* values) {
+  uint8_t used = usedBlocks;
+  uint8_t idx = headBlock;
+  for (uint8_t n = 0; n < used; n++) {
+    const Block* b = &blocks[idx];
+    uint8_t count = b->count;
+    if (age < count) {
+      uint16_t slot = (uint16_t)(count - 1 - age) * NUM_SENSORS;
+      for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+        values[s] = Bitpack::get7(b->bits, slot + s);
+      }
+      return true;
+    }
+    age -= count;
+    idx = idx ? idx - 1 : BLOCKS - 1;
+  }
+  return false;
+}
+
+bool sampleSecondsAgo(uint32_t secondsAgo, uint8_t* values) {
+  // position of the requested time relative to the start of the current period
+  const long periodMillis = (long)HISTORY_SAMPLE_SECONDS * 1000L;
+  if (secondsAgo > 0x1FFFFFUL) return false;  // keeps the millisecond math in 32 bit
+  long x = (long)((uint32_t)millis() - periodStartMillis) - (long)secondsAgo * 1000L;
+  if (x >= 0) return false;  // current period, not stored yet
+  uint32_t periodsBack = (uint32_t)((-x + periodMillis - 1) / periodMillis);
+  if (periodsBack > currentPeriod) return false;
+  uint16_t period = currentPeriod - (uint16_t)periodsBack;
+
+  uint8_t used = usedBlocks;
+  uint8_t idx = headBlock;
+  for (uint8_t n = 0; n < used; n++) {
+    const Block* b = &blocks[idx];
+    uint16_t offset = period - b->firstPeriod;  // wraps to large values if before the block
+    if (offset < b->count) {
+      for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+        values[s] = Bitpack::get7(b->bits, offset * NUM_SENSORS + s);
+      }
+      return true;
+    }
+    idx = idx ? idx - 1 : BLOCKS - 1;
+  }
+  return false;
+}
+
+void saveState(State& out) {
+  out.headBlock = headBlock;
+  out.usedBlocks = usedBlocks;
+  out.currentPeriod = currentPeriod;
+  out.periodElapsedMs = recordElapsedMs;
+  memcpy(out.sums, sums, sizeof(sums));
+  out.sumCount = sumCount;
+}
+
+bool restoreState(const State& in) {
+  if (in.headBlock >= BLOCKS || in.usedBlocks > BLOCKS) return false;
+  for (uint8_t n = 0, idx = in.headBlock; n < in.usedBlocks; n++, idx = idx ? idx - 1 : BLOCKS - 1) {
+    if (blocks[idx].count > BLOCK_SAMPLES) return false;
+  }
+  headBlock = in.headBlock;
+  usedBlocks = in.usedBlocks;
+  currentPeriod = in.currentPeriod;
+  periodStartMillis = (uint32_t)millis() - in.periodElapsedMs;
+  recordElapsedMs = in.periodElapsedMs;
+  memcpy(sums, in.sums, sizeof(sums));
+  sumCount = in.sumCount;
+  blocksCrcValid = false;
+  return true;
+}
+
+uint16_t crc(const State& state, uint16_t crc) {
+  uint8_t idx = state.headBlock;
+  for (uint8_t n = 0; n < state.usedBlocks && idx < BLOCKS; n++) {
+    crc = Crc::crc16((const uint8_t*)&blocks[idx], sizeof(Block), crc);
+    idx = idx ? idx - 1 : BLOCKS - 1;
+  }
+  return crc;
+}
+
+uint16_t crc() {
+  if (!blocksCrcValid) {
+    State now;
+    now.headBlock = headBlock;
+    now.usedBlocks = usedBlocks;
+    blocksCrc = crc(now, 0xFFFF);
+    blocksCrcValid = true;
+  }
+  return blocksCrc;
+}
+
+}  // namespace History
+
+#endif  // HISTORY
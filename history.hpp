@@ -0,0 +1,99 @@
+/**
+ * @file history.hpp
+ * @brief Bit-packed on-device history of sensor readings.
+ *
+ * Readings are averaged over @ref HISTORY_SAMPLE_SECONDS and stored as 7-bit
+ * values (humidity is 0–99) in a ring of fixed-size blocks. Every block
+ * carries a compact 16-bit period number of its first sample; samples inside
+ * a block are consecutive periods, a missed period starts a new block.
+ * Lookup by age or time is O(number of blocks) to find the block and O(1)
+ * inside it, so nothing is ever decoded sequentially.
+ */
+#pragma once
+
+#include "lib.hpp"
+
+/**
+ * @namespace History
+ * @brief Fixed-budget ring buffer of past readings.
+ */
+namespace History {
+
+/**
+ * @brief Feed the latest readings into the current history period.
+ *
+ * Call after every published reading. When the period has elapsed its
+ * average is appended in O(1). Not reentrant; call from the main loop only.
+ * @param ctx Context holding the latest readings.
+ */
+void record(const Lib::SensorContext& ctx);
+
+/**
+ * @brief Number of samples currently stored.
+ */
+uint16_t size();
+
+/**
+ * @brief Number of samples the configured SRAM budget can hold.
+ */
+uint16_t capacity();
+
+/**
+ * @brief Fetch a stored sample by age.
+ *
+ * Safe to call from an ISR: a concurrent append is either fully visible or
+ * not at all.
+ * @param age 0 for the newest sample, size()-1 for the oldest.
+ * @param values Receives @ref NUM_SENSORS values.
+ * @return false if @p age is out of range.
+ */
+bool sampleAt(uint16_t age, uint8_t* values);
+
+/**
+ * @brief Fetch the sample whose period covers the time @p secondsAgo before now.
+ * @param secondsAgo Age of the requested time in seconds.
+ * @param values Receives @ref NUM_SENSORS values.
+ * @return false if no sample was stored for that time (this includes the
+ *         period still being accumulated).
+ */
+bool sampleSecondsAgo(uint32_t secondsAgo, uint8_t* values);
+
+/**
+ * @brief Ring position and the period being accumulated. With
+ * @ref WARM_RESTART the blocks themselves live in .noinit and survive a
+ * reset; this is what it takes to pick them up again (@ref Snapshot).
+ */
+struct State {
+  uint8_t headBlock;
+  uint8_t usedBlocks;
+  uint16_t currentPeriod;
+  uint32_t periodElapsedMs;  ///< time into the current period at the last record()
+  uint16_t sums[NUM_SENSORS];
+  uint8_t sumCount;
+};
+
+/**
+ * @brief Copy the current @ref State to @p out. It changes only in
+ * @ref record(), so saving it again in between yields the same bytes.
+ */
+void saveState(State& out);
+
+/**
+ * @brief Continue from a saved @ref State, with the blocks as they are.
+ * The current period restarts @c periodElapsedMs before now.
+ * @return false (and nothing changed) if @p in does not fit the ring.
+ */
+bool restoreState(const State& in);
+
+/**
+ * @brief Continue the CRC-16 @p crc over the blocks in use by @p state.
+ */
+uint16_t crc(const State& state, uint16_t crc);
+
+/**
+ * @brief CRC-16 (init 0xFFFF) over the blocks in use now. Cached; only
+ * computed again after a sample was appended or a state restored.
+ */
+uint16_t crc();
+
+}  // namespace History
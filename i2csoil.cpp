@@ -0,0 +1,126 @@
+/**
+ * @file i2csoil.cpp
+ * @brief Implementation of the I2C soil sensor reads.
+ */
+#include "i2csoil.hpp"
+#include "config.hpp"
+#include "twi.hpp"
+
+#if defined(SENSOR_I2C)
+
+namespace I2cSoil {
+
+#define I2C_SOIL_COUNT_ENTRY(name, source, calibratedMin, calibratedMax) +(((source) & 0xC0) == 0x40 ? 1 : 0)
+/** Number of I2C soil sensors in @ref SENSOR_LIST. */
+constexpr uint8_t COUNT = 0 SENSOR_LIST(I2C_SOIL_COUNT_ENTRY);
+#undef I2C_SOIL_COUNT_ENTRY
+/** Array size; zero-length arrays are not allowed. */
+constexpr uint8_t SLOTS = COUNT ? COUNT : 1;
+
+/** seesaw command: touch module (0x0F), channel 0 (0x10). */
+static const uint8_t TOUCH_READ[2] = { 0x0F, 0x10 };
+
+/** Round state; the requests move the bus on their own. */
+enum State : uint8_t {
+  Idle,
+  Measuring,  ///< commands sent, waiting for the sensors
+  Reading,    ///< read requests queued
+  Done
+};
+
+static State state = Idle;
+static uint32_t commandMillis = 0;
+static Twi::Request requests[SLOTS];
+static uint8_t results[SLOTS][2];
+/** Sensor index of each request. */
+static uint8_t sensorOf[SLOTS];
+/** Last good reading per request, on the 10-bit analog scale. */
+static uint16_t raws[SLOTS];
+static uint16_t failures = 0;
+
+bool start() {
+  if (state == Measuring || state == Reading) return false;
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < NUM_SENSORS && n < COUNT; i++) {
+    uint8_t address = Lib::getSensorI2cAddress(i);
+    if (!address) continue;
+    Twi::Request& r = requests[n];
+    r.address = address;
+    r.tx = TOUCH_READ;
+    r.txLen = sizeof(TOUCH_READ);
+    r.rx = nullptr;
+    r.rxLen = 0;
+    sensorOf[n++] = i;
+    Twi::submit(r);
+  }
+  commandMillis = millis();
+  state = Measuring;
+  return true;
+}
+
+void service() {
+  if (state == Measuring) {
+    if ((uint32_t)millis() - commandMillis < I2C_SOIL_MEASURE_MS) return;
+    for (uint8_t n = 0; n < COUNT; n++) {
+      if (requests[n].status == Twi::Pending) return;
+    }
+    for (uint8_t n = 0; n < COUNT; n++) {
+      Twi::Request& r = requests[n];
+      if (r.status != Twi::Ok) continue;  // counted below as a failed read
+      r.tx = nullptr;
+      r.txLen = 0;
+      r.rx = results[n];
+      r.rxLen = sizeof(results[n]);
+      Twi::submit(r);
+    }
+    state = Reading;
+  } else if (state == Reading) {
+    for (uint8_t n = 0; n < COUNT; n++) {
+      if (requests[n].status == Twi::Pending) return;
+    }
+    for (uint8_t n = 0; n < COUNT; n++) {
+      uint16_t reading = ((uint16_t)results[n][0] << 8) | results[n][1];
+      if (requests[n].status != Twi::Ok || !requests[n].rxLen || reading == 0xFFFF) {
+        failures++;
+        continue;
+      }
+      if (reading > 2046) reading = 2046;
+      raws[n] = 1023 - reading / 2;
+    }
+    state = Done;
+  }
+}
+
+bool isDone() {
+  return state == Done || state == Idle;
+}
+
+bool collect(Lib::SensorContext& out) {
+  if (!isDone()) return false;
+  for (uint8_t n = 0; n < COUNT; n++) {
+    out.values[sensorOf[n]] = Lib::rawToHumidity(sensorOf[n], raws[n]);
+#if defined(ADC_OVERSAMPLE)
+    out.raw[sensorOf[n]] = raws[n] << ADC_OVERSAMPLE_BITS;
+#endif  // ADC_OVERSAMPLE
+  }
+  state = Idle;
+  return true;
+}
+
+void read(Lib::SensorContext& out) {
+  if (!start()) return;
+  while (!isDone()) {
+    Twi::poll();
+    service();
+    Hal::spinWait();
+  }
+  collect(out);
+}
+
+uint16_t errors() {
+  return failures;
+}
+
+}  // namespace I2cSoil
+
+#endif  // SENSOR_I2C
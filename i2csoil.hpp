@@ -0,0 +1,68 @@
+/**
+ * @file i2csoil.hpp
+ * @brief I2C capacitive soil sensors (Adafruit STEMMA soil sensor, seesaw
+ * firmware) on the shared @ref Twi bus.
+ *
+ * A round sends the measurement command to every @c I2C_SOIL(n) entry of
+ * @ref SENSOR_LIST at once, and reads the results back after
+ * @ref I2C_SOIL_MEASURE_MS. All transfers are @ref Twi::Request records, so
+ * nothing waits for the bus. A reading of 200 (dry air) to about 2000
+ * (water) is mapped to 1023 - reading / 2, the scale and direction of the
+ * analog sensors, so calibration curves work the same way.
+ *
+ * A sensor that does not answer keeps its previous value and is counted in
+ * @ref I2cSoil::errors().
+ */
+#pragma once
+
+#include "lib.hpp"
+
+#if defined(SENSOR_I2C)
+
+#if !defined(TWI_ASYNC)
+#error "SENSOR_I2C requires TWI_ASYNC"
+#endif
+
+/**
+ * @namespace I2cSoil
+ * @brief Non-blocking reads of the I2C soil sensors.
+ */
+namespace I2cSoil {
+
+/**
+ * @brief Send the measurement command to all I2C soil sensors.
+ * @return false if a round is still in progress (nothing is restarted).
+ */
+bool start();
+
+/**
+ * @brief Advance a running round; call from the main loop.
+ */
+void service();
+
+/**
+ * @brief Query whether the round started last has finished (also true
+ * before the first round).
+ */
+bool isDone();
+
+/**
+ * @brief Write the values of the I2C soil sensors of a finished round into
+ * @p out.
+ * @return false if the round has not finished yet.
+ */
+bool collect(Lib::SensorContext& out);
+
+/**
+ * @brief Run a complete round, waiting for it, and write the values into @p out.
+ */
+void read(Lib::SensorContext& out);
+
+/**
+ * @brief Number of sensor reads that failed since boot.
+ */
+uint16_t errors();
+
+}  // namespace I2cSoil
+
+#endif  // SENSOR_I2C
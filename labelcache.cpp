@@ -0,0 +1,168 @@
+/**
+ * @file labelcache.cpp
+ * @brief Implementation of the main screen label cache.
+ */
+#include "labelcache.hpp"
+#include "config.hpp"
+#include "lib.hpp"
+
+#if defined(DISP) && defined(LABEL_CACHE)
+
+namespace LabelCache {
+
+/**
+ * @brief One cached text. Its pixels are stored column by column,
+ * @c bands bytes per column (bit 0 of the first byte is the top row),
+ * starting @c top rows above (negative) or below the baseline.
+ */
+struct Label {
+  uint16_t offset;  ///< start in @ref pool
+  uint8_t width;    ///< columns; 0 if not cached
+  int8_t top;
+  uint8_t bands;
+};
+
+/** Labels 0–9 are the digits, then one per sensor. */
+constexpr uint8_t NUM_LABELS = 10 + NUM_SENSORS;
+
+static uint8_t pool[LABEL_CACHE_BYTES];
+static uint16_t used = 0;
+static Label labels[NUM_LABELS];
+/** Horizontal advance of a digit. */
+static uint8_t digitAdvance = 0;
+
+/**
+ * @brief Draw @p text (or @p digit if @p text is nullptr) and keep its
+ * pixels as label @p index if they fit into the rest of the pool.
+ */
+static void rasterize(Hal::Display& display, uint8_t index, const char* text, char digit) {
+  Label& label = labels[index];
+  label.width = 0;
+
+  const uint8_t height = display.getMaxCharHeight();
+  const int8_t ascent = (int8_t)(height + display.getDescent());
+  const uint8_t bands = (height + 7) / 8;
+  uint16_t width = (uint16_t)(text ? strlen(text) : 1) * display.getMaxCharWidth();
+  if (width > display.getDisplayWidth()) width = display.getDisplayWidth();
+  if (bands > 4 || used + width * bands > LABEL_CACHE_BYTES) return;
+
+  // Draw with the top row at display row 0 and collect the page buffer,
+  // one page of tile rows at a time, as @p bands bytes per column.
+  uint8_t* out = &pool[used];
+  const uint8_t* buffer = display.getBufferPtr();
+  const uint16_t stride = display.getBufferTileWidth() * 8;
+  const uint8_t pageRows = display.getBufferTileHeight();
+  for (uint8_t row = 0; row < bands; row += pageRows) {
+    display.setBufferCurrTileRow(row);
+    display.clearBuffer();
+    display.setCursor(0, ascent);
+    if (text) display.print(text);
+    else display.print(digit);
+    for (uint8_t r = 0; r < pageRows && row + r < bands; r++) {
+      for (uint8_t x = 0; x < width; x++) out[x * bands + row + r] = buffer[r * stride + x];
+    }
+  }
+
+  // Trim empty rows and trailing empty columns, then pack in place (a
+  // column never moves past its own unpacked position).
+  uint32_t rowsSet = 0;
+  uint8_t lastColumn = 0;
+  for (uint8_t x = 0; x < width; x++) {
+    uint32_t column = 0;
+    for (uint8_t b = 0; b < bands; b++) column |= (uint32_t)out[x * bands + b] << (8 * b);
+    if (column) lastColumn = x + 1;
+    rowsSet |= column;
+  }
+  if (!rowsSet) return;
+  uint8_t first = 0;
+  while (!(rowsSet & (1UL << first))) first++;
+  uint8_t last = 31;
+  while (!(rowsSet & (1UL << last))) last--;
+  const uint8_t packedBands = (uint8_t)((last - first) / 8 + 1);
+  for (uint8_t x = 0; x < lastColumn; x++) {
+    uint32_t column = 0;
+    for (uint8_t b = 0; b < bands; b++) column |= (uint32_t)out[x * bands + b] << (8 * b);
+    column >>= first;
+    for (uint8_t b = 0; b < packedBands; b++) out[x * packedBands + b] = (uint8_t)(column >> (8 * b));
+  }
+
+  label.offset = used;
+  label.width = lastColumn;
+  label.top = (int8_t)(first - ascent);
+  label.bands = packedBands;
+  used += (uint16_t)lastColumn * packedBands;
+}
+
+void build(Hal::Display& display) {
+  used = 0;
+  digitAdvance = display.getMaxCharWidth();
+  for (uint8_t d = 0; d < 10; d++) rasterize(display, d, nullptr, (char)('0' + d));
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) rasterize(display, 10 + i, Lib::getSensorName(i), 0);
+  display.clearBuffer();
+}
+
+/**
+ * @brief OR @p label with its baseline at @p x, @p y into the rows of the
+ * current page it covers.
+ */
+static void blit(Hal::Display& display, const Label& label, int16_t x, int16_t y) {
+  const uint8_t pageRows = display.getBufferTileHeight();
+  const int16_t pageTop = display.getBufferCurrTileRow() * 8;
+  const int16_t top = y + label.top;
+  const int16_t height = label.bands * 8;
+  if (top >= pageTop + pageRows * 8 || top + height <= pageTop) return;
+
+  uint8_t* buffer = display.getBufferPtr();
+  const uint16_t stride = display.getBufferTileWidth() * 8;
+  const uint8_t* src = &pool[label.offset];
+  for (uint8_t c = 0; c < label.width; c++, src += label.bands) {
+    int16_t px = x + c;
+    if (px < 0) continue;
+    if (px >= (int16_t)stride) break;
+    uint32_t column = 0;
+    for (uint8_t b = 0; b < label.bands; b++) column |= (uint32_t)src[b] << (8 * b);
+    for (uint8_t r = 0; r < pageRows; r++) {
+      int16_t shift = pageTop + 8 * r - top;  // label row in bit 0 of this byte
+      if (shift <= -8 || shift >= height) continue;
+      buffer[r * stride + px] |= (uint8_t)(shift >= 0 ? column >> shift : column << -shift);
+    }
+  }
+}
+
+bool drawName(Hal::Display& display, uint8_t sensor, int16_t x, int16_t y) {
+  if (sensor >= NUM_SENSORS || !labels[10 + sensor].width) return false;
+  blit(display, labels[10 + sensor], x, y);
+  return true;
+}
+
+bool drawNumber(Hal::Display& display, uint8_t value, int16_t x, int16_t y) {
+  uint8_t digits[3];
+  uint8_t n = 0;
+  do {
+    digits[n++] = value % 10;
+    value /= 10;
+  } while (value);
+  for (uint8_t i = 0; i < n; i++) {
+    if (!labels[digits[i]].width) return false;
+  }
+  while (n--) {
+    blit(display, labels[digits[n]], x, y);
+    x += digitAdvance;
+  }
+  return true;
+}
+
+uint16_t bytesUsed() {
+  return used;
+}
+
+#if !defined(ARDUINO)
+void clear() {
+  used = 0;
+  for (Label& label : labels) label.width = 0;
+}
+#endif  // !ARDUINO
+
+}  // namespace LabelCache
+
+#endif  // DISP && LABEL_CACHE
@@ -0,0 +1,65 @@
+/**
+ * @file labelcache.hpp
+ * @brief Pre-rasterized sensor names and digits for the main screen.
+ *
+ * The main screen draws every sensor name and value once per page, and
+ * U8g2 decodes each glyph from the PROGMEM font again every time, although
+ * the texts rarely change (only on a rename with CFG, which rebuilds the
+ * cache). @ref LabelCache::build() draws the
+ * digits 0–9 and the sensor names once into the page buffer and keeps the
+ * pixels, trimmed to the rows and columns actually set, in a
+ * @ref LABEL_CACHE_BYTES byte pool. Drawing a cached label then ORs its
+ * columns into the part of the current page it covers.
+ *
+ * Digits are cached first since every value uses them, then the names in
+ * display order as long as they fit. A label that did not fit is reported
+ * as missing and the caller falls back to printing it.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+#if defined(DISP) && defined(LABEL_CACHE)
+
+/**
+ * @namespace LabelCache
+ * @brief Bitmap cache of the main screen texts.
+ */
+namespace LabelCache {
+
+/**
+ * @brief Rasterize the digits and sensor names with the current font of
+ * @p display. Uses the page buffer, so call it before drawing a page.
+ */
+void build(Hal::Display& display);
+
+/**
+ * @brief Draw the name of @p sensor with its baseline at @p x, @p y into
+ * the current page (in draw color 1).
+ * @return false if the name is not cached.
+ */
+bool drawName(Hal::Display& display, uint8_t sensor, int16_t x, int16_t y);
+
+/**
+ * @brief Draw @p value in decimal with its baseline at @p x, @p y into the
+ * current page (in draw color 1).
+ * @return false if the digits are not cached.
+ */
+bool drawNumber(Hal::Display& display, uint8_t value, int16_t x, int16_t y);
+
+/**
+ * @brief Bytes of the pool in use.
+ */
+uint16_t bytesUsed();
+
+#if !defined(ARDUINO)
+/**
+ * @brief Drop all labels, so every text is printed again (host builds
+ * only, for benchmarks); @ref build() fills the cache again.
+ */
+void clear();
+#endif  // !ARDUINO
+
+}  // namespace LabelCache
+
+#endif  // DISP && LABEL_CACHE
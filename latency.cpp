@@ -0,0 +1,74 @@
+/**
+ * @file latency.cpp
+ * @brief Implementation of the stage latency histograms.
+ */
+#include "latency.hpp"
+#include "config.hpp"
+
+#if defined(LATENCY_STATS)
+
+namespace Latency {
+
+static Histogram histograms[NUM_STAGES];
+static uint16_t overhead = 0;
+
+/** Index of the highest set bit of @p us, capped at the last bin. */
+static uint8_t binOf(uint32_t us) {
+  if (us >> BINS) return BINS - 1;
+  uint16_t v = (uint16_t)us;
+  uint8_t bin = 0;
+  while (v >>= 1) bin++;
+  return bin;
+}
+
+void begin() {
+  uint16_t best = 0xFFFF;
+  for (uint8_t i = 0; i < 8; i++) {
+    uint32_t t0 = micros();
+    {
+      LATENCY_SCOPE(Loop);
+    }
+    uint32_t dt = (uint32_t)micros() - t0;
+    if (dt < best) best = (uint16_t)dt;
+  }
+  overhead = best;
+  reset();
+}
+
+void record(Stage stage, uint32_t us) {
+  Histogram& h = histograms[stage];
+  h.count++;
+  if (us > h.maxUs) h.maxUs = us;
+  if (us < h.minUs) h.minUs = us > 0xFFFF ? 0xFFFF : (uint16_t)us;
+  uint16_t& bin = h.bins[binOf(us)];
+  if (bin != 0xFFFF) bin++;
+}
+
+void reset() {
+  memset(histograms, 0, sizeof(histograms));
+  for (uint8_t i = 0; i < NUM_STAGES; i++) histograms[i].minUs = 0xFFFF;
+}
+
+const Histogram& histogram(Stage stage) {
+  return histograms[stage];
+}
+
+const __FlashStringHelper* name(Stage stage) {
+  switch (stage) {
+    case Loop: return F("loop");
+    case Sensors: return F("sensors");
+    case Publish: return F("publish");
+    case Render: return F("render");
+    case SerialPoll: return F("serial");
+    case DebugScreen: return F("debug");
+    default: return F("?");
+  }
+}
+
+uint16_t overheadUs() {
+  return overhead;
+}
+
+}  // namespace Latency
+
+#endif  // LATENCY_STATS
@@ -0,0 +1,120 @@
+/**
+ * @file latency.hpp
+ * @brief Latency histograms of the main loop stages.
+ *
+ * A stage is timed by placing @ref LATENCY_SCOPE at the top of the block to
+ * measure: the scope takes micros() on entry and records the elapsed time
+ * on exit into the stage's histogram. Bin @c b counts durations of
+ * 2^b to 2^(b+1)-1 µs (bin 0 also counts 0 µs); the last bin collects
+ * everything from 2^(@ref Latency::BINS - 1) µs up. Count, minimum and
+ * maximum are kept exactly.
+ *
+ * Without @ref LATENCY_STATS the macro expands to nothing, so the
+ * instrumented code is unchanged. A scope costs two micros() calls and the
+ * binning; @ref Latency::begin() measures this on the device and the STATS
+ * command reports it.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+#if defined(LATENCY_STATS)
+
+/**
+ * @namespace Latency
+ * @brief Stage timing histograms in SRAM.
+ */
+namespace Latency {
+
+/**
+ * @brief Instrumented stages.
+ */
+enum Stage : uint8_t {
+  Loop,         ///< one scheduler pass (without the sleep)
+  Sensors,      ///< blocking sensor read (readSensors())
+  Publish,      ///< recording and sending a new reading
+  Render,       ///< View::printMainScreen()
+  SerialPoll,   ///< SerialController::pollSerial()
+  DebugScreen,  ///< drawing the debug overlay
+  NUM_STAGES
+};
+
+/** Histogram bins per stage. */
+constexpr uint8_t BINS = 16;
+
+/**
+ * @brief Timing of one stage since boot or the last @ref reset().
+ */
+struct Histogram {
+  uint32_t count;
+  uint32_t maxUs;
+  uint16_t minUs;  ///< saturates at 65535
+  uint16_t bins[BINS];  ///< saturating counts per log2 bin
+};
+
+/**
+ * @brief Clear the histograms and measure the cost of a scope; call once
+ * from setup().
+ */
+void begin();
+
+/**
+ * @brief Add a duration of @p us to @p stage.
+ */
+void record(Stage stage, uint32_t us);
+
+/**
+ * @brief Clear all histograms.
+ */
+void reset();
+
+/**
+ * @brief Access the histogram of @p stage.
+ */
+const Histogram& histogram(Stage stage);
+
+/**
+ * @brief Flash-stored name of @p stage for reports.
+ */
+const __FlashStringHelper* name(Stage stage);
+
+/**
+ * @brief Time one empty scope took at boot, in µs (the per-call overhead).
+ */
+uint16_t overheadUs();
+
+/**
+ * @brief Times its own lifetime into a stage; see @ref LATENCY_SCOPE.
+ */
+class Scope {
+public:
+  explicit Scope(Stage stage)
+    : stage(stage), start(micros()) {}
+  ~Scope() {
+    record(stage, (uint32_t)micros() - start);
+  }
+
+private:
+  Stage stage;
+  uint32_t start;
+};
+
+}  // namespace Latency
+
+#define LATENCY_CONCAT_(a, b) a##b
+#define LATENCY_CONCAT(a, b) LATENCY_CONCAT_(a, b)
+
+/**
+ * @def LATENCY_SCOPE
+ * @brief Time the rest of the enclosing block into @p stage
+ * (a @ref Latency::Stage).
+ */
+#define LATENCY_SCOPE(stage) Latency::Scope LATENCY_CONCAT(latencyScope, __LINE__)(Latency::stage)
+
+#else
+
+#define LATENCY_SCOPE(stage) \
+  do { \
+  } while (0)
+
+#endif  // LATENCY_STATS
@@ -4,11 +4,68 @@
  */
 #include "lib.hpp"
 #include "config.hpp"
-#include "Arduino.h"
+#include "hal.hpp"
+#include "calibration.hpp"
+#include "filter.hpp"
+#include "i2csoil.hpp"
+#include "settings.hpp"
 
 namespace Lib {
 SensorContext ctx;
-static long timeOfDayMillisOffset = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////  REGISTRY  ////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Registry entry of one sensor, generated from @ref SENSOR_LIST.
+ */
+struct SensorDef {
+  char name[SENSOR_NAME_LENGTH];
+  uint8_t source;  ///< analog pin, MUX_CHANNEL(n) or I2C_SOIL(n)
+};
+
+/** Flag marking a multiplexer channel in SensorDef::source. */
+constexpr uint8_t MUX_FLAG = 0x80;
+/** Flag marking an I2C soil sensor in SensorDef::source. */
+constexpr uint8_t I2C_FLAG = 0x40;
+/** Address of the I2C soil sensor I2C_SOIL(0). */
+constexpr uint8_t I2C_SOIL_BASE_ADDRESS = 0x36;
+
+// Multiplexer and I2C sources are only valid with their feature enabled.
+#if defined(SENSOR_MUX)
+constexpr uint8_t MUX_CHANNELS = 16;
+#else
+constexpr uint8_t MUX_CHANNELS = 0;
+#endif  // SENSOR_MUX
+#if defined(SENSOR_I2C)
+constexpr uint8_t I2C_SOIL_ADDRESSES = 4;
+#else
+constexpr uint8_t I2C_SOIL_ADDRESSES = 0;
+#endif  // SENSOR_I2C
+
+constexpr bool isValidSource(uint8_t source) {
+  return (source & MUX_FLAG)   ? (source & ~MUX_FLAG) < MUX_CHANNELS
+         : (source & I2C_FLAG) ? (source & ~I2C_FLAG) < I2C_SOIL_ADDRESSES
+                               : (source >= A0 && source <= A7);
+}
+
+#define SENSOR_CHECK_ENTRY(name, source, calibratedMin, calibratedMax) \
+  static_assert(sizeof(name) <= SENSOR_NAME_LENGTH, "Sensor name too long: " name); \
+  static_assert(isValidSource(source), "Invalid source (analog pin; MUX_CHANNEL needs SENSOR_MUX, I2C_SOIL needs SENSOR_I2C): " name);
+SENSOR_LIST(SENSOR_CHECK_ENTRY)
+#undef SENSOR_CHECK_ENTRY
+
+#define SENSOR_DEF_ENTRY(name, source, calibratedMin, calibratedMax) { name, source },
+static const SensorDef REGISTRY[NUM_SENSORS] PROGMEM = { SENSOR_LIST(SENSOR_DEF_ENTRY) };
+#undef SENSOR_DEF_ENTRY
+
+/** Name of an index outside @ref REGISTRY, in flash like the registry names. */
+static const char UNKNOWN_NAME[] PROGMEM = "?";
+
+static uint8_t getSource(uint8_t sensorIndex) {
+  return pgm_read_byte(&REGISTRY[sensorIndex].source);
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////  FUNCTIONS  ///////////////////////////////////
@@ -17,140 +74,173 @@ static long timeOfDayMillisOffset = 0;
 /**
    * @brief Resolve the analog pin for a given sensor index.
    * @param sensorIndex Index starting at 0.
-   * @return The Arduino analog pin number or 255 if out of range.
+   * @return The Arduino analog pin number (@ref MUX_SIG_PIN for multiplexed
+   * sensors) or 255 if out of range or not an analog sensor.
    */
 uint8_t getSensorPin(uint8_t sensorIndex) {
-  switch (sensorIndex) {
-    case 0: return SENSOR_1_PIN;
-    case 1: return SENSOR_2_PIN;
-    case 2: return SENSOR_3_PIN;
-    default: return 255;
+  if (sensorIndex >= NUM_SENSORS) return 255;
+  uint8_t source = getSource(sensorIndex);
+  if (source & MUX_FLAG) return MUX_SIG_PIN;
+  if (source & I2C_FLAG) return 255;
+  return source;
+}
+
+/**
+   * @brief Resolve the I2C address of an I2C soil sensor.
+   * @param sensorIndex Index starting at 0.
+   * @return The 7-bit address, or 0 if the sensor is read by the ADC.
+   */
+uint8_t getSensorI2cAddress(uint8_t sensorIndex) {
+  if (sensorIndex >= NUM_SENSORS) return 0;
+  uint8_t source = getSource(sensorIndex);
+  if ((source & (MUX_FLAG | I2C_FLAG)) != I2C_FLAG) return 0;
+  return I2C_SOIL_BASE_ADDRESS + (source & ~I2C_FLAG);
+}
+
+/**
+   * @brief Route a sensor to the ADC input.
+   *
+   * Switches the multiplexer for multiplexed sensors; safe to call from
+   * the ADC interrupt.
+   * @param sensorIndex Index starting at 0.
+   * @return The analog pin to convert.
+   */
+uint8_t selectSensor(uint8_t sensorIndex) {
+#if defined(SENSOR_MUX)
+  uint8_t source = getSource(sensorIndex);
+  if (source & MUX_FLAG) {
+    Hal::muxSelect(source & ~MUX_FLAG);
+    return MUX_SIG_PIN;
   }
+  return source;
+#else
+  return getSource(sensorIndex);
+#endif  // SENSOR_MUX
+}
+
+/**
+   * @brief Conversions to discard after switching to a sensor.
+   * @param sensorIndex Index starting at 0.
+   */
+uint8_t settleConversions(uint8_t sensorIndex) {
+#if defined(SENSOR_MUX)
+  if (getSource(sensorIndex) & MUX_FLAG) return MUX_SETTLE_CONVERSIONS;
+#endif  // SENSOR_MUX
+  (void)sensorIndex;
+  return ADC_SETTLE_CONVERSIONS;
 }
 
 /**
    * @brief Read a sensor multiple times and return the integer-averaged value.
    * @param addr Analog pin address.
-   * @return Rounded integer average of @ref AVERAGE_OF samples.
+   * @return Rounded integer average of the configured number of samples
+   * (@ref AVERAGE_OF unless changed with CFG).
    */
 int avgRead(uint8_t addr) {
+  const uint8_t samples = Settings::values().averageOf;
   uint16_t acc = 0;  //stores values for average calculation
-  for (uint8_t i = 0; i < AVERAGE_OF; i++) {
+  for (uint8_t i = 0; i < samples; i++) {
     acc += analogRead(addr);  //read input value from sensor
     delay(25);                //wait a moment
   }
   // integer rounded average
-  return (acc + (AVERAGE_OF / 2)) / AVERAGE_OF;
+  return (acc + (samples / 2)) / samples;
 }
 
+#if defined(SAMPLE_FILTER)
 /**
-   * @brief Convert a raw sensor reading to a humidity percentage (0–99).
-   *
-   * Uses the calibrated range @ref SENSOR_CALIBRATED_MIN to
-   * @ref SENSOR_CALIBRATED_MAX and clamps to [0, 99].
-   * @param sensorNum Sensor index (0-based).
-   * @return Percentage humidity value.
+   * @brief Read a sensor @ref FILTER_SAMPLES times and reduce the samples
+   * with the filter configured for it (@ref Filter).
+   * @param sensor Sensor index (0-based).
+   * @return Filtered raw value.
    */
-int getHumidity(const int sensorNum) {
-  int raw = avgRead(getSensorPin(sensorNum));
-  int span = (int)SENSOR_CALIBRATED_MAX - (int)SENSOR_CALIBRATED_MIN;
-  int pct = 100 - ((raw - (int)SENSOR_CALIBRATED_MIN) * 100) / span;  // integer math
-  int val = constrain(pct, 0, 99);                                    //limit value to between 0 and 99%
-  return val;
+static int filteredRead(uint8_t sensor) {
+  const uint8_t addr = selectSensor(sensor);
+  uint16_t samples[FILTER_SAMPLES];
+  for (uint8_t i = 0; i < FILTER_SAMPLES; i++) {
+    samples[i] = analogRead(addr);
+    delay(25);
+  }
+  return Filter::apply((Filter::Mode)Settings::values().filter[sensor], samples);
 }
+#endif  // SAMPLE_FILTER
 
 /**
-   * @brief Read all sensors and write results to the global context @ref ctx.
+   * @brief Sample a sensor with the configured reduction: the filter with
+   * @ref SAMPLE_FILTER, the mean otherwise.
+   * @param sensor Sensor index (0-based).
+   * @return Raw value.
    */
-void readSensorsAndUpdateMemory() {
-  for (uint8_t sensorNum = 0; sensorNum < NUM_SENSORS; sensorNum++) {
-    ctx.values[sensorNum] = getHumidity(sensorNum);
-  }
+static int sampleSensor(uint8_t sensor) {
+#if defined(SAMPLE_FILTER)
+  return filteredRead(sensor);
+#else
+  return avgRead(selectSensor(sensor));
+#endif  // SAMPLE_FILTER
 }
 
 /**
-   * @brief Return sensor name stored in flash for an index.
-   * @param idx 0-based sensor index.
-   * @return Pointer to flash-stored name; "?" if out of range.
+   * @brief Convert an averaged raw reading to a humidity percentage (0–99).
+   *
+   * Uses the active calibration curve of the sensor and clamps to [0, 99].
+   * @param sensor Sensor index.
+   * @param raw Averaged raw ADC value.
+   * @return Percentage humidity value.
    */
-const __FlashStringHelper *getSensorName(uint8_t idx) {
-  switch (idx) {
-#if NUM_SENSORS >= 1
-    case 0: return SENSOR_1_ID;
-#endif
-#if NUM_SENSORS >= 2
-    case 1: return SENSOR_2_ID;
-#endif
-#if NUM_SENSORS >= 3
-    case 2: return SENSOR_3_ID;
-#endif
-    default: return F("?");
-  }
+uint8_t rawToHumidity(uint8_t sensor, uint16_t raw) {
+  return Calibration::toHumidity(sensor, raw);
 }
 
 /**
- * @brief Setze den Millisekunden-Offset für die Effektivzeit.
- *
- * Die effektive Zeit, die an anderen Modulen (z.B. View) zurückgegeben
- * wird, ist millis() + offset. Der Offset ist signiert und kann auch
- * negative Werte annehmen.
- *
- * @param offset Signierter Offset in Millisekunden, der zu millis() addiert wird.
- * @note Diese Funktion ist nicht als ISR-sicher gedacht; sie wird typischerweise
- *       aus dem Hauptprogramm oder einer seriellen Eingabe heraus aufgerufen.
- */
-void setTimeOfDayMillisOffset(long offset) {
-  timeOfDayMillisOffset = offset;
+   * @brief Read a sensor synchronously and convert it to a humidity percentage.
+   * @param sensorNum Sensor index (0-based).
+   * @return Percentage humidity value.
+   */
+int getHumidity(const int sensorNum) {
+  return rawToHumidity(sensorNum, sampleSensor(sensorNum));
 }
 
 /**
-   * @brief Liefert die aktuelle, effektive Zeit in Millisekunden.
-   *
-   * Berechnet millis() + Offset und gibt das Ergebnis mit denselben
-   * Semantiken wie Arduino::millis() (unsigned long) zurück.
-   *
-   * @return unsigned long Effektive Zeit in Millisekunden.
+   * @brief Read all sensors and write results to the global context @ref ctx.
    */
-unsigned long getTimeOfDayAsMillis() {
-  // ensure same unsigned long semantics as Arduino::millis()
-  return (unsigned long)((long)millis() + timeOfDayMillisOffset);
+void readSensorsAndUpdateMemory() {
+#if defined(SENSOR_I2C)
+  I2cSoil::read(ctx);
+#endif  // SENSOR_I2C
+  for (uint8_t sensorNum = 0; sensorNum < NUM_SENSORS; sensorNum++) {
+#if defined(SENSOR_I2C)
+    if (getSensorI2cAddress(sensorNum)) continue;
+#endif  // SENSOR_I2C
+    int raw = sampleSensor(sensorNum);
+    ctx.values[sensorNum] = rawToHumidity(sensorNum, raw);
+#if defined(ADC_OVERSAMPLE)
+    // the blocking path does not oversample; scale to the same width
+    ctx.raw[sensorNum] = (uint16_t)raw << ADC_OVERSAMPLE_BITS;
+#endif  // ADC_OVERSAMPLE
+  }
 }
 
-// Global sensor-read request flag. volatile so it can be set from ISRs or other modules.
-static volatile uint8_t sensorReadRequested = 0;
-
 /**
-   * @brief Fordere eine Sensormessung an (als nicht-blockierendes Flag).
-   *
-   * Diese Funktion setzt ein Atom-Flag, das in der Hauptschleife abgefragt
-   * und konsumiert werden kann. Sie ist speziell so implementiert, dass
-   * bei 8-Bit-AVRs ein Byte-Schreibzugriff atomar ist und direkt aus einer
-   * ISR aufgerufen werden kann.
-   *
-   * Aufruf-Contract:
-   * - Kann aus ISR oder normalem Kontext aufgerufen werden.
-   * - Setzt internal ein Flag; führt die Messung nicht direkt durch.
+   * @brief Return the runtime name of a sensor.
+   * @param idx 0-based sensor index.
+   * @return Pointer to the name held by @ref Settings; "?" if out of range.
+   * The names live in SRAM since they can be changed with CFG, and every
+   * caller prints them with the SRAM functions, so the fallback is an SRAM
+   * string as well (@ref defaultSensorName() has the flash one).
    */
-void requestSensorRead() {
-  sensorReadRequested = 1;
+const char *getSensorName(uint8_t idx) {
+  if (idx >= NUM_SENSORS) return "?";
+  return Settings::values().names[idx];
 }
 
 /**
-   * @brief Atomar abfragen und zurücksetzen, ob eine Sensormessung angefordert wurde.
-   *
-   * Diese Funktion reserviert die Anfrage (consume) in einem atomaren Block
-   * und gibt zurück, ob vor dem Aufruf eine Messanforderung gestellt wurde.
-   *
-   * @return true  Wenn eine Messanforderung vorhanden war (und nun gelöscht wurde).
-   * @return false Wenn keine Messanforderung vorhanden war.
+   * @brief Return sensor name stored in flash for an index.
+   * @param idx 0-based sensor index.
+   * @return Pointer to flash-stored name; "?" if out of range.
    */
-bool hasSensorReadRequest() {
-  bool wasRequested;
-  noInterrupts();
-  wasRequested = (sensorReadRequested != 0);
-  sensorReadRequested = 0;
-  interrupts();
-  return wasRequested;
+const __FlashStringHelper *defaultSensorName(uint8_t idx) {
+  if (idx >= NUM_SENSORS) return reinterpret_cast<const __FlashStringHelper *>(UNKNOWN_NAME);
+  return reinterpret_cast<const __FlashStringHelper *>(REGISTRY[idx].name);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -158,15 +248,23 @@ bool hasSensorReadRequest() {
 ///////////////////////////////////////////////////////////////////////////////
 
 /**
-   * @brief Initialize the context and configure sensor input pins.
+   * @brief Initialize the context, load the default calibration and
+   * configure sensor input pins.
    */
 void initCtx() {
-  ctx = {
-    .values = { 0, 0, 0 }
-  };
+  memset(&ctx, 0, sizeof(ctx));
+
+  Calibration::begin();
 
   for (uint8_t sensorNum = 0; sensorNum < NUM_SENSORS; sensorNum++) {
-    pinMode(getSensorPin(sensorNum), INPUT);
+    uint8_t pin = getSensorPin(sensorNum);
+    if (pin != 255) pinMode(pin, INPUT);
   }
+#if defined(SENSOR_MUX)
+  pinMode(MUX_S0_PIN, OUTPUT);
+  pinMode(MUX_S1_PIN, OUTPUT);
+  pinMode(MUX_S2_PIN, OUTPUT);
+  pinMode(MUX_S3_PIN, OUTPUT);
+#endif  // SENSOR_MUX
 }
 }  // namespace Lib
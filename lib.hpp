@@ -5,7 +5,7 @@
 #pragma once
 
 #include "config.hpp"
-#include "Arduino.h"
+#include "hal.hpp"
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -21,7 +21,13 @@ namespace Lib {
      * @brief Holds the latest sensor values as percentages (0–99).
      */
 struct SensorContext {
-  uint8_t values[MAX_SENSORS];
+  uint8_t values[NUM_SENSORS];
+  /** millis() when the reading was requested. */
+  uint32_t requestMillis;
+#if defined(ADC_OVERSAMPLE)
+  /** Decimated raw ADC values with 10 + @ref ADC_OVERSAMPLE_BITS bits. */
+  uint16_t raw[NUM_SENSORS];
+#endif  // ADC_OVERSAMPLE
 };
 
 /**
@@ -30,39 +36,65 @@ struct SensorContext {
 extern SensorContext ctx;
 
 /**
-     * @brief Returns the sensor name stored in flash for a given index.
+     * @brief Returns the current sensor name for a given index.
      * @param idx Sensor index starting at 0.
-     * @return Flash string helper pointer to the configured sensor name.
+     * @return Pointer to the name in SRAM (@ref Settings); "?" if out of
+     * range.
      */
-const __FlashStringHelper *getSensorName(uint8_t idx);
+const char *getSensorName(uint8_t idx);
 
 /**
-     * @brief Reads all configured sensors and updates the global context.
+     * @brief Returns the compile-time name of a sensor stored in flash.
+     * @param idx Sensor index starting at 0.
+     * @return Flash string helper pointer to the name in @ref SENSOR_LIST;
+     * a "?" in flash if out of range.
      */
-void readSensorsAndUpdateMemory();
+const __FlashStringHelper *defaultSensorName(uint8_t idx);
+
+/**
+     * @brief Resolve the analog pin for a given sensor index.
+     * @param sensorIndex Index starting at 0.
+     * @return The Arduino analog pin number, or 255 if out of range or not
+     * an analog sensor.
+     */
+uint8_t getSensorPin(uint8_t sensorIndex);
 
 /**
-     * @brief Set the millisecond offset used to compute the effective time.
-     * @param offset Signed offset in milliseconds; effectiveTime = millis() + offset
+     * @brief Resolve the I2C address of an I2C soil sensor (@ref SENSOR_I2C).
+     * @param sensorIndex Index starting at 0.
+     * @return The 7-bit address, or 0 if the sensor is read by the ADC.
      */
-void setTimeOfDayMillisOffset(long offset);
+uint8_t getSensorI2cAddress(uint8_t sensorIndex);
 
 /**
-     * @brief Return the effective current time in milliseconds (millis() + offset).
+     * @brief Route a sensor to the ADC input (switches the multiplexer if
+     * needed; ISR-safe).
+     * @param sensorIndex Index starting at 0.
+     * @return The analog pin to convert.
      */
-unsigned long getTimeOfDayAsMillis();
+uint8_t selectSensor(uint8_t sensorIndex);
 
 /**
-     * @brief Request a sensor read to be performed by the main loop (can be set
-     * from other modules or an ISR).
+     * @brief Conversions to discard after switching to a sensor
+     * (@ref ADC_SETTLE_CONVERSIONS or @ref MUX_SETTLE_CONVERSIONS).
      */
-void requestSensorRead();
+uint8_t settleConversions(uint8_t sensorIndex);
 
 /**
-     * @brief Atomically consume and clear the pending sensor-read request.
-     * @return true if a request was pending and was cleared, false otherwise.
+     * @brief Convert an averaged raw reading to a humidity percentage (0–99)
+     * using the calibration of @p sensor (see @ref Calibration).
+     * @param sensor Sensor index.
+     * @param raw Averaged raw ADC value.
      */
-bool hasSensorReadRequest();
+uint8_t rawToHumidity(uint8_t sensor, uint16_t raw);
+
+/**
+     * @brief Reads all configured sensors and updates the global context.
+     *
+     * Blocking: takes @ref AVERAGE_OF samples per sensor with a short delay in
+     * between. Kept as synchronous fallback for @ref Adc.
+     */
+void readSensorsAndUpdateMemory();
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////    SETUP    ///////////////////////////////////
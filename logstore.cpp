@@ -0,0 +1,144 @@
+/**
+ * @file logstore.cpp
+ * @brief Implementation of the wear-leveled EEPROM reading log.
+ */
+#include "logstore.hpp"
+#include "config.hpp"
+#include "bitpack.hpp"
+#include "clock.hpp"
+#include "crc.hpp"
+#include "hal.hpp"
+#include "nvm.hpp"
+
+#if defined(LOG_EEPROM)
+
+namespace LogStore {
+
+/** Bytes holding the 7-bit packed values of one record. */
+constexpr uint8_t PACKED_BYTES = Bitpack::bytesFor7(NUM_SENSORS);
+/** Record layout: seq (2), time (4), packed values, CRC-8 (1). */
+constexpr uint8_t RECORD_BYTES = 2 + 4 + PACKED_BYTES + 1;
+/** Record slots in the EEPROM region. */
+constexpr uint16_t SLOTS = LOG_EEPROM_BYTES / RECORD_BYTES;
+
+static_assert(SLOTS >= 2, "LOG_EEPROM_BYTES too small for the log");
+static_assert((uint32_t)LOG_EEPROM_START + LOG_EEPROM_BYTES <= E2END + 1UL, "Log region exceeds the EEPROM");
+
+/** Slot the next record goes to. */
+static uint16_t headSlot = 0;
+static uint16_t nextSeq = 0;
+static uint16_t validCount = 0;
+
+static uint8_t stage[LOG_BATCH_RECORDS][RECORD_BYTES];
+static uint8_t stagedCount = 0;
+/** Staged records already queued with Nvm (the batch is flushed in order). */
+static uint8_t queuedCount = 0;
+static uint32_t lastLogMillis = 0;
+static bool hasLogged = false;
+
+static uint16_t slotAddr(uint16_t slot) {
+  return LOG_EEPROM_START + slot * RECORD_BYTES;
+}
+
+static void encode(uint8_t* rec, uint16_t seq, uint32_t time, const uint8_t* values) {
+  rec[0] = (uint8_t)seq;
+  rec[1] = (uint8_t)(seq >> 8);
+  for (uint8_t i = 0; i < 4; i++) rec[2 + i] = (uint8_t)(time >> (8 * i));
+
+  memset(&rec[6], 0, PACKED_BYTES);  // deterministic padding bits
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) Bitpack::put7(&rec[6], s, values[s]);
+  rec[RECORD_BYTES - 1] = Crc::crc8(rec, RECORD_BYTES - 1);
+}
+
+static bool decode(const uint8_t* rec, Record& out) {
+  bool erased = true;
+  for (uint8_t i = 0; i < RECORD_BYTES; i++) {
+    if (rec[i] != 0xFF) {
+      erased = false;
+      break;
+    }
+  }
+  if (erased || Crc::crc8(rec, RECORD_BYTES - 1) != rec[RECORD_BYTES - 1]) return false;
+
+  out.seq = rec[0] | ((uint16_t)rec[1] << 8);
+  out.time = 0;
+  for (uint8_t i = 0; i < 4; i++) out.time |= (uint32_t)rec[2 + i] << (8 * i);
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) out.values[s] = Bitpack::get7(&rec[6], s);
+  return true;
+}
+
+static bool readSlot(uint16_t slot, Record& out) {
+  uint8_t rec[RECORD_BYTES];
+  uint16_t addr = slotAddr(slot);
+  for (uint8_t i = 0; i < RECORD_BYTES; i++) rec[i] = EEPROM.read(addr + i);
+  return decode(rec, out);
+}
+
+void begin() {
+  // One pass: the newest record is the valid one with the highest sequence
+  // number in serial-number arithmetic.
+  Record r;
+  bool found = false;
+  uint16_t newestSlot = 0;
+  uint16_t newestSeq = 0;
+  validCount = 0;
+  for (uint16_t slot = 0; slot < SLOTS; slot++) {
+    if (!readSlot(slot, r)) continue;
+    validCount++;
+    if (!found || (int16_t)(r.seq - newestSeq) > 0) {
+      found = true;
+      newestSeq = r.seq;
+      newestSlot = slot;
+    }
+  }
+  headSlot = found ? (newestSlot + 1) % SLOTS : 0;
+  nextSeq = found ? newestSeq + 1 : 0;
+}
+
+void flush() {
+  while (queuedCount < stagedCount) {
+    if (!Nvm::write(slotAddr(headSlot), stage[queuedCount], RECORD_BYTES)) return;  // retried by service()
+    headSlot = (headSlot + 1) % SLOTS;
+    if (validCount < SLOTS) validCount++;
+    queuedCount++;
+  }
+  stagedCount = 0;
+  queuedCount = 0;
+}
+
+void record(const Lib::SensorContext& ctx) {
+  uint32_t now = millis();
+  if (hasLogged && now - lastLogMillis < (uint32_t)LOG_INTERVAL_SECONDS * 1000UL) return;
+  if (stagedCount >= LOG_BATCH_RECORDS) return;  // writer is behind; drop rather than block
+  hasLogged = true;
+  lastLogMillis = now;
+
+  encode(stage[stagedCount++], nextSeq++, Clock::seconds(), ctx.values);
+  if (stagedCount >= LOG_BATCH_RECORDS) flush();
+}
+
+void service() {
+  if (queuedCount || stagedCount >= LOG_BATCH_RECORDS) flush();
+}
+
+uint16_t count() {
+  return validCount;
+}
+
+uint16_t capacity() {
+  return SLOTS;
+}
+
+uint16_t nextSequence() {
+  return nextSeq;
+}
+
+bool read(uint16_t age, Record& out) {
+  if (age >= validCount) return false;
+  uint16_t slot = (headSlot + SLOTS - 1 - age) % SLOTS;
+  return readSlot(slot, out);
+}
+
+}  // namespace LogStore
+
+#endif  // LOG_EEPROM
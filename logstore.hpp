@@ -0,0 +1,80 @@
+/**
+ * @file logstore.hpp
+ * @brief Wear-leveled, append-only reading log in EEPROM.
+ *
+ * Records are appended round-robin over the EEPROM region
+ * @ref LOG_EEPROM_START .. @ref LOG_EEPROM_START + @ref LOG_EEPROM_BYTES, so
+ * every cell is written equally often. Each record carries a 16-bit
+ * sequence number and a CRC-8; at boot a single scan over the region finds
+ * the newest valid record and appending continues behind it. Records are
+ * staged in RAM and handed to @ref Nvm in batches, so logging never waits
+ * for the EEPROM.
+ */
+#pragma once
+
+#include "lib.hpp"
+
+/**
+ * @namespace LogStore
+ * @brief Persistent log of readings that survives resets and power loss.
+ */
+namespace LogStore {
+
+/**
+ * @brief A decoded log record.
+ */
+struct Record {
+  uint16_t seq;                  ///< sequence number (wraps)
+  uint32_t time;                 ///< clock time in seconds (Clock::seconds())
+  uint8_t values[NUM_SENSORS];   ///< humidity values (0–99)
+};
+
+/**
+ * @brief Recover the log position by scanning the EEPROM region once.
+ */
+void begin();
+
+/**
+ * @brief Log the latest readings if @ref LOG_INTERVAL_SECONDS have passed.
+ *
+ * The record is staged in RAM; once @ref LOG_BATCH_RECORDS are staged the
+ * batch is queued for writing.
+ * @param ctx Context holding the latest readings.
+ */
+void record(const Lib::SensorContext& ctx);
+
+/**
+ * @brief Queue staged records for writing even if the batch is not full.
+ */
+void flush();
+
+/**
+ * @brief Retry handing a full batch to @ref Nvm if its queue was busy; call
+ * from the main loop. Never blocks.
+ */
+void service();
+
+/**
+ * @brief Number of valid records in EEPROM (written or queued).
+ */
+uint16_t count();
+
+/**
+ * @brief Number of record slots in the EEPROM region.
+ */
+uint16_t capacity();
+
+/**
+ * @brief Sequence number the next record will get.
+ */
+uint16_t nextSequence();
+
+/**
+ * @brief Read a record back from EEPROM.
+ * @param age 0 for the newest written record.
+ * @param out Receives the decoded record.
+ * @return false if out of range, not yet written or the CRC does not match.
+ */
+bool read(uint16_t age, Record& out);
+
+}  // namespace LogStore
@@ -0,0 +1,80 @@
+/**
+ * @file nvm.cpp
+ * @brief Implementation of the staged EEPROM writer.
+ */
+#include "nvm.hpp"
+#include "config.hpp"
+
+namespace Nvm {
+
+/** Bytes per staging entry; longer writes occupy several entries. */
+constexpr uint8_t CHUNK_BYTES = 16;
+
+/**
+ * @brief A contiguous run of bytes waiting to be written.
+ */
+struct Chunk {
+  uint16_t addr;
+  uint8_t len;
+  uint8_t data[CHUNK_BYTES];
+};
+
+static Chunk queue[NVM_QUEUE_CHUNKS];
+static uint8_t queueHead = 0;   // next free entry
+static uint8_t queueTail = 0;   // entry being written
+static uint8_t queueCount = 0;
+static uint8_t tailPos = 0;     // next byte within the tail entry
+static Stats counters = {};
+
+bool write(uint16_t addr, const void* data, uint8_t len) {
+  uint8_t needed = (len + CHUNK_BYTES - 1) / CHUNK_BYTES;
+  if (needed > NVM_QUEUE_CHUNKS - queueCount) return false;
+
+  const uint8_t* src = (const uint8_t*)data;
+  while (len) {
+    Chunk& c = queue[queueHead];
+    c.addr = addr;
+    c.len = len < CHUNK_BYTES ? len : CHUNK_BYTES;
+    memcpy(c.data, src, c.len);
+    addr += c.len;
+    src += c.len;
+    len -= c.len;
+    counters.requested += c.len;
+    queueHead = (queueHead + 1) % NVM_QUEUE_CHUNKS;
+    queueCount++;
+  }
+  return true;
+}
+
+bool isIdle() {
+  return queueCount == 0;
+}
+
+void service() {
+  if (!queueCount || !eeprom_is_ready()) return;
+
+  Chunk& c = queue[queueTail];
+  // Reading is cheap while the EEPROM is idle, so skip matching bytes until
+  // one physical write has been started.
+  while (tailPos < c.len) {
+    uint16_t addr = c.addr + tailPos;
+    uint8_t value = c.data[tailPos++];
+    if (EEPROM.read(addr) != value) {
+      EEPROM.write(addr, value);  // returns right away, the EEPROM finishes in the background
+      counters.written++;
+      break;
+    }
+    counters.skipped++;
+  }
+  if (tailPos >= c.len) {
+    tailPos = 0;
+    queueTail = (queueTail + 1) % NVM_QUEUE_CHUNKS;
+    queueCount--;
+  }
+}
+
+const Stats& stats() {
+  return counters;
+}
+
+}  // namespace Nvm
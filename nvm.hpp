@@ -0,0 +1,55 @@
+/**
+ * @file nvm.hpp
+ * @brief Staged, non-blocking EEPROM writer.
+ *
+ * An EEPROM byte write keeps the ATmega328P busy for ~3.3 ms, and the
+ * avr-libc write routine spins until the previous write has finished.
+ * This module queues writes in RAM and issues at most one physical byte
+ * write per @ref Nvm::service() call, only when the EEPROM is ready, so the
+ * main loop never waits. Bytes that already hold the target value are
+ * skipped, which keeps wear and write amplification down.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Nvm
+ * @brief Deferred EEPROM writes.
+ */
+namespace Nvm {
+
+/**
+ * @brief Write statistics, e.g. to compute write amplification.
+ */
+struct Stats {
+  uint32_t requested;  ///< bytes handed to write()
+  uint32_t written;    ///< physical byte writes issued
+  uint32_t skipped;    ///< bytes that already held the target value
+};
+
+/**
+ * @brief Queue @p len bytes for writing at EEPROM address @p addr.
+ *
+ * The data is copied, the caller may reuse its buffer immediately. The
+ * request is queued completely or not at all.
+ * @return false if the staging queue has no room (retry later).
+ */
+bool write(uint16_t addr, const void* data, uint8_t len);
+
+/**
+ * @brief Query whether all queued bytes have been written.
+ */
+bool isIdle();
+
+/**
+ * @brief Advance pending writes without blocking; call from the main loop.
+ */
+void service();
+
+/**
+ * @brief Access the write statistics.
+ */
+const Stats& stats();
+
+}  // namespace Nvm
@@ -0,0 +1,97 @@
+/**
+ * @file power.cpp
+ * @brief Implementation of the sleep management.
+ */
+#include "power.hpp"
+#include "adc.hpp"
+#include "clock.hpp"
+#include "events.hpp"
+#include "config.hpp"
+#include "lib.hpp"
+#include "SerialController.hpp"
+#include "twi.hpp"
+
+#if defined(POWER_SAVE)
+
+namespace Power {
+
+/** Duration of one ADC conversion (13 ADC clocks at 125 kHz). */
+constexpr uint16_t ADC_CONVERSION_US = 104;
+
+static uint32_t startMillis = 0;
+static uint32_t idleMs = 0;
+static uint16_t idleUs = 0;
+static uint32_t adcMs = 0;
+static uint16_t adcUs = 0;
+static uint32_t sleeps = 0;
+
+/** Add @p us to a millisecond counter with microsecond remainder. */
+static void accumulate(uint32_t& ms, uint16_t& us, unsigned long add) {
+  add += us;
+  ms += add / 1000UL;
+  us = add % 1000UL;
+}
+
+void idle() {
+  noInterrupts();
+#if defined(ADC_NOISE_SLEEP)
+  bool adcPending = Adc::takePendingStart();
+#else
+  bool adcPending = false;
+#endif  // ADC_NOISE_SLEEP
+
+  bool workPending = Events::pending() || Adc::hasResult();
+#if defined(SERIAL_IN)
+  workPending = workPending || Serial.available() > 0;
+#endif  // SERIAL_IN
+  if (workPending) {
+    if (adcPending) Hal::adcTrigger();
+    interrupts();
+    return;
+  }
+
+  sleeps++;
+  bool ioIdle = Hal::uartTxIdle();
+#if defined(TWI_ASYNC)
+  ioIdle = ioIdle && Twi::isIdle();
+#endif  // TWI_ASYNC
+#if defined(SERIAL_IN)
+  ioIdle = ioIdle && !SerialController::isReceiving();
+#endif  // SERIAL_IN
+  if (adcPending && ioIdle) {
+    // The conversion starts on sleep entry; Timer0 and Timer1 stop until it is done.
+    Hal::sleep(Hal::SleepAdc);
+    accumulate(adcMs, adcUs, ADC_CONVERSION_US);
+    Hal::timer0Compensate(ADC_CONVERSION_US);
+    Clock::compensate(ADC_CONVERSION_US);
+    return;
+  }
+
+  // A byte still being sent would be cut off by stopping the I/O clock, one
+  // being received lost (and an I2C transfer stalled), so the conversion
+  // runs in idle sleep instead.
+  if (adcPending) Hal::adcTrigger();
+  uint32_t t0 = micros();
+  Hal::sleep(Hal::SleepIdle);
+  accumulate(idleMs, idleUs, (uint32_t)micros() - t0);
+}
+
+Stats stats() {
+  Stats st;
+  st.idleMs = idleMs;
+  st.adcMs = adcMs;
+  st.totalMs = (uint32_t)millis() - startMillis;
+  st.sleeps = sleeps;
+  return st;
+}
+
+void resetStats() {
+  startMillis = millis();
+  idleMs = idleUs = 0;
+  adcMs = adcUs = 0;
+  sleeps = 0;
+}
+
+}  // namespace Power
+
+#endif  // POWER_SAVE
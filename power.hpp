@@ -0,0 +1,55 @@
+/**
+ * @file power.hpp
+ * @brief Sleep between scheduled work and awake/asleep accounting.
+ *
+ * After each scheduler pass @ref Power::idle() puts the MCU to sleep unless
+ * work is already pending (received serial bytes, a read request or a
+ * finished ADC round). Idle sleep keeps all peripherals running; the next
+ * interrupt (at the latest the 1 ms Timer0 tick, otherwise Timer1, UART RX/TX
+ * or the ADC) wakes the CPU and the loop continues.
+ *
+ * With @ref ADC_NOISE_SLEEP the sampling conversions of @ref Adc are started
+ * by entering ADC noise-reduction sleep, which stops the CPU and I/O clock
+ * for the duration of the conversion. Timer0 and Timer1 stand still
+ * meanwhile; the lost time is added back to millis()
+ * (@ref Hal::timer0Compensate()) and to the wall clock
+ * (@ref Clock::compensate()). The UART receiver stops as well, so the sleep
+ * is skipped while serial input arrives (@ref SerialController::isReceiving()).
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Power
+ * @brief MCU sleep management.
+ */
+namespace Power {
+
+/**
+ * @brief Time accounting since boot or the last @ref resetStats().
+ */
+struct Stats {
+  uint32_t totalMs;     ///< elapsed time
+  uint32_t idleMs;      ///< time in idle sleep
+  uint32_t adcMs;       ///< time in ADC noise-reduction sleep
+  uint32_t sleeps;      ///< number of sleep entries
+};
+
+/**
+ * @brief Sleep until the next interrupt if no work is pending; call at the
+ * end of loop().
+ */
+void idle();
+
+/**
+ * @brief Current time accounting; awake time is total minus both sleeps.
+ */
+Stats stats();
+
+/**
+ * @brief Restart the time accounting.
+ */
+void resetStats();
+
+}  // namespace Power
@@ -0,0 +1,85 @@
+/**
+ * @file readrate.cpp
+ * @brief Implementation of the adaptive read interval.
+ */
+#include "readrate.hpp"
+#include "config.hpp"
+
+namespace ReadRate {
+
+/** Timer1 periods for @p seconds, rounded up. */
+constexpr uint16_t ticksFor(uint16_t seconds) {
+  return (uint16_t)((seconds + READ_INTERVAL_SECONDS - 1) / READ_INTERVAL_SECONDS);
+}
+
+static Settings current = {READ_TARGET_SECONDS, READ_MAX_SECONDS, READ_FAST_DELTA, READ_CALM_DELTA};
+/** Timer1 periods between two reads; written with interrupts off. */
+static volatile uint16_t intervalTicks = ticksFor(READ_TARGET_SECONDS);
+static volatile uint16_t tickCounter = 0;
+static uint8_t previous[NUM_SENSORS];
+static uint8_t calmReadings = 0;
+static uint32_t readCount = 0;
+
+static void setIntervalTicks(uint16_t ticks) {
+  noInterrupts();
+  intervalTicks = ticks;
+  interrupts();
+}
+
+bool tick() {
+  // a shortened interval fires on the next tick
+  if (++tickCounter < intervalTicks) return false;
+  tickCounter = 0;
+  return true;
+}
+
+void update(const Lib::SensorContext& ctx) {
+  uint8_t change = 0;
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    uint8_t d = ctx.values[s] > previous[s] ? ctx.values[s] - previous[s] : previous[s] - ctx.values[s];
+    if (d > change) change = d;
+    previous[s] = ctx.values[s];
+  }
+  if (readCount++ == 0) return;
+
+  noInterrupts();
+  uint16_t ticks = intervalTicks;
+  interrupts();
+  const uint16_t minTicks = ticksFor(current.minSeconds);
+  const uint16_t maxTicks = ticksFor(current.maxSeconds);
+  if (change >= current.fast) {
+    calmReadings = 0;
+    if (ticks != minTicks) setIntervalTicks(minTicks);
+  } else if (change <= current.calm) {
+    if (++calmReadings < READ_CALM_READINGS) return;
+    calmReadings = 0;
+    if (ticks < maxTicks) setIntervalTicks(ticks > maxTicks / 2 ? maxTicks : (uint16_t)(ticks * 2));
+  } else {
+    calmReadings = 0;
+  }
+}
+
+uint16_t intervalSeconds() {
+  noInterrupts();
+  uint16_t ticks = intervalTicks;
+  interrupts();
+  return (uint16_t)(ticks * READ_INTERVAL_SECONDS);
+}
+
+uint32_t readings() {
+  return readCount;
+}
+
+const Settings& settings() {
+  return current;
+}
+
+bool set(const Settings& s) {
+  if (s.minSeconds < 1 || s.minSeconds > s.maxSeconds || s.maxSeconds > MAX_SECONDS || s.calm >= s.fast) return false;
+  current = s;
+  calmReadings = 0;
+  setIntervalTicks(ticksFor(s.minSeconds));
+  return true;
+}
+
+}  // namespace ReadRate
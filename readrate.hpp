@@ -0,0 +1,80 @@
+/**
+ * @file readrate.hpp
+ * @brief Sensor read interval that adapts to how fast the readings change.
+ *
+ * The Timer1 interrupt counts base ticks of @ref READ_INTERVAL_SECONDS and
+ * requests a read every @ref ReadRate::intervalSeconds(). After each
+ * reading the largest change of any sensor since the previous reading
+ * decides the next interval:
+ *
+ * - a change of at least @c fast percent (watering) drops the interval to
+ *   the minimum at once, so the following ticks sample the jump;
+ * - @ref READ_CALM_READINGS readings in a row that changed by at most
+ *   @c calm percent (drying soil, sensor noise) double it, up to the
+ *   maximum.
+ *
+ * The change per reading is the slope times the interval, so a stable
+ * signal ends up at the longest interval whose step stays below @c calm,
+ * and linear interpolation between the readings stays within a few percent
+ * of the signal. With minimum and maximum equal (the default, both
+ * @ref READ_TARGET_SECONDS) the interval is fixed.
+ */
+#pragma once
+
+#include "lib.hpp"
+
+/**
+ * @namespace ReadRate
+ * @brief Runtime read interval and its adaptation.
+ */
+namespace ReadRate {
+
+/**
+ * @brief Limits and thresholds of the adaptation.
+ */
+struct Settings {
+  uint16_t minSeconds;
+  uint16_t maxSeconds;
+  uint8_t fast;  ///< change in percent that drops to the minimum
+  uint8_t calm;  ///< change in percent that counts as stable
+};
+
+/** Longest interval that can be set. */
+constexpr uint16_t MAX_SECONDS = 3600;
+
+/**
+ * @brief Count one Timer1 period; call from the Timer1 compare ISR.
+ * @return true if a read is due.
+ */
+bool tick();
+
+/**
+ * @brief Adapt the interval to the latest readings. Call after every
+ * published reading.
+ */
+void update(const Lib::SensorContext& ctx);
+
+/**
+ * @brief Current read interval in seconds.
+ */
+uint16_t intervalSeconds();
+
+/**
+ * @brief Readings passed to @ref update() since boot.
+ */
+uint32_t readings();
+
+/**
+ * @brief Current limits and thresholds.
+ */
+const Settings& settings();
+
+/**
+ * @brief Replace the limits and thresholds and restart at the minimum
+ * interval.
+ * @return false (and nothing changed) unless 1 <= minSeconds <= maxSeconds
+ *         <= @ref MAX_SECONDS and calm < fast.
+ */
+bool set(const Settings& s);
+
+}  // namespace ReadRate
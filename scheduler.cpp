@@ -0,0 +1,105 @@
+/**
+ * @file scheduler.cpp
+ * @brief Implementation of the cooperative task scheduler.
+ */
+#include "scheduler.hpp"
+#include "config.hpp"
+
+namespace Scheduler {
+
+/**
+ * @brief One task slot.
+ */
+struct Task {
+  const __FlashStringHelper* name;
+  TaskFn fn;
+  uint16_t periodMs;
+  uint16_t deadlineMs;
+  uint16_t budgetUs;
+  uint8_t priority;
+  uint32_t releaseUs;  ///< micros() at which the task is released next
+#if defined(LATENCY_STATS)
+  TaskStats stats;
+#endif  // LATENCY_STATS
+};
+
+/** Task table, sorted by descending priority. */
+static Task tasks[SCHED_MAX_TASKS];
+static uint8_t taskCount = 0;
+
+bool add(const __FlashStringHelper* name, TaskFn fn, uint16_t periodMs, uint16_t deadlineMs, uint16_t budgetUs,
+         uint8_t priority) {
+  if (taskCount >= SCHED_MAX_TASKS) return false;
+  // Insert behind all tasks of equal or higher priority (stable order).
+  uint8_t pos = taskCount;
+  while (pos > 0 && tasks[pos - 1].priority < priority) {
+    tasks[pos] = tasks[pos - 1];
+    pos--;
+  }
+  Task& t = tasks[pos];
+  t.name = name;
+  t.fn = fn;
+  t.periodMs = periodMs;
+  t.deadlineMs = deadlineMs;
+  t.budgetUs = budgetUs;
+  t.priority = priority;
+  t.releaseUs = micros();
+#if defined(LATENCY_STATS)
+  t.stats = TaskStats();
+#endif  // LATENCY_STATS
+  taskCount++;
+  return true;
+}
+
+void run() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    Task& t = tasks[i];
+    uint32_t start = micros();
+    if ((int32_t)(start - t.releaseUs) < 0) continue;  // not released yet
+
+#if defined(LATENCY_STATS)
+    uint32_t latency = start - t.releaseUs;
+    t.fn();
+    uint32_t took = (uint32_t)micros() - start;
+
+    TaskStats& st = t.stats;
+    st.runs++;
+    if (latency > st.worstLatencyUs) st.worstLatencyUs = latency;
+    if (took > st.worstRunUs) st.worstRunUs = took;
+    if (took > t.budgetUs && st.overruns < 0xFFFF) st.overruns++;
+    if (latency > (unsigned long)t.deadlineMs * 1000UL && st.deadlineMisses < 0xFFFF) st.deadlineMisses++;
+#else
+    t.fn();
+#endif  // LATENCY_STATS
+
+    if (t.periodMs == 0) {
+      t.releaseUs = start;  // latency then measures the gap between two runs
+    } else {
+      uint32_t periodUs = (uint32_t)t.periodMs * 1000UL;
+      t.releaseUs += periodUs;
+      // Fell behind by more than a period: drop the missed releases
+      // instead of running the task back to back.
+      if ((int32_t)((uint32_t)micros() - t.releaseUs) >= 0) t.releaseUs = start + periodUs;
+    }
+  }
+}
+
+uint8_t count() {
+  return taskCount;
+}
+
+const __FlashStringHelper* name(uint8_t index) {
+  return tasks[index].name;
+}
+
+#if defined(LATENCY_STATS)
+const TaskStats& stats(uint8_t index) {
+  return tasks[index].stats;
+}
+
+void resetStats() {
+  for (uint8_t i = 0; i < taskCount; i++) tasks[i].stats = TaskStats();
+}
+#endif  // LATENCY_STATS
+
+}  // namespace Scheduler
@@ -0,0 +1,82 @@
+/**
+ * @file scheduler.hpp
+ * @brief Cooperative, deadline-aware task scheduler for the main loop.
+ *
+ * Tasks live in a fixed table of @ref SCHED_MAX_TASKS slots (no heap) and
+ * are registered once from setup(). Every @ref Scheduler::run() pass starts
+ * each released task once, highest priority first. A task is released again
+ * @c periodMs after its previous release; a period of 0 releases it on every
+ * pass. Tasks must return quickly and keep their work within @c budgetUs.
+ *
+ * With @ref LATENCY_STATS the scheduler also records, for each task, budget
+ * overruns, deadline misses (started more than @c deadlineMs after release)
+ * and the worst start latency and run time, so a task that starves the
+ * others is easy to spot (see the TASKS serial command).
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Scheduler
+ * @brief Fixed-capacity cooperative scheduler.
+ */
+namespace Scheduler {
+
+/** Task entry point. */
+typedef void (*TaskFn)();
+
+#if defined(LATENCY_STATS)
+/**
+ * @brief Timing statistics of one task since boot (or the last reset).
+ */
+struct TaskStats {
+  uint32_t runs;            ///< completed runs
+  uint16_t overruns;        ///< runs that took longer than the budget (saturating)
+  uint16_t deadlineMisses;  ///< runs started after their deadline (saturating)
+  uint32_t worstLatencyUs;  ///< longest delay between release and start
+  uint32_t worstRunUs;      ///< longest run time
+};
+#endif  // LATENCY_STATS
+
+/**
+ * @brief Register a task; call from setup().
+ * @param name Flash-stored name for reports.
+ * @param fn Task function.
+ * @param periodMs Release period, 0 to run on every pass.
+ * @param deadlineMs Maximum tolerated delay from release to start.
+ * @param budgetUs Expected worst-case run time (at most 65535 us).
+ * @param priority Higher values run earlier within a pass.
+ * @return false if all @ref SCHED_MAX_TASKS slots are taken.
+ */
+bool add(const __FlashStringHelper* name, TaskFn fn, uint16_t periodMs, uint16_t deadlineMs, uint16_t budgetUs,
+         uint8_t priority);
+
+/**
+ * @brief Run one scheduling pass; call from loop().
+ */
+void run();
+
+/**
+ * @brief Number of registered tasks. Task indices are in priority order.
+ */
+uint8_t count();
+
+/**
+ * @brief Name of task @p index.
+ */
+const __FlashStringHelper* name(uint8_t index);
+
+#if defined(LATENCY_STATS)
+/**
+ * @brief Statistics of task @p index.
+ */
+const TaskStats& stats(uint8_t index);
+
+/**
+ * @brief Clear the statistics of all tasks.
+ */
+void resetStats();
+#endif  // LATENCY_STATS
+
+}  // namespace Scheduler
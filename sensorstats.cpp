@@ -0,0 +1,149 @@
+/**
+ * @file sensorstats.cpp
+ * @brief Implementation of the streaming per-sensor statistics.
+ */
+#include "sensorstats.hpp"
+#include "clock.hpp"
+#include "config.hpp"
+
+#if defined(SENSOR_STATS)
+
+namespace SensorStats {
+
+static_assert(SENSOR_STATS_EMA_SHIFT >= 1 && SENSOR_STATS_EMA_SHIFT <= 8, "SENSOR_STATS_EMA_SHIFT must be 1-8");
+
+/**
+ * @brief Welford state and moving average of one sensor.
+ */
+struct Moments {
+  uint16_t count;
+  int32_t mean;  ///< in 1/65536
+  uint32_t m2;   ///< sum of squared deviations in 1/256
+  int16_t ema;   ///< in 1/256
+};
+
+/**
+ * @brief Minimum and maximum of the readings in one bucket.
+ */
+struct Extremes {
+  uint8_t min;
+  uint8_t max;
+};
+
+/**
+ * @brief A ring of buckets of @c step seconds, shared by all sensors.
+ */
+struct Ring {
+  uint32_t bucket;  ///< bucket number of the head
+  uint8_t head;
+  bool started;
+};
+
+constexpr uint16_t HOUR_STEP = 600;
+constexpr uint8_t HOUR_BUCKETS = 3600 / HOUR_STEP + 1;
+constexpr uint16_t DAY_STEP = 7200;
+constexpr uint8_t DAY_BUCKETS = 86400UL / DAY_STEP + 1;
+
+static Moments moments[NUM_SENSORS];
+static Extremes hourBuckets[NUM_SENSORS][HOUR_BUCKETS];
+static Extremes dayBuckets[NUM_SENSORS][DAY_BUCKETS];
+static Ring hourRing;
+static Ring dayRing;
+
+static void clearBucket(Extremes* buckets, uint8_t count, uint8_t index) {
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    buckets[s * count + index].min = EMPTY_MIN;
+    buckets[s * count + index].max = 0;
+  }
+}
+
+/**
+ * @brief Move the head of @p ring to the bucket of @p now, emptying the
+ * buckets passed on the way. A clock set back starts the ring over.
+ */
+static void advance(Ring& ring, Extremes* buckets, uint8_t count, uint16_t step, uint32_t now) {
+  uint32_t bucket = now / step;
+  uint32_t skipped = bucket - ring.bucket;  // wraps if the clock went back
+  if (!ring.started || skipped >= count) {
+    for (uint8_t i = 0; i < count; i++) clearBucket(buckets, count, i);
+    ring.head = 0;
+    ring.started = true;
+  } else {
+    for (; skipped; skipped--) {
+      ring.head = ring.head + 1 < count ? ring.head + 1 : 0;
+      clearBucket(buckets, count, ring.head);
+    }
+  }
+  ring.bucket = bucket;
+}
+
+static void update(Extremes& e, uint8_t value) {
+  if (value < e.min) e.min = value;
+  if (value > e.max) e.max = value;
+}
+
+void record(const Lib::SensorContext& ctx) {
+  const uint32_t now = Clock::seconds();
+  advance(hourRing, &hourBuckets[0][0], HOUR_BUCKETS, HOUR_STEP, now);
+  advance(dayRing, &dayBuckets[0][0], DAY_BUCKETS, DAY_STEP, now);
+
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    const uint8_t value = ctx.values[s];
+    Moments& m = moments[s];
+    if (m.count == 0) {
+      m.ema = (int16_t)(value << 8);
+    } else {
+      m.ema += (int16_t)((int16_t)(value << 8) - m.ema + (1 << (SENSOR_STATS_EMA_SHIFT - 1))) >> SENSOR_STATS_EMA_SHIFT;
+    }
+    if (m.count == MAX_COUNT) {
+      m.count >>= 1;
+      m.m2 >>= 1;
+    }
+    m.count++;
+    const int32_t x = (int32_t)value << 16;
+    const int32_t delta = x - m.mean;
+    m.mean += delta / m.count;
+    // both differences have the same sign; their product in 1/256 fits 32 bit
+    m.m2 += (uint32_t)(((delta >> 8) * ((x - m.mean) >> 8)) >> 8);
+
+    update(hourBuckets[s][hourRing.head], value);
+    update(dayBuckets[s][dayRing.head], value);
+  }
+}
+
+/**
+ * @brief Combine @p count buckets into @p min and @p max.
+ */
+static void extremes(const Extremes* buckets, uint8_t count, uint8_t& min, uint8_t& max) {
+  min = EMPTY_MIN;
+  max = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (buckets[i].min < min) min = buckets[i].min;
+    if (buckets[i].max > max) max = buckets[i].max;
+  }
+}
+
+Summary summary(uint8_t sensor) {
+  Summary out;
+  const Moments& m = moments[sensor];
+  out.count = m.count;
+  out.mean = (uint16_t)(m.mean >> 8);
+  out.variance = m.count > 1 ? m.m2 / (m.count - 1) : 0;
+  out.ema = (uint16_t)m.ema;
+  out.hourMin = out.dayMin = EMPTY_MIN;
+  out.hourMax = out.dayMax = 0;
+  if (hourRing.started) extremes(hourBuckets[sensor], HOUR_BUCKETS, out.hourMin, out.hourMax);
+  if (dayRing.started) extremes(dayBuckets[sensor], DAY_BUCKETS, out.dayMin, out.dayMax);
+  return out;
+}
+
+void reset() {
+  memset(moments, 0, sizeof(moments));
+  // the buckets are emptied by the next record()
+  hourRing.started = false;
+  dayRing.started = false;
+}
+
+}  // namespace SensorStats
+
+#endif  // SENSOR_STATS
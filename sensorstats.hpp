@@ -0,0 +1,71 @@
+/**
+ * @file sensorstats.hpp
+ * @brief Streaming per-sensor statistics of the readings.
+ *
+ * Every published reading updates, per sensor and in O(1) fixed point:
+ *
+ * - mean and variance by Welford's method (mean in 1/65536, sum of squared
+ *   deviations in 1/256 percent²). To keep the sum in 32 bit, count and sum
+ *   are halved when the count reaches @ref SensorStats::MAX_COUNT, so older
+ *   readings fade out with half weight instead of overflowing;
+ * - an exponential moving average with alpha = 2^-@ref SENSOR_STATS_EMA_SHIFT;
+ * - minimum and maximum over the last hour and the last 24 hours.
+ *
+ * The windows are rings of buckets that each hold the minimum and maximum
+ * of their span of @ref Clock::seconds(): 10-minute buckets for the hour
+ * and 2-hour buckets for the day. A window covers its length plus the
+ * bucket being filled (60–70 min, 24–26 h). Buckets the clock skips over
+ * are emptied when the next reading arrives, so a query only combines the
+ * buckets of one ring.
+ */
+#pragma once
+
+#include "lib.hpp"
+
+#if defined(SENSOR_STATS)
+
+/**
+ * @namespace SensorStats
+ * @brief Mean, variance, moving average and windowed extremes per sensor.
+ */
+namespace SensorStats {
+
+/** Count at which the Welford state is halved. */
+constexpr uint16_t MAX_COUNT = 4096;
+
+/** Minimum of a window without readings; its maximum is 0. */
+constexpr uint8_t EMPTY_MIN = 0xFF;
+
+/**
+ * @brief Statistics of one sensor, in percent.
+ */
+struct Summary {
+  uint16_t count;     ///< readings in the Welford state (at most @ref MAX_COUNT)
+  uint16_t mean;      ///< mean in 1/256
+  uint32_t variance;  ///< sample variance in 1/256 percent²
+  uint16_t ema;       ///< moving average in 1/256
+  uint8_t hourMin;    ///< @ref EMPTY_MIN if no reading in the window
+  uint8_t hourMax;
+  uint8_t dayMin;
+  uint8_t dayMax;
+};
+
+/**
+ * @brief Feed the latest readings. Call after every published reading from
+ * the main loop.
+ */
+void record(const Lib::SensorContext& ctx);
+
+/**
+ * @brief Current statistics of @p sensor.
+ */
+Summary summary(uint8_t sensor);
+
+/**
+ * @brief Forget all readings.
+ */
+void reset();
+
+}  // namespace SensorStats
+
+#endif  // SENSOR_STATS
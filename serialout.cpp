@@ -0,0 +1,212 @@
+/**
+ * @file serialout.cpp
+ * @brief Implementation of the buffered serial output.
+ */
+#include "serialout.hpp"
+#include "config.hpp"
+
+#if defined(SERIAL_OUT)
+
+namespace SerialOut {
+
+/**
+ * Room a message needs to start: it is admitted as a whole when it starts
+ * and not cut later, so leave space for a typical line of several pieces.
+ * A longer line that is admitted waits for the UART to finish it.
+ */
+constexpr uint8_t LINE_ROOM = 32;
+
+static_assert(SERIAL_OUT_RESERVE + LINE_ROOM <= SERIAL_OUT_BUFFER, "SERIAL_OUT_BUFFER too small for SERIAL_OUT_RESERVE");
+
+/** "00".."99": two digits per division by 100. */
+static const char DIGIT_PAIRS[201] PROGMEM =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static uint8_t ring[SERIAL_OUT_BUFFER];
+static uint8_t head = 0;  // next byte to fill
+static uint8_t tail = 0;  // next byte for the UART
+static uint8_t used = 0;
+/** Per priority: the current message is being dropped. */
+static bool dropping[Reply + 1];
+/** Per priority: part of the current message was queued. */
+static bool started[Reply + 1];
+static Stats counters = {};
+
+static uint8_t uartRoom() {
+  int n = Serial.availableForWrite();
+  return n > 0 ? (uint8_t)n : 0;
+}
+
+void service() {
+  while (used) {
+    uint8_t n = uartRoom();
+    if (!n) return;
+    if (n > used) n = used;
+    if (n > SERIAL_OUT_BUFFER - tail) n = SERIAL_OUT_BUFFER - tail;
+    Serial.write(&ring[tail], n);
+    tail = (uint8_t)(tail + n) >= SERIAL_OUT_BUFFER ? 0 : tail + n;
+    used -= n;
+  }
+}
+
+/** Wait until the UART has taken at least one byte of a full ring. */
+static void waitForRoom() {
+  uint32_t t0 = micros();
+  for (;;) {
+    service();
+    if (used < SERIAL_OUT_BUFFER) break;
+    Hal::spinWait();
+  }
+  counters.stallUs += (uint32_t)micros() - t0;
+}
+
+/**
+ * @brief Apply the priority policy to @p len bytes of a message. The
+ * decision is taken at the first bytes; the rest of the message follows it.
+ * @return false if they are dropped.
+ */
+static bool admit(uint16_t len, Priority priority) {
+  if (dropping[priority]) {
+    counters.dropped += len;
+    return false;
+  }
+  if (priority != Reply && !started[priority]) {
+    service();
+    uint16_t room = (SERIAL_OUT_BUFFER - used) + (used ? 0 : uartRoom());
+    uint16_t need = (len > LINE_ROOM ? len : LINE_ROOM) + (priority == Debug ? SERIAL_OUT_RESERVE : 0);
+    if (need > room) {
+      dropping[priority] = true;
+      counters.dropped += len;
+      return false;
+    }
+  }
+  started[priority] = true;
+  return true;
+}
+
+/** Queue @p len bytes from RAM or (@p flash) program memory. */
+static void put(const uint8_t* data, uint16_t len, bool flash, Priority priority) {
+  if (!len || !admit(len, priority)) return;
+  counters.bytes += len;
+
+  // fast path: nothing queued and the UART has room
+  if (!used && !flash && uartRoom() >= len) {
+    Serial.write(data, len);
+    return;
+  }
+  uint16_t left = len;
+  while (left) {
+    if (used == SERIAL_OUT_BUFFER) {
+      service();
+      if (used == SERIAL_OUT_BUFFER) waitForRoom();
+    }
+    uint8_t n = SERIAL_OUT_BUFFER - used;
+    if (n > left) n = (uint8_t)left;
+    if (n > SERIAL_OUT_BUFFER - head) n = SERIAL_OUT_BUFFER - head;
+    if (flash) memcpy_P(&ring[head], data, n);
+    else memcpy(&ring[head], data, n);
+    head = (uint8_t)(head + n) >= SERIAL_OUT_BUFFER ? 0 : head + n;
+    used += n;
+    data += n;
+    left -= n;
+  }
+  service();
+  counters.deferred += used < len ? used : len;
+  if (used > counters.peak) counters.peak = used;
+}
+
+void write(const uint8_t* data, uint8_t len, Priority priority) {
+  put(data, len, false, priority);
+}
+
+void print(const __FlashStringHelper* s, Priority priority) {
+  put(reinterpret_cast<const uint8_t*>(s), strlen_P((PGM_P)s), true, priority);
+}
+
+void print(const char* s, Priority priority) {
+  put(reinterpret_cast<const uint8_t*>(s), strlen(s), false, priority);
+}
+
+void print(char c, Priority priority) {
+  put(reinterpret_cast<const uint8_t*>(&c), 1, false, priority);
+}
+
+uint8_t formatUnsigned(unsigned long value, char* end) {
+  char* p = end;
+  // 32-bit divisions only while the value needs them
+  while (value > 0xFFFFUL) {
+    unsigned long q = value / 100;
+    uint8_t r = (uint8_t)(value - q * 100);
+    p -= 2;
+    memcpy_P(p, &DIGIT_PAIRS[2 * r], 2);
+    value = q;
+  }
+  uint16_t v = (uint16_t)value;
+  while (v >= 100) {
+    uint16_t q = v / 100;
+    uint8_t r = (uint8_t)(v - q * 100);
+    p -= 2;
+    memcpy_P(p, &DIGIT_PAIRS[2 * r], 2);
+    v = q;
+  }
+  if (v >= 10) {
+    p -= 2;
+    memcpy_P(p, &DIGIT_PAIRS[2 * v], 2);
+  } else {
+    *--p = (char)('0' + v);
+  }
+  return (uint8_t)(end - p);
+}
+
+void print(unsigned long value, Priority priority) {
+  char buf[20];
+  uint8_t n = formatUnsigned(value, buf + sizeof(buf));
+  put(reinterpret_cast<const uint8_t*>(buf + sizeof(buf) - n), n, false, priority);
+}
+
+void print(long value, Priority priority) {
+  char buf[21];
+  unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+  uint8_t n = formatUnsigned(magnitude, buf + sizeof(buf));
+  if (value < 0) buf[sizeof(buf) - ++n] = '-';
+  put(reinterpret_cast<const uint8_t*>(buf + sizeof(buf) - n), n, false, priority);
+}
+
+static char hexDigit(uint8_t nibble) {
+  return (char)(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
+}
+
+void printHex(uint8_t value, Priority priority) {
+  char buf[2];
+  uint8_t n = 0;
+  if (value >> 4) buf[n++] = hexDigit(value >> 4);
+  buf[n++] = hexDigit(value & 0x0F);
+  put(reinterpret_cast<const uint8_t*>(buf), n, false, priority);
+}
+
+void end(Priority priority) {
+  dropping[priority] = false;
+  started[priority] = false;
+}
+
+void endLine(Priority priority) {
+  static const uint8_t CRLF[2] = { '\r', '\n' };
+  put(CRLF, 2, false, priority);
+  end(priority);
+}
+
+bool isIdle() {
+  return used == 0;
+}
+
+const Stats& stats() {
+  return counters;
+}
+
+}  // namespace SerialOut
+
+#endif  // SERIAL_OUT
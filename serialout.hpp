@@ -0,0 +1,118 @@
+/**
+ * @file serialout.hpp
+ * @brief Buffered, non-blocking serial output with priorities.
+ *
+ * Serial.print() blocks whenever the 64-byte UART buffer of the core is
+ * full, so a burst of debug, log and plotter lines used to stall the loop
+ * for milliseconds. All firmware output now goes through a
+ * @ref SERIAL_OUT_BUFFER byte ring that is moved into the UART as it frees
+ * up (@ref SerialOut::service(), also called on every write). Numbers are
+ * formatted with a two-digit table instead of the core's digit-by-digit
+ * division.
+ *
+ * When the ring runs full, the priority of the output decides whether a
+ * message (a line, or a frame ended with @ref SerialOut::end()) is sent:
+ *
+ * - @ref SerialOut::Debug is dropped first: it only starts while
+ *   @ref SERIAL_OUT_RESERVE bytes stay free for the others.
+ * - @ref SerialOut::Data (readings, telemetry frames) is dropped when a
+ *   line does not fit.
+ * - @ref SerialOut::Reply (command replies, boot messages) is never dropped;
+ *   the caller waits for room, as it did with Serial.print().
+ *
+ * The decision is taken when a message starts, so no partial line or frame
+ * is sent: a dropped message is dropped up to its end, and a started one is
+ * completed even if that means waiting.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+#if defined(SERIAL_OUT)
+
+/**
+ * @namespace SerialOut
+ * @brief Priority-aware serial output ring.
+ */
+namespace SerialOut {
+
+/**
+ * @brief Output priority, lowest first.
+ */
+enum Priority : uint8_t {
+  Debug,  ///< diagnostics; dropped while the ring is short of room
+  Data,   ///< readings and telemetry; dropped when the ring is full
+  Reply   ///< command replies; waits for room
+};
+
+/**
+ * @brief Output statistics since boot.
+ */
+struct Stats {
+  uint32_t bytes;     ///< bytes accepted
+  uint32_t deferred;  ///< accepted bytes that had to wait in the ring
+  uint32_t dropped;   ///< bytes dropped by the priority policy
+  uint32_t stallUs;   ///< time replies waited for room
+  uint8_t peak;       ///< highest ring fill in bytes
+};
+
+/**
+ * @brief Queue @p len raw bytes.
+ */
+void write(const uint8_t* data, uint8_t len, Priority priority);
+
+void print(const __FlashStringHelper* s, Priority priority);
+void print(const char* s, Priority priority);
+void print(char c, Priority priority);
+void print(long value, Priority priority);
+void print(unsigned long value, Priority priority);
+
+inline void print(unsigned char value, Priority priority) {
+  print((unsigned long)value, priority);
+}
+inline void print(int value, Priority priority) {
+  print((long)value, priority);
+}
+inline void print(unsigned int value, Priority priority) {
+  print((unsigned long)value, priority);
+}
+
+/**
+ * @brief Print @p value in upper-case hex without leading zeros.
+ */
+void printHex(uint8_t value, Priority priority);
+
+/**
+ * @brief End a message that is not a text line (e.g. a telemetry frame).
+ */
+void end(Priority priority);
+
+/**
+ * @brief Terminate the line with CR LF and end the message.
+ */
+void endLine(Priority priority);
+
+/**
+ * @brief Move queued bytes into the UART as far as it has room; never waits.
+ */
+void service();
+
+/**
+ * @brief Query whether nothing is waiting in the ring.
+ */
+bool isIdle();
+
+/**
+ * @brief Access the output statistics.
+ */
+const Stats& stats();
+
+/**
+ * @brief Format @p value as decimal digits ending at @p end (exclusive).
+ * @return Number of characters written before @p end.
+ */
+uint8_t formatUnsigned(unsigned long value, char* end);
+
+}  // namespace SerialOut
+
+#endif  // SERIAL_OUT
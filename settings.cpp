@@ -0,0 +1,196 @@
+/**
+ * @file settings.cpp
+ * @brief Implementation of the runtime configuration record.
+ */
+#include "settings.hpp"
+#include "config.hpp"
+#include "crc.hpp"
+#include "lib.hpp"
+#include "nvm.hpp"
+#include "view.hpp"
+
+namespace Settings {
+
+constexpr uint16_t MAGIC = 0x4350;  // "PC" in EEPROM
+
+/**
+ * @brief The record as it is stored; @c values is also the copy in use.
+ */
+struct Record {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t length;  ///< sizeof(Record), so a different sensor count does not match
+  Values values;
+  uint16_t crc;
+};
+
+static_assert(sizeof(Record) <= 0xFF, "Settings record too large for its length byte");
+static_assert(SETTINGS_EEPROM_START + sizeof(Record) <= LOG_EEPROM_START,
+              "Settings record overlaps the reading log; raise LOG_EEPROM_START");
+static_assert(AVERAGE_OF >= 1 && AVERAGE_OF <= MAX_AVERAGE_OF, "AVERAGE_OF must be 1-64");
+
+/** Bytes handed to Nvm per write() call. */
+constexpr uint8_t SAVE_CHUNK = 16;
+
+static Record record;
+static Source loadedFrom = Defaults;
+/** The EEPROM holds a valid record with @ref storedCrc. */
+static bool stored = false;
+static uint16_t storedCrc = 0;
+static bool saving = false;
+static uint8_t saveOffset = 0;
+
+static uint16_t checksum() {
+  return Crc::crc16((const uint8_t*)&record, offsetof(Record, crc));
+}
+
+/** Copy the state kept by other modules into the record. */
+static void capture() {
+  Values& v = record.values;
+  v.contrast = View::displayContrast();
+  v.rate = ReadRate::settings();
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) v.calPoints[s] = Calibration::points(s, v.cal[s]);
+  record.magic = MAGIC;
+  record.version = VERSION;
+  record.length = sizeof(Record);
+  record.crc = checksum();
+}
+
+/** Hand the record's state to the modules that keep it. */
+static void apply() {
+  const Values& v = record.values;
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    if (!Calibration::load(s, v.cal[s], v.calPoints[s])) Calibration::loadDefault(s);
+  }
+  ReadRate::set(v.rate);
+  View::setDisplayContrast(v.contrast);
+  View::namesChanged();
+}
+
+static bool isPrintable(char c) {
+  return c >= ' ' && c <= '~';
+}
+
+void begin() {
+  uint8_t* bytes = (uint8_t*)&record;
+  for (uint8_t i = 0; i < sizeof(Record); i++) bytes[i] = EEPROM.read(SETTINGS_EEPROM_START + i);
+  stored = record.magic == MAGIC && record.version == VERSION && record.length == sizeof(Record)
+           && record.crc == checksum();
+  if (!stored) {
+    loadDefaults();
+    return;
+  }
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) record.values.names[s][SENSOR_NAME_LENGTH - 1] = '\0';
+  if (record.values.averageOf < 1 || record.values.averageOf > MAX_AVERAGE_OF) record.values.averageOf = AVERAGE_OF;
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    if (record.values.filter[s] >= Filter::MODES) record.values.filter[s] = FILTER_DEFAULT_MODE;
+  }
+  storedCrc = record.crc;
+  loadedFrom = Stored;
+  apply();
+}
+
+const Values& values() {
+  return record.values;
+}
+
+Source source() {
+  return loadedFrom;
+}
+
+bool setName(uint8_t sensor, const char* name) {
+  size_t len = strlen(name);
+  if (saving || sensor >= NUM_SENSORS || len < 1 || len >= SENSOR_NAME_LENGTH) return false;
+  for (size_t i = 0; i < len; i++) {
+    if (!isPrintable(name[i])) return false;
+  }
+  memcpy(record.values.names[sensor], name, len + 1);
+  View::namesChanged();
+  return true;
+}
+
+bool setAverageOf(uint8_t n) {
+  if (saving || averageOfFixed() || n < 1 || n > MAX_AVERAGE_OF) return false;
+  record.values.averageOf = n;
+  return true;
+}
+
+bool averageOfFixed() {
+#if defined(SAMPLE_FILTER) || (defined(ADC_ASYNC) && defined(ADC_OVERSAMPLE))
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint8_t samplesPerReading() {
+#if defined(SAMPLE_FILTER)
+  return FILTER_SAMPLES;
+#elif defined(ADC_ASYNC) && defined(ADC_OVERSAMPLE)
+  return 1 << (2 * ADC_OVERSAMPLE_LOG4);
+#else
+  return record.values.averageOf;
+#endif
+}
+
+bool setFilter(uint8_t sensor, Filter::Mode mode) {
+  if (saving || sensor >= NUM_SENSORS || mode >= Filter::MODES) return false;
+  record.values.filter[sensor] = mode;
+  return true;
+}
+
+bool loadDefaults() {
+  if (saving) return false;
+  Values& v = record.values;
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    strncpy_P(v.names[s], (PGM_P)Lib::defaultSensorName(s), SENSOR_NAME_LENGTH);
+    v.names[s][SENSOR_NAME_LENGTH - 1] = '\0';
+    Calibration::loadDefault(s);
+    v.filter[s] = FILTER_DEFAULT_MODE;
+  }
+  v.averageOf = AVERAGE_OF;
+  v.contrast = DISP_CONTRAST;
+  v.rate = ReadRate::Settings{READ_TARGET_SECONDS, READ_MAX_SECONDS, READ_FAST_DELTA, READ_CALM_DELTA};
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) v.calPoints[s] = Calibration::points(s, v.cal[s]);
+  apply();
+  return true;
+}
+
+bool save() {
+  if (saving) return false;
+  capture();
+  saving = true;
+  saveOffset = 0;
+  service();
+  return true;
+}
+
+void service() {
+  if (!saving) return;
+  const uint8_t* bytes = (const uint8_t*)&record;
+  while (saveOffset < sizeof(Record)) {
+    uint8_t n = sizeof(Record) - saveOffset < SAVE_CHUNK ? sizeof(Record) - saveOffset : SAVE_CHUNK;
+    if (!Nvm::write(SETTINGS_EEPROM_START + saveOffset, bytes + saveOffset, n)) return;  // queue full, next pass
+    saveOffset += n;
+  }
+  if (!Nvm::isIdle()) return;  // the last bytes are still being written
+  saving = false;
+  stored = true;
+  storedCrc = record.crc;
+}
+
+bool isSaving() {
+  return saving;
+}
+
+bool isSaved() {
+  if (saving) return false;
+  capture();
+  return stored && record.crc == storedCrc;
+}
+
+uint8_t recordBytes() {
+  return sizeof(Record);
+}
+
+}  // namespace Settings
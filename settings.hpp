@@ -0,0 +1,147 @@
+/**
+ * @file settings.hpp
+ * @brief Runtime configuration, persisted as one versioned, CRC-checked
+ * record in EEPROM.
+ *
+ * The values in @ref config.hpp are the compile-time defaults. At boot the
+ * record at @ref SETTINGS_EEPROM_START is read once into SRAM; if its
+ * magic, version, length or CRC-16 does not match, the defaults are used.
+ * The hot paths (sensor names, samples per reading) read the SRAM copy only.
+ * Contrast, read rate and calibration are handed to their modules, which
+ * keep changing them at runtime (CONTRAST, RATE, CAL); @ref save() collects
+ * their current state into the record.
+ *
+ * Saving never stalls the loop: @ref service() hands the record to
+ * @ref Nvm in chunks as its staging queue has room, and @ref Nvm writes one
+ * byte per pass and skips the bytes that did not change. A reset in the
+ * middle of a save leaves a record with a bad CRC, so the next boot starts
+ * with the defaults rather than a mix.
+ *
+ * Record layout (little endian): magic (2), version (1), length of the
+ * whole record (1), the @ref Settings::Values, CRC-16/CCITT-FALSE over all
+ * preceding bytes (2).
+ */
+#pragma once
+
+#include "calibration.hpp"
+#include "filter.hpp"
+#include "readrate.hpp"
+
+/**
+ * @namespace Settings
+ * @brief Runtime configuration and its EEPROM record.
+ */
+namespace Settings {
+
+/** Layout version of the record; a record of another version is ignored. */
+constexpr uint8_t VERSION = 2;
+
+/** Most samples per reading (their sum must fit 16 bit). */
+constexpr uint8_t MAX_AVERAGE_OF = 64;
+
+/**
+ * @brief Everything that can be configured at runtime.
+ */
+struct Values {
+  char names[NUM_SENSORS][SENSOR_NAME_LENGTH];  ///< zero-terminated
+  uint8_t averageOf;  ///< samples per sensor and reading without @ref ADC_OVERSAMPLE or @ref SAMPLE_FILTER
+  uint8_t contrast;
+  ReadRate::Settings rate;
+  uint8_t calPoints[NUM_SENSORS];  ///< points used in @c cal
+  Calibration::Point cal[NUM_SENSORS][CAL_MAX_POINTS];
+  uint8_t filter[NUM_SENSORS];  ///< @ref Filter::Mode per sensor, used with @ref SAMPLE_FILTER
+};
+
+/**
+ * @brief Where the values in use came from at boot.
+ */
+enum Source : uint8_t {
+  Defaults,  ///< no valid record; compile-time defaults
+  Stored     ///< the EEPROM record
+};
+
+/**
+ * @brief Read the record (or take the defaults) and apply it. Call once
+ * from setup() after @ref Lib::initCtx() and before the display is set up.
+ */
+void begin();
+
+/**
+ * @brief The values in use.
+ */
+const Values& values();
+
+/**
+ * @brief Where the values came from at boot.
+ */
+Source source();
+
+/**
+ * @brief Rename @p sensor.
+ * @return false unless @p name has 1 to @ref SENSOR_NAME_LENGTH - 1
+ *         printable characters, or while a save is in progress.
+ */
+bool setName(uint8_t sensor, const char* name);
+
+/**
+ * @brief Set the samples per sensor and reading.
+ * @return false unless 1 <= @p n <= @ref MAX_AVERAGE_OF, while a save is
+ *         in progress, or if the build fixes the count
+ *         (@ref averageOfFixed()).
+ */
+bool setAverageOf(uint8_t n);
+
+/**
+ * @brief True if the build takes a fixed number of samples per reading, so
+ * the configured count is not used: @ref SAMPLE_FILTER, or
+ * @ref ADC_OVERSAMPLE in the @ref ADC_ASYNC engine.
+ */
+bool averageOfFixed();
+
+/**
+ * @brief Samples per sensor and reading actually taken by the regular
+ * sampling path.
+ */
+uint8_t samplesPerReading();
+
+/**
+ * @brief Select the filter of @p sensor.
+ * @return false for an invalid sensor or mode, or while a save is in
+ *         progress.
+ */
+bool setFilter(uint8_t sensor, Filter::Mode mode);
+
+/**
+ * @brief Return to the compile-time defaults (not saved).
+ * @return false while a save is in progress.
+ */
+bool loadDefaults();
+
+/**
+ * @brief Collect the current values and start writing the record.
+ * @return false if a save is already in progress.
+ */
+bool save();
+
+/**
+ * @brief Queue the next chunks of a save with @ref Nvm; call from the main
+ * loop before @ref Nvm::service().
+ */
+void service();
+
+/**
+ * @brief True while a save is being handed to @ref Nvm or written.
+ */
+bool isSaving();
+
+/**
+ * @brief True if the values in use match the record in EEPROM.
+ */
+bool isSaved();
+
+/**
+ * @brief Size of the record in EEPROM in bytes.
+ */
+uint8_t recordBytes();
+
+}  // namespace Settings
@@ -0,0 +1,136 @@
+/**
+ * @file snapshot.cpp
+ * @brief Implementation of the .noinit warm-restart snapshot.
+ */
+#include "snapshot.hpp"
+#include "boot.hpp"
+#include "calibration.hpp"
+#include "clock.hpp"
+#include "config.hpp"
+#include "crc.hpp"
+#include "history.hpp"
+#include "lib.hpp"
+#include "readrate.hpp"
+#include "telemetry.hpp"
+#include "view.hpp"
+
+#if defined(WARM_RESTART)
+
+namespace Snapshot {
+
+/**
+ * @brief Everything restored after a warm reset except the clock.
+ */
+struct Image {
+  uint16_t magic;
+  uint8_t values[NUM_SENSORS];
+  bool displayOn;
+  uint8_t contrast;
+  uint8_t telemetryMode;
+  ReadRate::Settings rate;
+  uint8_t calPoints[NUM_SENSORS];
+  Calibration::Point cal[NUM_SENSORS][CAL_MAX_POINTS];
+#if defined(HISTORY)
+  History::State history;
+  uint16_t historyCrc;  ///< over the history blocks in use
+#endif  // HISTORY
+  uint16_t crc;  ///< over the fields from @c values on
+};
+
+/** Changes with the layout, so a firmware with another one starts cold. */
+constexpr uint16_t MAGIC = 0x5A17 ^ (uint16_t)sizeof(Image);
+
+NOINIT static Image image;
+/** Seconds of the last Timer1 tick and their complement. */
+NOINIT static volatile uint32_t clockSeconds;
+NOINIT static volatile uint32_t clockCheck;
+
+static bool wasRestored = false;
+
+static uint16_t checksum(const Image& img) {
+  const uint8_t* from = (const uint8_t*)&img + offsetof(Image, values);
+  return Crc::crc16(from, offsetof(Image, crc) - offsetof(Image, values));
+}
+
+/**
+ * @brief Copy @p size bytes from @p from into the image field @p field if
+ * they differ.
+ * @return true if they did.
+ */
+static bool update(void* field, const void* from, size_t size) {
+  if (memcmp(field, from, size) == 0) return false;
+  image.magic = 0;  // a reset in the middle leaves it invalid
+  memcpy(field, from, size);
+  return true;
+}
+
+void tick() {
+  uint32_t s = Clock::tickSeconds();
+  clockSeconds = s;
+  clockCheck = ~s;
+}
+
+void save() {
+  bool changed = update(image.values, Lib::ctx.values, NUM_SENSORS);
+  const bool displayOn = View::isDisplayEnabled();
+  changed |= update(&image.displayOn, &displayOn, sizeof(displayOn));
+  const uint8_t contrast = View::displayContrast();
+  changed |= update(&image.contrast, &contrast, sizeof(contrast));
+#if defined(TELEMETRY_BINARY)
+  const uint8_t telemetryMode = Telemetry::mode();
+  changed |= update(&image.telemetryMode, &telemetryMode, sizeof(telemetryMode));
+#endif  // TELEMETRY_BINARY
+  const ReadRate::Settings rate = ReadRate::settings();
+  changed |= update(&image.rate, &rate, sizeof(rate));
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    Calibration::Point cal[CAL_MAX_POINTS];
+    const uint8_t points = Calibration::points(s, cal);
+    changed |= update(&image.calPoints[s], &points, sizeof(points));
+    changed |= update(image.cal[s], cal, points * sizeof(cal[0]));
+  }
+#if defined(HISTORY)
+  History::State history = {};
+  History::saveState(history);
+  changed |= update(&image.history, &history, sizeof(history));
+  const uint16_t historyCrc = History::crc();
+  changed |= update(&image.historyCrc, &historyCrc, sizeof(historyCrc));
+#endif  // HISTORY
+  if (!changed && image.magic == MAGIC) return;
+  image.crc = checksum(image);
+  image.magic = MAGIC;
+}
+
+bool restore() {
+  const uint8_t flags = Boot::resetFlags();
+  if (!(flags & ((1 << WDRF) | (1 << EXTRF))) || (flags & ((1 << PORF) | (1 << BORF)))) return false;
+  if (image.magic != MAGIC || image.crc != checksum(image)) return false;
+#if defined(HISTORY)
+  if (image.historyCrc != History::crc(image.history, 0xFFFF)) return false;
+#endif  // HISTORY
+
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) Calibration::load(s, image.cal[s], image.calPoints[s]);
+  ReadRate::set(image.rate);
+#if defined(TELEMETRY_BINARY)
+  Telemetry::setMode((Telemetry::Mode)image.telemetryMode);
+#endif  // TELEMETRY_BINARY
+  View::setDisplayEnabled(image.displayOn);
+  if (image.contrast != View::displayContrast()) View::setDisplayContrast(image.contrast);
+  if (!Boot::reached(Boot::FirstReading)) memcpy(Lib::ctx.values, image.values, NUM_SENSORS);
+#if defined(HISTORY)
+  History::restoreState(image.history);
+#endif  // HISTORY
+  if (clockCheck == ~clockSeconds) {
+    // the reset came on average half a period after the last tick
+    Clock::setSeconds(clockSeconds, (uint16_t)(READ_INTERVAL_SECONDS * 500UL + Boot::sinceStartUs() / 1000UL));
+  }
+  wasRestored = true;
+  return true;
+}
+
+bool restored() {
+  return wasRestored;
+}
+
+}  // namespace Snapshot
+
+#endif  // WARM_RESTART
@@ -0,0 +1,60 @@
+/**
+ * @file snapshot.hpp
+ * @brief Runtime state kept in .noinit SRAM across watchdog and external
+ * resets.
+ *
+ * A reset that keeps the supply up leaves SRAM intact; only the C runtime
+ * clears .data and .bss. The snapshot lives in .noinit and holds the latest
+ * values, the runtime settings (display on/off and contrast, read rate,
+ * telemetry mode, calibration curves) and the position of the history ring,
+ * whose blocks are in .noinit as well. It carries a magic number that
+ * includes its size, a CRC-16 over the history blocks in use and a CRC-16
+ * over the snapshot. It is updated after every published reading and every
+ * command line, so it is current whenever the loop hangs long enough for the
+ * watchdog. An update that changes nothing leaves the CRC alone, and the
+ * history CRC is only computed again after a sample was appended.
+ *
+ * The clock is kept separately: the Timer1 interrupt stores the seconds of
+ * every tick with their complement, so it stays current even while the loop
+ * hangs. After a watchdog (WDRF) or external (EXTRF) reset a valid snapshot
+ * is applied at the end of @c setup() instead of starting cold; the clock
+ * resumes within one tick plus the time the bootloader takes. Power-on and
+ * brown-out resets always start cold.
+ */
+#pragma once
+
+#include "hal.hpp"
+
+/**
+ * @namespace Snapshot
+ * @brief Warm restart from .noinit SRAM.
+ */
+namespace Snapshot {
+
+/**
+ * @brief Record the clock of the current tick; call from the Timer1
+ * compare ISR after @ref Clock::tick().
+ */
+void tick();
+
+/**
+ * @brief Update the snapshot from the current state. Call from the main
+ * loop whenever something it holds may have changed; the CRC is only
+ * recomputed if something did.
+ */
+void save();
+
+/**
+ * @brief Apply a valid snapshot after a watchdog or external reset; call at
+ * the end of @c setup(). The latest values are only taken over if no
+ * reading was made yet.
+ * @return true if the snapshot was applied.
+ */
+bool restore();
+
+/**
+ * @brief True if @ref restore() applied the snapshot at this boot.
+ */
+bool restored();
+
+}  // namespace Snapshot
@@ -0,0 +1,219 @@
+/**
+ * @file telemetry.cpp
+ * @brief Implementation of the COBS-framed binary telemetry.
+ */
+#include "telemetry.hpp"
+#include "bitpack.hpp"
+#include "clock.hpp"
+#include "config.hpp"
+#include "crc.hpp"
+#include "hal.hpp"
+#include "sensorstats.hpp"
+#include "serialout.hpp"
+
+#if defined(TELEMETRY_BINARY)
+
+namespace Telemetry {
+
+constexpr uint8_t BITMAP_BYTES = (NUM_SENSORS + 7) / 8;
+#if defined(ADC_OVERSAMPLE)
+constexpr uint8_t READINGS_TYPE = PACKET_READINGS_RAW;
+constexpr uint8_t RAW_BYTES = 2 * NUM_SENSORS;
+#else
+constexpr uint8_t READINGS_TYPE = PACKET_READINGS;
+constexpr uint8_t RAW_BYTES = 0;
+#endif  // ADC_OVERSAMPLE
+constexpr uint8_t READINGS_BYTES = 7 + BITMAP_BYTES + Bitpack::bytesFor7(NUM_SENSORS) + RAW_BYTES + 2;
+static_assert(READINGS_BYTES <= MAX_PACKET_BYTES, "Readings packet exceeds MAX_PACKET_BYTES");
+constexpr uint8_t STATS_BYTES = 22;
+/** Size of the frame buffer; COBS adds at most one byte, plus the delimiter. */
+constexpr uint8_t LARGEST_PACKET = READINGS_BYTES > STATS_BYTES ? READINGS_BYTES : STATS_BYTES;
+
+static Mode currentMode = Ascii;
+static uint16_t sequence = 0;
+#if defined(SENSOR_STATS)
+static uint8_t readingsSinceSummary = 0;
+#endif  // SENSOR_STATS
+
+void setMode(Mode mode) {
+  currentMode = mode;
+}
+
+Mode mode() {
+  return currentMode;
+}
+
+uint8_t cobsEncode(const uint8_t* src, uint8_t len, uint8_t* dst) {
+  uint8_t out = 1;
+  uint8_t codePos = 0;
+  uint8_t code = 1;
+  for (uint8_t i = 0; i < len; i++) {
+    if (src[i] == 0) {
+      dst[codePos] = code;
+      codePos = out++;
+      code = 1;
+    } else {
+      dst[out++] = src[i];
+      if (++code == 0xFF) {
+        dst[codePos] = code;
+        codePos = out++;
+        code = 1;
+      }
+    }
+  }
+  dst[codePos] = code;
+  return out;
+}
+
+uint8_t cobsDecode(uint8_t* buf, uint8_t len) {
+  uint8_t in = 0;
+  uint8_t out = 0;
+  while (in < len) {
+    uint8_t code = buf[in++];
+    if (code == 0 || in + code - 1 > len) return 0;
+    for (uint8_t i = 1; i < code; i++) buf[out++] = buf[in++];
+    if (code != 0xFF && in < len) buf[out++] = 0;
+  }
+  return out;
+}
+
+/**
+ * @brief Write type, sequence number and time @p t to the start of @p pkt.
+ * @return Bytes written.
+ */
+static uint8_t putHeader(uint8_t* pkt, uint8_t type, uint32_t t) {
+  uint8_t n = 0;
+  pkt[n++] = type;
+  pkt[n++] = (uint8_t)sequence;
+  pkt[n++] = (uint8_t)(sequence >> 8);
+  for (uint8_t i = 0; i < 4; i++) pkt[n++] = (uint8_t)(t >> (8 * i));
+  return n;
+}
+
+/**
+ * @brief Append the CRC to the @p n bytes in @p pkt (which has room for
+ * it) and send them as one frame.
+ */
+static void sendPacket(uint8_t* pkt, uint8_t n) {
+  uint16_t crc = Crc::crc16(pkt, n);
+  pkt[n++] = (uint8_t)crc;
+  pkt[n++] = (uint8_t)(crc >> 8);
+  sequence++;
+
+  uint8_t frame[LARGEST_PACKET + 2];
+  uint8_t len = cobsEncode(pkt, n, frame);
+  frame[len++] = 0x00;  // frame delimiter
+#if defined(SERIAL_OUT)
+  // a frame that does not fit is dropped whole; the receiver resyncs on the next delimiter
+  SerialOut::write(frame, len, SerialOut::Data);
+  SerialOut::end(SerialOut::Data);
+#endif  // SERIAL_OUT
+}
+
+void sendReadings(const Lib::SensorContext& ctx) {
+  uint8_t pkt[READINGS_BYTES];
+  // stamped with the time of the request, not of the (later) send
+  uint8_t n = putHeader(pkt, READINGS_TYPE, Clock::millis() - ((uint32_t)millis() - ctx.requestMillis));
+  uint8_t* bitmap = &pkt[n];
+  memset(bitmap, 0, BITMAP_BYTES + Bitpack::bytesFor7(NUM_SENSORS));
+  n += BITMAP_BYTES;
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    bitmap[s >> 3] |= (uint8_t)(1 << (s & 7));
+    Bitpack::put7(&pkt[n], s, ctx.values[s]);
+  }
+  n += Bitpack::bytesFor7(NUM_SENSORS);
+#if defined(ADC_OVERSAMPLE)
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    pkt[n++] = (uint8_t)ctx.raw[s];
+    pkt[n++] = (uint8_t)(ctx.raw[s] >> 8);
+  }
+#endif  // ADC_OVERSAMPLE
+  sendPacket(pkt, n);
+}
+
+#if defined(SENSOR_STATS)
+/**
+ * @brief Send the @ref PACKET_STATS packet of @p sensor.
+ */
+static void sendStats(uint8_t sensor) {
+  const SensorStats::Summary sum = SensorStats::summary(sensor);
+  const uint32_t variance = sum.variance >> 4;
+  const uint16_t words[] = {sum.count, sum.mean, variance > 0xFFFF ? (uint16_t)0xFFFF : (uint16_t)variance, sum.ema};
+  uint8_t pkt[STATS_BYTES];
+  uint8_t n = putHeader(pkt, PACKET_STATS, Clock::millis());
+  pkt[n++] = sensor;
+  for (uint8_t i = 0; i < 4; i++) {
+    pkt[n++] = (uint8_t)words[i];
+    pkt[n++] = (uint8_t)(words[i] >> 8);
+  }
+  pkt[n++] = sum.hourMin;
+  pkt[n++] = sum.hourMax;
+  pkt[n++] = sum.dayMin;
+  pkt[n++] = sum.dayMax;
+  sendPacket(pkt, n);
+}
+
+void countReading() {
+  if (++readingsSinceSummary < SENSOR_STATS_PACKET_READINGS) return;
+  readingsSinceSummary = 0;
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) sendStats(s);
+}
+#endif  // SENSOR_STATS
+
+#if !defined(ARDUINO)
+bool decodeFrame(uint8_t* buf, uint8_t len, Frame& out) {
+  uint8_t n = cobsDecode(buf, len);
+  if (n < 7 + BITMAP_BYTES + 2) return false;
+  // the type byte, not this build's ADC_OVERSAMPLE, says whether raw values follow
+  if (buf[0] != PACKET_READINGS && buf[0] != PACKET_READINGS_RAW) return false;
+  out.hasRaw = buf[0] == PACKET_READINGS_RAW;
+  memcpy(out.bitmap, &buf[7], BITMAP_BYTES);
+  uint8_t present = 0;
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    if (out.bitmap[s >> 3] & (1 << (s & 7))) present++;
+  }
+  const uint8_t valueBytes = Bitpack::bytesFor7(present);
+  if (n != 7 + BITMAP_BYTES + valueBytes + (out.hasRaw ? 2 * present : 0) + 2) return false;
+  uint16_t crc = buf[n - 2] | ((uint16_t)buf[n - 1] << 8);
+  if (Crc::crc16(buf, n - 2) != crc) return false;
+
+  out.seq = buf[1] | ((uint16_t)buf[2] << 8);
+  out.timeMillis = 0;
+  for (uint8_t i = 0; i < 4; i++) out.timeMillis |= (uint32_t)buf[3 + i] << (8 * i);
+  // values are packed in bitmap order, absent sensors take no slot
+  uint8_t slot = 0;
+  const uint8_t* raw = &buf[7 + BITMAP_BYTES + valueBytes];
+  for (uint8_t s = 0; s < NUM_SENSORS; s++) {
+    bool present = out.bitmap[s >> 3] & (1 << (s & 7));
+    out.raw[s] = 0;
+    if (present && out.hasRaw) out.raw[s] = raw[2 * slot] | ((uint16_t)raw[2 * slot + 1] << 8);
+    out.values[s] = present ? Bitpack::get7(&buf[7 + BITMAP_BYTES], slot++) : 0;
+  }
+  return true;
+}
+
+bool decodeStatsFrame(uint8_t* buf, uint8_t len, StatsFrame& out) {
+  uint8_t n = cobsDecode(buf, len);
+  if (n != STATS_BYTES || buf[0] != PACKET_STATS) return false;
+  uint16_t crc = buf[n - 2] | ((uint16_t)buf[n - 1] << 8);
+  if (Crc::crc16(buf, n - 2) != crc) return false;
+
+  out.seq = buf[1] | ((uint16_t)buf[2] << 8);
+  out.timeMillis = 0;
+  for (uint8_t i = 0; i < 4; i++) out.timeMillis |= (uint32_t)buf[3 + i] << (8 * i);
+  out.sensor = buf[7];
+  out.count = buf[8] | ((uint16_t)buf[9] << 8);
+  out.mean = buf[10] | ((uint16_t)buf[11] << 8);
+  out.variance = buf[12] | ((uint16_t)buf[13] << 8);
+  out.ema = buf[14] | ((uint16_t)buf[15] << 8);
+  out.hourMin = buf[16];
+  out.hourMax = buf[17];
+  out.dayMin = buf[18];
+  out.dayMax = buf[19];
+  return true;
+}
+#endif  // !ARDUINO
+
+}  // namespace Telemetry
+
+#endif  // TELEMETRY_BINARY
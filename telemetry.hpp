@@ -0,0 +1,160 @@
+/**
+ * @file telemetry.hpp
+ * @brief Compact binary telemetry frames as an alternative to the ASCII outputs.
+ *
+ * In binary mode every reading is sent as one COBS-framed packet terminated
+ * by a 0x00 byte:
+ *
+ * | offset | size | field                                        |
+ * |--------|------|----------------------------------------------|
+ * | 0      | 1    | packet type (@ref Telemetry::PACKET_READINGS) |
+ * | 1      | 2    | sequence number (little endian)              |
+ * | 3      | 4    | Clock::millis() of the read request (LE)     |
+ * | 7      | B    | sensor bitmap, B = ceil(NUM_SENSORS / 8)     |
+ * | 7+B    | V    | values of the set bits, 7-bit packed         |
+ * | 7+B+V  | R    | raw values of the set bits, 16 bit LE each   |
+ * | 7+B+V+R| 2    | CRC-16/CCITT-FALSE over all preceding bytes  |
+ *
+ * The raw values (10 + @ref ADC_OVERSAMPLE_BITS bits) are only present with
+ * @ref ADC_OVERSAMPLE; such packets carry the type
+ * @ref Telemetry::PACKET_READINGS_RAW and R = 2 bytes per value.
+ *
+ * The packet is built straight from the context; no strings are formatted.
+ * For three sensors a reading takes 15 bytes on the wire (21 with raw
+ * values, including COBS overhead and delimiter), compared with 54 bytes
+ * for the log and plotter lines.
+ *
+ * With @ref SENSOR_STATS every @ref SENSOR_STATS_PACKET_READINGS readings
+ * one summary packet per sensor (@ref Telemetry::PACKET_STATS, 22 bytes,
+ * 24 on the wire) follows, numbered in the same sequence:
+ *
+ * | offset | size | field                                        |
+ * |--------|------|----------------------------------------------|
+ * | 0      | 1    | packet type (@ref Telemetry::PACKET_STATS)   |
+ * | 1      | 2    | sequence number (little endian)              |
+ * | 3      | 4    | Clock::millis() (little endian)              |
+ * | 7      | 1    | sensor index                                 |
+ * | 8      | 2    | readings in the mean and variance            |
+ * | 10     | 2    | mean in 1/256 percent                        |
+ * | 12     | 2    | variance in 1/16 percent², saturated         |
+ * | 14     | 2    | moving average in 1/256 percent              |
+ * | 16     | 4    | min and max of the last hour, of the last day|
+ * | 20     | 2    | CRC-16/CCITT-FALSE over all preceding bytes  |
+ *
+ * A window without readings has min 0xFF and max 0. In @ref
+ * Telemetry::Summary mode only the summary packets are sent, which cuts the
+ * uplink for three sensors from 450 to 72 bytes per 5 minutes.
+ */
+#pragma once
+
+#include "lib.hpp"
+
+/**
+ * @namespace Telemetry
+ * @brief Binary framed output of readings.
+ */
+namespace Telemetry {
+
+/**
+ * @brief Serial output format for readings.
+ */
+enum Mode : uint8_t {
+  Ascii,  ///< human-readable log and plotter lines (@ref SERIAL_LOG, @ref SERIAL_PLOT)
+  Binary,  ///< COBS-framed binary packets
+  Summary  ///< only the summary packets (requires @ref SENSOR_STATS)
+};
+
+/** Packet type of a readings packet. */
+constexpr uint8_t PACKET_READINGS = 0x01;
+/** Packet type of a readings packet with high-resolution raw values. */
+constexpr uint8_t PACKET_READINGS_RAW = 0x02;
+/** Packet type of the statistics of one sensor. */
+constexpr uint8_t PACKET_STATS = 0x03;
+
+/** Largest raw (unframed) packet this module produces. */
+constexpr uint8_t MAX_PACKET_BYTES = 64;
+
+/**
+ * @brief Select the output format at runtime.
+ */
+void setMode(Mode mode);
+
+/**
+ * @brief Currently selected output format.
+ */
+Mode mode();
+
+/**
+ * @brief Send the readings in @p ctx as one binary frame.
+ */
+void sendReadings(const Lib::SensorContext& ctx);
+
+#if defined(SENSOR_STATS)
+/**
+ * @brief Count a published reading and send the summary packets of all
+ * sensors every @ref SENSOR_STATS_PACKET_READINGS readings.
+ */
+void countReading();
+#endif  // SENSOR_STATS
+
+/**
+ * @brief COBS-encode @p len bytes from @p src into @p dst (no delimiter).
+ * @return Encoded length (at most len + 1 for packets below 254 bytes).
+ */
+uint8_t cobsEncode(const uint8_t* src, uint8_t len, uint8_t* dst);
+
+/**
+ * @brief Decode a COBS frame (without delimiter) in place.
+ * @return Decoded length, or 0 if the frame is malformed.
+ */
+uint8_t cobsDecode(uint8_t* buf, uint8_t len);
+
+#if !defined(ARDUINO)
+/**
+ * @brief A decoded readings packet (collector side).
+ */
+struct Frame {
+  uint16_t seq;
+  uint32_t timeMillis;
+  uint8_t bitmap[(NUM_SENSORS + 7) / 8];
+  uint8_t values[NUM_SENSORS];
+  bool hasRaw;                  ///< raw[] is valid (@ref PACKET_READINGS_RAW)
+  uint16_t raw[NUM_SENSORS];
+};
+
+/**
+ * @brief Decode and verify a readings frame (host builds only). Both
+ * @ref PACKET_READINGS and @ref PACKET_READINGS_RAW are accepted, whatever
+ * @ref ADC_OVERSAMPLE is set to in this build.
+ * @param buf COBS frame without delimiter; decoded in place.
+ * @param len Frame length.
+ * @param out Receives the decoded packet.
+ * @return false on malformed framing, wrong type or CRC mismatch.
+ */
+bool decodeFrame(uint8_t* buf, uint8_t len, Frame& out);
+
+/**
+ * @brief A decoded summary packet (collector side).
+ */
+struct StatsFrame {
+  uint16_t seq;
+  uint32_t timeMillis;
+  uint8_t sensor;
+  uint16_t count;
+  uint16_t mean;      ///< in 1/256 percent
+  uint16_t variance;  ///< in 1/16 percent²
+  uint16_t ema;       ///< in 1/256 percent
+  uint8_t hourMin;
+  uint8_t hourMax;
+  uint8_t dayMin;
+  uint8_t dayMax;
+};
+
+/**
+ * @brief Decode and verify a summary frame (host builds only).
+ * @return false on malformed framing, wrong type or CRC mismatch.
+ */
+bool decodeStatsFrame(uint8_t* buf, uint8_t len, StatsFrame& out);
+#endif  // !ARDUINO
+
+}  // namespace Telemetry
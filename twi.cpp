@@ -0,0 +1,307 @@
+/**
+ * @file twi.cpp
+ * @brief Implementation of the interrupt-driven I2C master.
+ */
+#include "twi.hpp"
+#include "config.hpp"
+
+#if defined(TWI_ASYNC)
+
+namespace Twi {
+
+// TWSR status codes of the master modes.
+constexpr uint8_t ST_BUS_ERROR = 0x00;
+constexpr uint8_t ST_START = 0x08;
+constexpr uint8_t ST_REP_START = 0x10;
+constexpr uint8_t ST_MT_SLA_ACK = 0x18;
+constexpr uint8_t ST_MT_SLA_NACK = 0x20;
+constexpr uint8_t ST_MT_DATA_ACK = 0x28;
+constexpr uint8_t ST_MT_DATA_NACK = 0x30;
+constexpr uint8_t ST_MR_SLA_ACK = 0x40;
+constexpr uint8_t ST_MR_SLA_NACK = 0x48;
+constexpr uint8_t ST_MR_DATA_ACK = 0x50;
+constexpr uint8_t ST_MR_DATA_NACK = 0x58;
+
+/** Largest stream transfer: it must fit the ring with its address and length byte. */
+constexpr uint8_t MAX_STREAM_TRANSFER = TWI_STREAM_BYTES - 3;
+// a display data transfer is a control byte and up to 32 data bytes
+static_assert(MAX_STREAM_TRANSFER >= 33, "TWI_STREAM_BYTES must hold one display transfer");
+
+/** Owner of the transfer on the bus. */
+enum Source : uint8_t {
+  None,
+  FromRequest,
+  FromStream
+};
+
+static volatile uint8_t active = None;
+static Request* volatile head = nullptr;
+static Request* tail = nullptr;
+/** Bytes done in the current phase of the request on the bus. */
+static uint8_t pos = 0;
+/** Address and data bytes left of the stream transfer on the bus. */
+static uint8_t streamAddress = 0;
+static uint8_t streamLeft = 0;
+/** micros() of the last bus event, for the timeout. */
+static volatile uint32_t lastProgress = 0;
+static Stats counters = {};
+
+// Stream ring: [address][length][data...] per transfer. Only the loop
+// writes ringHead and ringCommit; ringTail moves with interrupts disabled.
+static uint8_t ring[TWI_STREAM_BYTES];
+static uint8_t ringHead = 0;              // next byte to fill
+static volatile uint8_t ringCommit = 0;   // end of the transfers released to the bus
+static volatile uint8_t ringTail = 0;     // next byte for the bus
+static uint8_t openLenIdx = 0;            // length byte of the open transfer
+static uint8_t openLen = 0;
+
+static inline uint8_t ringNext(uint8_t i) {
+  return i + 1 >= TWI_STREAM_BYTES ? 0 : i + 1;
+}
+
+static uint8_t ringPop() {
+  uint8_t b = ring[ringTail];
+  ringTail = ringNext(ringTail);
+  return b;
+}
+
+static uint8_t ringRoom() {
+  return (uint8_t)(((uint16_t)ringTail + TWI_STREAM_BYTES - ringHead - 1) % TWI_STREAM_BYTES);
+}
+
+/**
+ * @brief Pick the next transfer; requests go before the stream.
+ * @return false if there is nothing to send.
+ */
+static bool startNext() {
+  if (head) {
+    active = FromRequest;
+  } else if (ringTail != ringCommit) {
+    // take the transfer off the ring now, so a failure drops it as a whole
+    active = FromStream;
+    streamAddress = ringPop();
+    streamLeft = ringPop();
+  } else {
+    active = None;
+    return false;
+  }
+  pos = 0;
+  lastProgress = micros();
+  return true;
+}
+
+/**
+ * @brief Retire the transfer on the bus with @p status (no bus action).
+ */
+static void complete(Status status) {
+  if (status == Ok) counters.transfers++;
+  else if (status == BusError) counters.errors++;
+  else counters.nacks++;
+
+  if (active == FromRequest) {
+    Request* r = head;
+    head = r->next;
+    if (!head) tail = nullptr;
+    r->status = status;
+  } else {
+    // drop what is left of a failed transfer
+    for (; streamLeft; streamLeft--) ringTail = ringNext(ringTail);
+  }
+  active = None;
+}
+
+/** Retire the transfer and chain the next one behind the STOP. */
+static void finish(Status status) {
+  complete(status);
+  Hal::twiAct(startNext() ? Hal::TwiStopStart : Hal::TwiStop);
+}
+
+/** Start the bus if it is idle; call with interrupts enabled. */
+static void kick() {
+  noInterrupts();
+  if (active == None && startNext()) Hal::twiAct(Hal::TwiStart);
+  interrupts();
+}
+
+void begin() {
+  Hal::twiInit(TWI_CLOCK);
+}
+
+bool submit(Request& request) {
+  if (request.status == Pending) return false;
+  request.status = Pending;
+  request.next = nullptr;
+  noInterrupts();
+  if (tail) tail->next = &request;
+  else head = &request;
+  tail = &request;
+  interrupts();
+  kick();
+  return true;
+}
+
+bool isIdle() {
+  return active == None && !head && ringTail == ringCommit;
+}
+
+void poll() {
+  if (active == None) return;
+  noInterrupts();
+  if (active != None && (uint32_t)micros() - lastProgress > TWI_TIMEOUT_US) {
+    Hal::twiRecover();
+    Hal::twiInit(TWI_CLOCK);
+    counters.recoveries++;
+    complete(BusError);
+    if (startNext()) Hal::twiAct(Hal::TwiStart);
+  }
+  interrupts();
+}
+
+/** Wait until @p bytes fit into the ring. */
+static void waitForRoom(uint8_t bytes) {
+  if (ringRoom() >= bytes) return;
+  uint32_t t0 = micros();
+  while (ringRoom() < bytes) {
+    poll();
+    Hal::spinWait();
+  }
+  counters.waitUs += (uint32_t)micros() - t0;
+}
+
+void streamStart(uint8_t address) {
+  waitForRoom(2);
+  ring[ringHead] = address;
+  openLenIdx = ringNext(ringHead);
+  ringHead = ringNext(openLenIdx);
+  openLen = 0;
+}
+
+void streamSend(const uint8_t* data, uint8_t len) {
+  while (len--) {
+    if (openLen >= MAX_STREAM_TRANSFER) {
+      counters.errors++;  // would never fit the ring; U8g2 does not send this much
+      return;
+    }
+    waitForRoom(1);
+    ring[ringHead] = *data++;
+    ringHead = ringNext(ringHead);
+    openLen++;
+  }
+}
+
+void streamEnd() {
+  ring[openLenIdx] = openLen;
+  ringCommit = ringHead;
+  kick();
+}
+
+const Stats& stats() {
+  return counters;
+}
+
+void onInterrupt() {
+  uint8_t status = Hal::twiStatus();
+  lastProgress = micros();
+  if (status != ST_START && status != ST_REP_START) counters.bytes++;
+  if (active == None) {
+    Hal::twiAct(Hal::TwiStop);
+    return;
+  }
+  Request* r = head;
+
+  switch (status) {
+    case ST_START:
+    case ST_REP_START:
+      if (active == FromStream) {
+        Hal::twiAct(Hal::TwiWrite, streamAddress << 1);
+      } else {
+        // read right away if there is nothing to write, else after the REP_START
+        bool read = status == ST_REP_START || !r->txLen;
+        Hal::twiAct(Hal::TwiWrite, (r->address << 1) | (read ? 1 : 0));
+      }
+      break;
+
+    case ST_MT_SLA_ACK:
+    case ST_MT_DATA_ACK:
+      if (active == FromStream) {
+        if (streamLeft) {
+          streamLeft--;
+          Hal::twiAct(Hal::TwiWrite, ringPop());
+        } else {
+          finish(Ok);
+        }
+      } else if (pos < r->txLen) {
+        Hal::twiAct(Hal::TwiWrite, r->tx[pos++]);
+      } else if (r->rxLen) {
+        pos = 0;
+        Hal::twiAct(Hal::TwiStart);
+      } else {
+        finish(Ok);
+      }
+      break;
+
+    case ST_MR_SLA_ACK:
+      pos = 0;
+      Hal::twiAct(r->rxLen > 1 ? Hal::TwiReadAck : Hal::TwiReadNack);
+      break;
+
+    case ST_MR_DATA_ACK:
+      r->rx[pos++] = Hal::twiData();
+      Hal::twiAct(pos + 1 < r->rxLen ? Hal::TwiReadAck : Hal::TwiReadNack);
+      break;
+
+    case ST_MR_DATA_NACK:
+      if (pos < r->rxLen) r->rx[pos++] = Hal::twiData();
+      finish(Ok);
+      break;
+
+    case ST_MT_SLA_NACK:
+    case ST_MR_SLA_NACK:
+      finish(AddressNack);
+      break;
+
+    case ST_MT_DATA_NACK:
+      finish(DataNack);
+      break;
+
+    case ST_BUS_ERROR:
+    default:  // lost arbitration: there is no other master, so the bus is disturbed
+      finish(BusError);
+      break;
+  }
+}
+
+}  // namespace Twi
+
+#if defined(ARDUINO)
+// TWI step complete: the state machine issues the next bus action.
+ISR(TWI_vect) {
+  Twi::onInterrupt();
+}
+
+namespace Hal {
+uint8_t u8x8ByteTwi(u8x8_t* u8x8, uint8_t msg, uint8_t arg_int, void* arg_ptr) {
+  switch (msg) {
+    case U8X8_MSG_BYTE_INIT:
+      Twi::begin();
+      break;
+    case U8X8_MSG_BYTE_START_TRANSFER:
+      Twi::streamStart(u8x8_GetI2CAddress(u8x8) >> 1);
+      break;
+    case U8X8_MSG_BYTE_SEND:
+      Twi::streamSend((const uint8_t*)arg_ptr, arg_int);
+      break;
+    case U8X8_MSG_BYTE_END_TRANSFER:
+      Twi::streamEnd();
+      break;
+    case U8X8_MSG_BYTE_SET_DC:
+      break;
+    default:
+      return 0;
+  }
+  return 1;
+}
+}  // namespace Hal
+#endif  // ARDUINO
+
+#endif  // TWI_ASYNC
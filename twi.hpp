@@ -0,0 +1,131 @@
+/**
+ * @file twi.hpp
+ * @brief Interrupt-driven I2C master with a transaction queue.
+ *
+ * Wire polls the TWI unit from the caller until a transfer has finished,
+ * so every display page used to block the loop for its full bus time. This
+ * driver runs the bus from @c TWI_vect instead and serves two sources:
+ *
+ * - **Requests**: caller-owned @ref Twi::Request records (write, read, or
+ *   write followed by a repeated START and a read) queued with
+ *   @ref Twi::submit(). Completion is reported through
+ *   @ref Twi::Request::status; nothing is copied.
+ * - **Stream**: write transfers copied into a @ref TWI_STREAM_BYTES ring,
+ *   fed by the display's U8g2 byte callback (@ref Twi::streamStart(),
+ *   @ref Twi::streamSend(), @ref Twi::streamEnd()). The callback only
+ *   waits while the ring is full, so drawing the next page overlaps with
+ *   the transfer of the previous one.
+ *
+ * Requests go first when the bus becomes free, since they are short and a
+ * sensor read should not queue behind a frame. A bus that stops making
+ * progress for @ref TWI_TIMEOUT_US, or reports a bus error, is recovered
+ * by clocking out a slave that holds SDA low and sending a STOP; the
+ * affected transfer fails and the queue continues.
+ *
+ * The driver owns @c TWI_vect, so Wire must not be linked while
+ * @ref TWI_ASYNC is defined (see @ref Hal::Display).
+ */
+#pragma once
+
+#include "hal.hpp"
+
+#if defined(TWI_ASYNC)
+
+/**
+ * @namespace Twi
+ * @brief Non-blocking I2C transactions driven by @c TWI_vect.
+ */
+namespace Twi {
+
+/**
+ * @brief State of a @ref Request.
+ */
+enum Status : uint8_t {
+  Idle,         ///< never submitted
+  Pending,      ///< queued or on the bus
+  Ok,           ///< completed
+  AddressNack,  ///< no device acknowledged the address
+  DataNack,     ///< the device rejected a written byte
+  BusError,     ///< bus error, lost arbitration or timeout; the bus was recovered
+};
+
+/**
+ * @brief One I2C transaction, owned by the caller until it is no longer
+ * @ref Pending.
+ *
+ * @c txLen bytes from @c tx are written first, then @c rxLen bytes are
+ * read into @c rx (after a repeated START if both are set). Both buffers
+ * must stay valid while the request is pending.
+ */
+struct Request {
+  uint8_t address;  ///< 7-bit device address
+  const uint8_t* tx;
+  uint8_t txLen;
+  uint8_t* rx;
+  uint8_t rxLen;
+  volatile Status status;
+  Request* next;  ///< queue link, managed by the driver
+};
+
+/**
+ * @brief Bus statistics since boot.
+ */
+struct Stats {
+  uint32_t transfers;  ///< completed transactions (requests and stream transfers)
+  uint32_t bytes;      ///< bytes on the bus, including address bytes
+  uint16_t nacks;      ///< transfers failed with a NACK
+  uint16_t errors;     ///< bus errors and timeouts
+  uint16_t recoveries; ///< bus recoveries
+  uint32_t waitUs;     ///< time callers waited for room in the stream ring
+};
+
+/**
+ * @brief Enable the TWI unit at @ref TWI_CLOCK; call once from setup().
+ */
+void begin();
+
+/**
+ * @brief Queue @p request.
+ * @return false if the request is still pending (nothing is changed).
+ */
+bool submit(Request& request);
+
+/**
+ * @brief Query whether no transfer is queued or on the bus.
+ */
+bool isIdle();
+
+/**
+ * @brief Recover the bus if it stopped making progress; call from the main loop.
+ */
+void poll();
+
+/**
+ * @brief Begin a write transfer to @p address in the stream ring.
+ */
+void streamStart(uint8_t address);
+
+/**
+ * @brief Append @p len bytes to the open stream transfer, waiting while
+ * the ring is full.
+ */
+void streamSend(const uint8_t* data, uint8_t len);
+
+/**
+ * @brief Close the open stream transfer and release it to the bus.
+ */
+void streamEnd();
+
+/**
+ * @brief Access the bus statistics.
+ */
+const Stats& stats();
+
+/**
+ * @brief TWI interrupt hook called from @c TWI_vect (or the host simulator).
+ */
+void onInterrupt();
+
+}  // namespace Twi
+
+#endif  // TWI_ASYNC
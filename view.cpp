@@ -2,13 +2,15 @@
  * @file view.cpp
  * @brief Implementation of serial and OLED display rendering for Plant Monitor.
  */
-#include <Arduino.h>
-#include <U8g2lib.h>
-#include <Wire.h>
-
 #include "config.hpp"
+#include "hal.hpp"
+#include "clock.hpp"
 #include "view.hpp"
+#include "labelcache.hpp"
+#include "latency.hpp"
 #include "lib.hpp"
+#include "telemetry.hpp"
+#include "twi.hpp"
 #include "splashScreen.h"
 
 namespace View {
@@ -20,36 +22,81 @@ static_assert(NUM_SENSORS > 0, "NUM_SENSORS must be greater than 0");
  * @brief Runtime switch to enable/disable display rendering.
  */
 static bool displayEnabled = true;
-
-/**
- * @brief Format `millis()` (+ offset) into HH:MM:SS.
- * @param buf Buffer of at least 9 chars to receive a null-terminated string.
- * @param flashDots If true, the separators blink once per second.
- */
-void formatMillisTime(char* buf, bool flashDots = false);
+/** Contrast last sent to the display. */
+static uint8_t contrast = DISP_CONTRAST;
 
 #if defined(DISP)
 
 /** OLED driver instance for a 128x64 SH1106 display. */
-U8G2_SH1106_128X64_NONAME_2_HW_I2C display(U8G2_R0, /* reset=*/U8X8_PIN_NONE);
+Hal::Display display(U8G2_R0, /* reset=*/U8X8_PIN_NONE);
 /** Vertical pixel offset used for marquee-style scrolling. */
 int8_t dispScrollOffset = 0;
 /** Index of the next sensor name/value to render at the top line. */
 uint8_t sensorIDOffset = 0;
-/** Draw the current time header bar at the top of the screen. */
-static void drawHeader();
+/** Height of the header bar in pixels. */
+constexpr uint8_t HEADER_HEIGHT = 12;
+/** Draw the header bar with the given HH:MM:SS string at the top of the screen. */
+static void drawHeader(const char* clock);
 /** Timestamp of the last debug message shown (for auto-hide). */
-unsigned long lastDebug = 0;
+uint32_t lastDebug = 0;
+/** Timestamp of the last scroll step. */
+static uint32_t lastScrollMillis = 0;
+
+/**
+ * @brief Everything that determines the pixels of the main screen.
+ */
+struct MainScreenState {
+  int8_t scrollOffset;
+  uint8_t sensorOffset;
+  uint8_t values[NUM_SENSORS];
+  char clock[9];
+};
+/** State last transmitted to the panel. */
+static MainScreenState shownState;
+/** False while the panel shows anything other than @ref shownState. */
+static bool shownValid = false;
+/** initDisplay() has run; before that nothing is sent to the panel. */
+static bool displayStarted = false;
+/** A full frame of @ref shownState is being sent, one page per call. */
+static bool framePending = false;
+/** Tile row of the next page of the pending frame. */
+static uint8_t frameRow = 0;
+/** Frame and byte counters, see @ref renderStats(). */
+static RenderStats stats = {};
+static void countFrame();
+static void drawSplash();
+/** The splash screen is sent by the render task, one page per call. */
+static bool splashPending = false;
+/** Tile row of the next splash page. */
+static uint8_t splashRow = 0;
+/** millis() when the splash screen was started. */
+static uint32_t splashStart = 0;
 
 #endif  //DISP
 
 #if defined(DEBUG_DISP)
 
 #define DEBUG_BUFFER_LINES 6
-#define DEBUG_BUFFER_ROWS 21
 
-char debug_buffer[DEBUG_BUFFER_LINES][DEBUG_BUFFER_ROWS];
-int debugBufferLine = 0;
+/**
+ * @brief One line of the debug overlay: a flash message, or a number when
+ * @c text is nullptr. Both are formatted only when the overlay is drawn.
+ */
+struct DebugEntry {
+  const __FlashStringHelper* text;
+  long value;
+};
+
+DebugEntry debug_buffer[DEBUG_BUFFER_LINES];
+uint8_t debugBufferLine = 0;
+/** Lines were added since the overlay was last drawn. */
+static bool debugDirty = false;
+/** An overlay frame is being sent, one page per render pass. */
+static bool debugFramePending = false;
+/** Tile row of the next overlay page. */
+static uint8_t debugFrameRow = 0;
+/** Newest line when the pending overlay frame started. */
+static uint8_t debugFrameHead = 0;
 static void debugBufferNextLine();
 static void printDebugBuffer();
 
@@ -57,6 +104,13 @@ static void printDebugBuffer();
 
 inline void initIIC() {
 
+#if defined(TWI_ASYNC)
+
+  Twi::begin();
+  debugLine(F("I2C/IIC async driver active"));
+
+#else
+
   Wire.setClock(400000L);
 
 #if defined(WIRE_HAS_TIMEOUT)
@@ -65,6 +119,7 @@ inline void initIIC() {
   debugLine(F("I2C/IIC timeout active"));
 
 #endif  //WIRE_HAS_TIMEOUT
+#endif  //TWI_ASYNC
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -93,12 +148,12 @@ void valuesSerialPrint() {
 #if defined(SERIAL_LOG) && defined(SERIAL_OUT)
 
   for (uint8_t i = 0; i < NUM_SENSORS; i++) {
-    messageSerial(Lib::getSensorName(i));
-    messageSerial(F(": "));
-    messageSerial(Lib::ctx.values[i]);
-    messageSerial(' ');
+    dataSerial(Lib::getSensorName(i));
+    dataSerial(F(": "));
+    dataSerial(Lib::ctx.values[i]);
+    dataSerial(' ');
   }
-  messageLineSerial(F(""));
+  dataLineSerial(F(""));
 
 #endif  //SERIAL_LOG
 }
@@ -108,14 +163,32 @@ void valuesSerialPlot() {
 #if defined(SERIAL_PLOT)
 
   for (uint8_t i = 0; i < NUM_SENSORS; i++) {
-    messageSerial(Lib::ctx.values[i]);
-    messageSerial(' ');
+    dataSerial(Lib::ctx.values[i]);
+    dataSerial(' ');
   }
-  messageLineSerial(F(""));
+  dataLineSerial(F(""));
 
 #endif  //SERIAL_PLOT
 }
 
+void valuesSerialSend() {
+
+#if defined(TELEMETRY_BINARY)
+
+  if (Telemetry::mode() != Telemetry::Ascii) {
+    if (Telemetry::mode() == Telemetry::Binary) Telemetry::sendReadings(Lib::ctx);
+#if defined(SENSOR_STATS)
+    Telemetry::countReading();
+#endif  // SENSOR_STATS
+    return;
+  }
+
+#endif  //TELEMETRY_BINARY
+
+  valuesSerialPrint();
+  valuesSerialPlot();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////   DISPLAY   ///////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -127,13 +200,15 @@ void valuesSerialPlot() {
  * 1. Sets up I2C communication with the display
  * 2. Initializes the display driver
  * 3. Enables UTF-8 text output
- * 4. Shows a brief startup message
+ * 4. Shows the splash screen for @ref DISP_SPLASH_MS, or leaves it to the
+ *    render task when @p deferSplash is set
  * 5. Sets the display contrast to @ref DISP_CONTRAST
+ * 6. Fills the label cache (@ref LABEL_CACHE)
  * 
  * The function is guarded by the @ref DISP compile-time flag and will do nothing
  * if the display support is not enabled.
  */
-void initDisplay() {
+void initDisplay(bool deferSplash) {
 
 #if defined(DISP)
 
@@ -141,27 +216,42 @@ void initDisplay() {
   initIIC();
   displayEnabled = true;
   display.begin();
-  display.setContrast(DISP_CONTRAST);
-  display.firstPage();
+  display.setContrast(contrast);
+  displayStarted = true;
   display.setDrawColor(1);
   display.setBitmapMode(0);
-  do {
-    display.drawXBMP(0, 0, SPLASH_SCREEN_WIDTH, SPLASH_SCREEN_HEIGHT, splashScreen_bits);
-  } while (display.nextPage());
-  delay(1000);
+  shownValid = false;
+  splashStart = millis();
+  if (deferSplash) {
+    splashPending = true;
+    splashRow = 0;
+  } else {
+    display.firstPage();
+    do {
+      drawSplash();
+    } while (display.nextPage());
+    countFrame();
+  }
+#if defined(LABEL_CACHE)
+  display.setFont(u8g2_font_profont17_mr);
+  LabelCache::build(display);
+#endif  // LABEL_CACHE
+  if (!deferSplash) delay(DISP_SPLASH_MS);
   debugLine(F("Completed Display setup!"));
 
+#else
+  (void)deferSplash;
 #endif  //DISP
 }
 
-
 /**
- * @brief Display a debug message from flash memory on the OLED display.
- * 
- * When both DEBUG_DISP and DISP are enabled, this function adds the given message
- * to a circular debug message buffer and updates the display to show recent messages.
- * Messages are rendered in a scrolling fashion with the most recent at the bottom.
- * 
+ * @brief Add a flash debug message to the on-display debug overlay.
+ *
+ * When both DEBUG_DISP and DISP are enabled, the message is appended to the
+ * circular debug buffer and the overlay is marked for redraw. Drawing is
+ * left to the render task (see @ref printMainScreen()), so a burst of lines
+ * costs one overlay frame instead of one frame per line.
+ *
  * @param msg Flash string pointer to the debug message to display
  */
 void debugLineDisplay(const __FlashStringHelper* msg) {
@@ -169,22 +259,17 @@ void debugLineDisplay(const __FlashStringHelper* msg) {
 #if defined(DEBUG_DISP) && defined(DISP)
 
   if (!displayEnabled) return;  // respect runtime display switch
-  lastDebug = millis();
   debugBufferNextLine();
-  strncpy_P(debug_buffer[debugBufferLine], (PGM_P)msg, DEBUG_BUFFER_ROWS - 1);  // Kopie von Flash in SRAM
-  debug_buffer[debugBufferLine][DEBUG_BUFFER_ROWS - 1] = '\0';                  // Sicherheit: Nullterminierung
-  printDebugBuffer();
+  debug_buffer[debugBufferLine].text = msg;
 
 #endif  //DEBUG_DISP
 }
 
 /**
- * @brief Display a numeric debug value on the OLED display.
- * 
- * When both DEBUG_DISP and DISP are enabled, this function converts the given
- * numeric value to a string, adds it to the circular debug message buffer,
- * and updates the display to show recent messages.
- * 
+ * @brief Add a numeric debug value to the on-display debug overlay.
+ *
+ * The value is stored as is and converted to text when the overlay is drawn.
+ *
  * @param value Long integer value to display as a debug message
  */
 void debugLineDisplay(long value) {
@@ -192,10 +277,9 @@ void debugLineDisplay(long value) {
 #if defined(DEBUG_DISP) && defined(DISP)
 
   if (!displayEnabled) return;
-  lastDebug = millis();
   debugBufferNextLine();
-  snprintf(debug_buffer[debugBufferLine], DEBUG_BUFFER_ROWS, "%ld", value);  // long → String
-  printDebugBuffer();
+  debug_buffer[debugBufferLine].text = nullptr;
+  debug_buffer[debugBufferLine].value = value;
 
 #endif  //DEBUG_DISP
 }
@@ -204,67 +288,245 @@ inline void debugBufferNextLine() {
 
 #if defined(DEBUG_DISP) && defined(DISP)
 
+  lastDebug = millis();
   debugBufferLine = (debugBufferLine + 1) % DEBUG_BUFFER_LINES;
+  debugDirty = true;
+  stats.debugLines++;
 
 #endif  //DEBUG_DISP
 }
 
+#if defined(DEBUG_DISP) && defined(DISP)
+/**
+ * @brief Draw the debug lines ending at @p head (newest at the bottom)
+ * into the current page.
+ */
+static void drawDebugOverlay(uint8_t head) {
+  display.setDrawColor(1);
+  display.drawBox(0, 0, 128, 64);
+  display.setDrawColor(0);
+  display.setFont(u8g2_font_profont11_mr);
+  for (uint8_t i = 1; i <= DEBUG_BUFFER_LINES; i++) {
+    const DebugEntry& entry = debug_buffer[(head + i) % DEBUG_BUFFER_LINES];
+    int16_t y = i * 10;  // 10 px line height for 6*11 font
+    display.setCursor(0, y);
+    if (entry.text) display.print(entry.text);
+    else display.print(entry.value);
+  }
+}
+#endif  //DEBUG_DISP
+
+/**
+ * @brief Send the next page of the debug overlay if it needs redrawing.
+ *
+ * A frame starts only when lines were added since the last one and is then
+ * sent one page per call; lines that arrive meanwhile are picked up by the
+ * following frame.
+ */
 void printDebugBuffer() {
 
 #if defined(DEBUG_DISP) && defined(DISP)
 
-  display.firstPage();
-  do {
-    display.setDrawColor(1);
-    display.drawBox(0, 0, 128, 64);
-    display.setDrawColor(0);
-    display.setFont(u8g2_font_profont11_mr);
-    for (uint8_t i = 1; i <= DEBUG_BUFFER_LINES; i++) {
-      uint8_t idx = (debugBufferLine + i) % DEBUG_BUFFER_LINES;
-      int16_t y = i * 10;  // 10 px line height for 6*11 font
-      display.setCursor(0, y);
-      display.print(debug_buffer[idx]);
-    }
-  } while (display.nextPage());
+  if (!debugFramePending) {
+    if (!debugDirty) return;
+    debugDirty = false;
+    debugFramePending = true;
+    debugFrameHead = debugBufferLine;
+    debugFrameRow = 0;
+    shownValid = false;  // the overlay covers the main screen
+  }
+  LATENCY_SCOPE(DebugScreen);
+  display.setBufferCurrTileRow(debugFrameRow);
+  display.clearBuffer();
+  drawDebugOverlay(debugFrameHead);
+  display.sendBuffer();
+  debugFrameRow += display.getBufferTileHeight();
+  if (debugFrameRow * 8 >= display.getDisplayHeight()) {
+    debugFramePending = false;
+    countFrame();
+    stats.debugFrames++;
+  }
 
 #endif  //DEBUG_DISP
 }
 
+#if defined(DISP)
+/**
+ * @brief Account one full frame in @ref stats.
+ */
+static void countFrame() {
+  stats.frames++;
+  stats.bytes += (uint32_t)display.getDisplayWidth() * (display.getDisplayHeight() / 8);
+}
+
+/**
+ * @brief Draw the splash bitmap into the current page.
+ */
+static void drawSplash() {
+  display.drawXBMP(0, 0, SPLASH_SCREEN_WIDTH, SPLASH_SCREEN_HEIGHT, splashScreen_bits);
+}
+
+/**
+ * @brief Send the next page of a deferred splash screen, then keep it up
+ * until @ref DISP_SPLASH_MS have passed.
+ */
+static void sendSplashPage() {
+  if (splashRow * 8 < display.getDisplayHeight()) {
+    display.setBufferCurrTileRow(splashRow);
+    display.clearBuffer();
+    drawSplash();
+    display.sendBuffer();
+    splashRow += display.getBufferTileHeight();
+    if (splashRow * 8 >= display.getDisplayHeight()) countFrame();
+    return;
+  }
+  if ((uint32_t)millis() - splashStart >= DISP_SPLASH_MS) splashPending = false;
+}
+
+/**
+ * @brief Advance the marquee by one pixel every @ref DISP_SCROLL_STEP_MS and
+ * hold it for @ref DISP_SCROLL_HOLD_MS whenever a row is aligned, so the
+ * scroll speed no longer depends on how fast the loop renders.
+ */
+static void advanceScroll(uint32_t now) {
+  uint16_t wait = dispScrollOffset == 0 ? DISP_SCROLL_HOLD_MS : DISP_SCROLL_STEP_MS;
+  if (now - lastScrollMillis < wait) return;
+  lastScrollMillis = now;
+  dispScrollOffset--;
+  if (dispScrollOffset < -16) {
+    dispScrollOffset = 0;
+  }
+  if (dispScrollOffset == 0) { sensorIDOffset = (sensorIDOffset + 1) % NUM_SENSORS; }
+}
+
+/**
+ * @brief Draw the name of @p sensor at baseline @p y, from the label cache
+ * if it holds it.
+ */
+static void drawSensorName(uint8_t sensor, int16_t y) {
+#if defined(LABEL_CACHE)
+  if (LabelCache::drawName(display, sensor, 0, y)) return;
+#endif  // LABEL_CACHE
+  display.setCursor(0, y);
+  display.print(Lib::getSensorName(sensor));
+}
+
+/**
+ * @brief Draw @p value right of the sensor names at baseline @p y, from the
+ * label cache if it holds the digits.
+ */
+static void drawSensorValue(uint8_t value, int16_t y) {
+#if defined(LABEL_CACHE)
+  if (LabelCache::drawNumber(display, value, 111, y)) return;
+#endif  // LABEL_CACHE
+  display.setCursor(111, y);
+  display.print(value);
+}
+
+/**
+ * @brief Draw the main screen for @p state into the current page.
+ */
+static void drawMainScreen(const MainScreenState& state) {
+  display.setFont(u8g2_font_profont17_mr);
+  display.setDrawColor(1);
+  int16_t y = state.scrollOffset;
+  uint8_t localSensorIdx = state.sensorOffset;
+  while (y < 129) {
+    drawSensorName(localSensorIdx, y);
+    drawSensorValue(state.values[localSensorIdx], y);
+    localSensorIdx = (localSensorIdx + 1) % NUM_SENSORS;
+    y += 17;
+  }
+  drawHeader(state.clock);
+}
+
+/**
+ * @brief Draw and send the page of the main screen starting at tile @p row.
+ */
+static void sendMainPage(uint8_t row) {
+  display.setBufferCurrTileRow(row);
+  display.clearBuffer();
+  drawMainScreen(shownState);
+  display.sendBuffer();
+}
+#endif  //DISP
+
+/**
+ * @brief Render the main screen if anything visible has changed.
+ *
+ * The visible state (scroll position, values, clock string) is compared
+ * with what was last sent. Nothing is transmitted if it is unchanged; if
+ * only the clock changed, just the pages covering the header are redrawn
+ * and sent via setBufferCurrTileRow()/sendBuffer(). Everything else sends
+ * a full frame, one page per call, so the loop is never held for a whole
+ * frame (with @ref TWI_ASYNC a page also leaves while other tasks run).
+ */
 void printMainScreen() {
 #if defined(DISP)
+  LATENCY_SCOPE(Render);
   if (!displayEnabled) return;
+  if (splashPending) {
+    sendSplashPage();
+    return;
+  }
 #if defined(DEBUG_DISP)
-  if (lastDebug + T_SHOWDEBUG > millis()) return;
+  if ((uint32_t)millis() - lastDebug < T_SHOWDEBUG) {
+    printDebugBuffer();
+    return;
+  }
+  debugFramePending = false;  // the overlay timed out, drop its rest
 #endif  //DEBUG_DISP
-  display.firstPage();
-  do {
-    display.setFont(u8g2_font_profont17_mr);
-    display.setDrawColor(1);
-    int16_t y = dispScrollOffset;
-    uint8_t localSensorIdx = sensorIDOffset;
-    while (y < 129) {
-      display.setCursor(0, y);
-      display.print(Lib::getSensorName(localSensorIdx));
-      display.setCursor(111, y);
-      display.print(Lib::ctx.values[localSensorIdx]);
-      localSensorIdx = (localSensorIdx + 1) % NUM_SENSORS;
-      y += 17;
+  uint8_t pageRows = display.getBufferTileHeight();
+  if (framePending && shownValid) {
+    sendMainPage(frameRow);
+    frameRow += pageRows;
+    if (frameRow * 8 >= display.getDisplayHeight()) {
+      framePending = false;
+      countFrame();
     }
-    drawHeader();
-  } while (display.nextPage());
+    return;
+  }
+  framePending = false;  // another screen took over the panel
+  advanceScroll(millis());
+
+  MainScreenState next;
+  next.scrollOffset = dispScrollOffset;
+  next.sensorOffset = sensorIDOffset;
+  memcpy(next.values, Lib::ctx.values, NUM_SENSORS);
+  memcpy(next.clock, Clock::text(), sizeof(next.clock));
+
+  bool fullFrame = !shownValid
+                   || next.scrollOffset != shownState.scrollOffset
+                   || next.sensorOffset != shownState.sensorOffset
+                   || memcmp(next.values, shownState.values, NUM_SENSORS) != 0;
+  if (!fullFrame && strcmp(next.clock, shownState.clock) == 0) {
+    stats.skipped++;
+    return;
+  }
+  shownState = next;
+  shownValid = true;
+
+  if (fullFrame) {
+    sendMainPage(0);
+    frameRow = pageRows;
+    framePending = true;
+    return;
+  }
 
-  // Update scrolling state once per frame (after drawing)
-  dispScrollOffset--;
-  if (dispScrollOffset < -16) {
-    dispScrollOffset = 0;
+  // Only the clock changed: resend the pages covering the header.
+  for (uint8_t row = 0; row * 8 < HEADER_HEIGHT; row += pageRows) {
+    sendMainPage(row);
+    stats.partials++;
+    stats.bytes += (uint32_t)display.getDisplayWidth() * pageRows;
   }
-  if (dispScrollOffset == 0) { sensorIDOffset = (sensorIDOffset + 1) % NUM_SENSORS; }
 #endif  //DISP
 }
 
 void printUpdateScreen() {
 #if defined(DISP)
   if (!displayEnabled) return;
+  shownValid = false;
+  const char* clock = Clock::text();
   display.firstPage();
   do {
     display.setFont(u8g2_font_profont22_mr);
@@ -273,22 +535,21 @@ void printUpdateScreen() {
     display.print(F("Updating"));
     display.setCursor(8, 52);
     display.print(F("sensors..."));
-    drawHeader();
+    drawHeader(clock);
   } while (display.nextPage());
+  countFrame();
 #endif  //DISP
 }
 
-static void drawHeader() {
+static void drawHeader(const char* clock) {
 #if defined(DISP)
   display.setFont(u8g2_font_profont11_mr);
   display.setDrawColor(0);
-  display.drawBox(0, 0, 128, 12);
+  display.drawBox(0, 0, 128, HEADER_HEIGHT);
   display.setDrawColor(1);
   display.drawHLine(0, 10, 128);
   display.setCursor(0, 8);
-  char buf[9];
-  formatMillisTime(buf, true);
-  display.print(buf);
+  display.print(clock);
 #if defined(DEBUG_DISP) || defined(DEBUG_SERIAL)
   display.setFont(u8g2_font_profont10_tr);
   display.setCursor(101, 7);
@@ -299,29 +560,6 @@ static void drawHeader() {
 #endif  //DISP
 }
 
-void formatMillisTime(char* buf, bool flashDots) {
-  // Calculate hours, minutes, seconds based on effective millis provided by Lib
-  uint32_t totalSeconds = (Lib::getTimeOfDayAsMillis()) / 1000;
-  uint8_t hours = (totalSeconds / 3600) % 24;
-  uint8_t minutes = (totalSeconds / 60) % 60;
-  uint8_t seconds = totalSeconds % 60;
-
-  // Format time string with optional flashing colons
-  char sep = ':';
-  if (flashDots && (seconds % 2 != 0)) sep = ' ';
-
-  // Fill buffer
-  buf[0] = '0' + (hours / 10);
-  buf[1] = '0' + (hours % 10);
-  buf[2] = sep;
-  buf[3] = '0' + (minutes / 10);
-  buf[4] = '0' + (minutes % 10);
-  buf[5] = sep;
-  buf[6] = '0' + (seconds / 10);
-  buf[7] = '0' + (seconds % 10);
-  buf[8] = '\0';
-}
-
 bool isDisplayEnabled() {
   return displayEnabled;
 }
@@ -330,22 +568,68 @@ void setDisplayEnabled(bool enabled) {
   if (displayEnabled == enabled) return;
   displayEnabled = enabled;
 #if defined(DISP)
+  shownValid = false;
   if (!enabled) {
     // Ensure the physical display is blanked when disabling output (paged)
     display.firstPage();
     do {
       // draw nothing, which results in a cleared page
     } while (display.nextPage());
+    countFrame();
   }
 #endif
 }
 
+uint8_t displayContrast() {
+  return contrast;
+}
+
+const RenderStats& renderStats() {
+#if defined(DISP)
+  return stats;
+#else
+  static const RenderStats none = {};
+  return none;
+#endif
+}
+
+void namesChanged() {
+#if defined(DISP)
+  if (!displayStarted) return;  // initDisplay() builds the label cache
+  shownValid = false;
+#if defined(LABEL_CACHE)
+  // the pending frame was dropped above, so the page buffer is free
+  display.setFont(u8g2_font_profont17_mr);
+  LabelCache::build(display);
+#endif  // LABEL_CACHE
+#endif  // DISP
+}
+
+#if !defined(ARDUINO) && defined(DISP)
+void drawMainFrame(int8_t scrollOffset, uint8_t sensorOffset, void (*onPage)(const uint8_t* page, uint16_t bytes)) {
+  MainScreenState state;
+  state.scrollOffset = scrollOffset;
+  state.sensorOffset = sensorOffset;
+  memcpy(state.values, Lib::ctx.values, NUM_SENSORS);
+  memcpy(state.clock, Clock::text(), sizeof(state.clock));
+  const uint8_t pageRows = display.getBufferTileHeight();
+  for (uint8_t row = 0; row * 8 < display.getDisplayHeight(); row += pageRows) {
+    display.setBufferCurrTileRow(row);
+    display.clearBuffer();
+    drawMainScreen(state);
+    onPage(display.getBufferPtr(), (uint16_t)display.getBufferTileWidth() * 8 * pageRows);
+  }
+}
+#endif  // !ARDUINO && DISP
+
 void setDisplayContrast(uint8_t value) {
+  contrast = value;
 #if defined(DISP)
+  if (!displayStarted) return;  // initDisplay() sends it
   display.setContrast(value);
 #if defined(DEBUG_SERIAL)
-  Serial.print(F("Contrast set to "));
-  Serial.println((int)value);
+  messageSerial(F("Contrast set to "));
+  messageLineSerial((int)value);
 #endif
 #endif
 }
@@ -4,7 +4,8 @@
  */
 #pragma once
 
-#include "Arduino.h"
+#include "hal.hpp"
+#include "serialout.hpp"
 
 /**
  * @defgroup view_ui View / UI
@@ -19,7 +20,8 @@
 namespace View {
 
 /**
- * @brief Append a debug line to the on-device debug buffer and redraw it.
+ * @brief Append a debug line to the on-device debug buffer; the render task
+ * redraws the overlay (once for a burst of lines).
  * @param msg Flash-stored message to show.
  */
 void debugLineDisplay(const __FlashStringHelper* msg);
@@ -29,28 +31,46 @@ void debugLineDisplay(long msg);
 template<typename T>
 inline void debugLineSerial(T msg) {
 #if defined(SERIAL_DEBUG)
-  Serial.println(msg);
+  SerialOut::print(msg, SerialOut::Debug);
+  SerialOut::endLine(SerialOut::Debug);
 #endif
 }
 
 template<typename T>
 inline void debugSerial(T msg) {
 #if defined(SERIAL_DEBUG)
-  Serial.print(msg);
+  SerialOut::print(msg, SerialOut::Debug);
 #endif
 }
 
 template<typename T>
 inline void messageLineSerial(T msg) {
 #if defined(SERIAL_OUT)
-  Serial.println(msg);
+  SerialOut::print(msg, SerialOut::Reply);
+  SerialOut::endLine(SerialOut::Reply);
 #endif
 }
 
 template<typename T>
 inline void messageSerial(T msg) {
 #if defined(SERIAL_OUT)
-  Serial.print(msg);
+  SerialOut::print(msg, SerialOut::Reply);
+#endif
+}
+
+/** Print a reading line; dropped rather than waited for when output backs up. */
+template<typename T>
+inline void dataLineSerial(T msg) {
+#if defined(SERIAL_OUT)
+  SerialOut::print(msg, SerialOut::Data);
+  SerialOut::endLine(SerialOut::Data);
+#endif
+}
+
+template<typename T>
+inline void dataSerial(T msg) {
+#if defined(SERIAL_OUT)
+  SerialOut::print(msg, SerialOut::Data);
 #endif
 }
 
@@ -98,17 +118,43 @@ void valuesSerialPrint();
    */
 void valuesSerialPlot();
 
+/**
+   * @brief Send the current values in the selected serial format: binary
+   * telemetry frames (see @ref Telemetry) or the log and plotter lines.
+   */
+void valuesSerialSend();
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////   DISPLAY   ///////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
 /**
    * @brief Initialize the OLED display (only when @ref DISP is enabled).
+   *
+   * With @p deferSplash the splash screen is not drawn here but sent by
+   * @ref printMainScreen(), one page per call, and held there for
+   * @ref DISP_SPLASH_MS without blocking the loop.
+   */
+void initDisplay(bool deferSplash);
+
+/**
+   * @brief Display traffic counters since boot.
    */
-void initDisplay();
+struct RenderStats {
+  uint32_t frames;    ///< full frames sent (all pages)
+  uint32_t partials;  ///< single pages sent by partial updates
+  uint32_t skipped;   ///< main screen calls that found nothing to redraw
+  uint32_t bytes;     ///< display RAM bytes sent (without I2C framing)
+  uint32_t debugLines;   ///< lines added to the debug overlay
+  uint32_t debugFrames;  ///< debug overlay frames sent
+};
 
 /**
    * @brief Render the main screen showing sensor values and status.
+   *
+   * Only redraws when the visible state changed; a clock tick alone just
+   * resends the header pages. While debug lines are shown (@ref DEBUG_DISP),
+   * the debug overlay is sent instead when it has new lines.
    */
 void printMainScreen();
 
@@ -132,4 +178,31 @@ bool isDisplayEnabled();
    * @brief Set OLED display contrast at runtime (0–255). Values will be clamped.
    */
 void setDisplayContrast(uint8_t value);
+
+/**
+   * @brief Contrast last set (@ref DISP_CONTRAST after startup unless
+   * configured otherwise).
+   */
+uint8_t displayContrast();
+
+/**
+   * @brief Redraw the sensor names after they were changed at runtime
+   * (rebuilds the label cache and forces a full frame).
+   */
+void namesChanged();
+
+/**
+   * @brief Frame and byte counters of the display output.
+   */
+const RenderStats& renderStats();
+
+#if !defined(ARDUINO) && defined(DISP)
+/**
+   * @brief Draw every page of the main screen at scroll position
+   * @p scrollOffset, @p sensorOffset with the current values, without
+   * sending it, and pass each page buffer to @p onPage (host builds only,
+   * for benchmarks).
+   */
+void drawMainFrame(int8_t scrollOffset, uint8_t sensorOffset, void (*onPage)(const uint8_t* page, uint16_t bytes));
+#endif  // !ARDUINO && DISP
 }  // namespace View
\ No newline at end of file